@@ -1,7 +1,18 @@
+//Expose POSIX file descriptor functions (read, writev), which strict C17 mode hides
+#define _POSIX_C_SOURCE 200809L
+
 #include "arrayList.h"
+#include "arrayListFrame.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 
 //True if the given size and allocatedLength would result in an unsafe list length (i.e., larger than MAXIMUM_LIST_BYTES)
 #define unsafeLength(size, allocatedLength) (unsigned __int128) size * allocatedLength > MAXIMUM_LIST_BYTES
@@ -18,6 +29,43 @@
     #define void_null_check(list)
 #endif
 
+//Number of tombstone bits in each bitmap word
+#define TOMBSTONE_WORD_BITS 64
+
+//Number of bitmap words needed to track <length> elements
+#define tombstoneWords(length) (((length) + TOMBSTONE_WORD_BITS - 1) / TOMBSTONE_WORD_BITS)
+
+//Default compaction threshold for tombstone mode, as a percentage of dead elements
+#define DEFAULT_COMPACT_PERCENT 25
+
+//Number of 32-bit words that alChecksum can sum before its 64-bit accumulators must be reduced
+#define CHECKSUM_BLOCK_WORDS 32768
+
+//Compact away any lazily-removed elements before an operation that depends on the physical position of elements
+#define settle_tombstones(list) if(list->tombstones != NULL && list->tombstones->deadCount > 0) alCompact(list);
+
+//Compact a list in tombstone mode once more than its threshold percentage of elements are dead. Only the append functions, which do not otherwise need to compact, use this, so removal during iteration never moves elements.
+#define compact_over_threshold(list) if(list->tombstones != NULL && (unsigned __int128) list->tombstones->deadCount * 100 > (unsigned __int128) list->length * list->tombstones->compactPercent) alCompact(list);
+
+
+//Lazy-removal state for an arrayList in tombstone mode
+struct alTombstones {
+    //Bitmap with one bit per allocated element. A set bit marks a dead (lazily removed) element. Bits at or past the list's length are always clear.
+    unsigned long* dead;
+
+    //Fenwick (binary indexed) tree over the number of dead elements in each bitmap word, 1-indexed. This provides O(log n) rank/select for logical indexing between compactions.
+    alLength* deadTree;
+
+    //Number of words in the bitmap (the tree has one more entry than this)
+    alLength words;
+
+    //Total number of dead elements in the list
+    alLength deadCount;
+
+    //The list is compacted once more than this percentage of its elements are dead
+    unsigned char compactPercent;
+};
+
 
 //Set all bytes in an ArrayList to a set constant (including unused bytes)
 void alSetList(arrayList* list, int setConstant){
@@ -51,6 +99,7 @@ arrayList* alNewLenArrayList(alESize size, alLength allocatedLength){
     list->size = size;
     list->length = 0;
     list->allocatedLength = allocatedLength;
+    list->tombstones = NULL;
 
     //Allocate specified initial allocated length
     list->head = (void*) malloc(size * allocatedLength);
@@ -85,19 +134,21 @@ arrayList* alNewBlankArrayList(alESize size){
 //Get a pointer to the head of an arrayList dynamically. Users should never store the head pointer statically.
 void* alGetListHead(arrayList* list){
     null_check(list, NULL);
+    settle_tombstones(list);
     return list->head;
 }
 
-//Get the length of the list, in elements
+//Get the length of the list, in elements. Elements that have been lazily removed in tombstone mode are not counted.
 alLength alGetListLength(arrayList* list){
     null_check(list, 0);
+    if(list->tombstones != NULL) return list->length - list->tombstones->deadCount;
     return list->length;
 }
 
 //Compute the actual size of the USED arrayList, in bytes. The list will always be smaller than MAXIMUM_LIST_BYTES.
 unsigned long alGetListSize(arrayList* list){
     null_check(list, 0);
-    return list->size * list->length;
+    return list->size * alGetListLength(list);
 }
 
 //Compute the actual size of the ALLOCATED arrayList, in bytes. The list will always be smaller than MAXIMUM_LIST_BYTES.
@@ -110,6 +161,7 @@ unsigned long alGetAllocatedListSize(arrayList* list){
 //Get an element in the arrayList by index. Returns a pointer to the element, or NULL for invalid inputs (blank list, element out of bounds, etc.).
 void* alGetElement(arrayList* list, alIndex index){
     null_check(list, NULL);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     if(list == NULL || list->head == NULL || index >= list->length) return NULL;
@@ -124,6 +176,7 @@ void* alGetElement(arrayList* list, alIndex index){
 //Get the last element in the arrayList. Returns a pointer to the element, or NULL for invalid inputs (blank list, element out of bounds, etc.).
 void* alGetLast(arrayList* list){
     null_check(list, NULL);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     if(list->length < 1) return NULL;
@@ -139,6 +192,9 @@ void* alGetFirst(arrayList* list){
 }
 
 
+//Resize the tombstone bitmap of a list in tombstone mode (defined with the other tombstone functions below)
+static int growTombstones(alTombstones*, alLength);
+
 //Expand the arrayList's allocated length, if possible. Returns the new allocatedLength, which may not be any larger.
 //If possible, the arrayList's size doubles. If that doubled size would exceed MAXIMUM_LIST_BYTES, the new size is locked at the maximum safe size.
 alLength expandList(arrayList* list){
@@ -156,6 +212,9 @@ alLength expandList(arrayList* list){
     //If there is no need to re-allocate anything, then don't bother
     if(newAlloc <= curAlloc) return curAlloc;
 
+    //Grow the tombstone bitmap to cover the new allocation first, if applicable, so that a failure leaves the list untouched
+    if(list->tombstones != NULL && growTombstones(list->tombstones, newAlloc) != 0) return curAlloc;
+
     //Allocate enough memory for the new size
     void* newHead = (void*) malloc(list->size * newAlloc);
 
@@ -183,6 +242,7 @@ alLength expandList(arrayList* list){
 //Returns a pointer to the element in the list, or NULL if the attempt failed (either because the list is too large or because the list is more than one element shorter than the specified insertion index)
 void* alInsert(arrayList* list, alIndex index, void* element){
     null_check(list, NULL);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Check index and list. Index must fall within [0, length of list].
@@ -223,6 +283,7 @@ void* alInsert(arrayList* list, alIndex index, void* element){
 //Returns a pointer to the element in the list, or NULL if the attempt failed (usually because the list is too large).
 void* alAppend(arrayList* list, void* element){
     null_check(list, NULL);
+    compact_over_threshold(list);
 
     //Expand list if necessary
     if(list->length >= list->allocatedLength){
@@ -254,6 +315,7 @@ void* alPrepend(arrayList* list, void* element){
 //Insert <count> elements at index <index> in the list, copying memory from <elements> to <elements + count - 1>. Returns a pointer to the beginning of the new elements in the list, or NULL if the operation failed (including cases where count < 1)
 void* alInsertMany(arrayList* list, alIndex index, void* elements, alLength count){
     null_check(list, NULL);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Check index and list. Index must fall within [0, length of list].
@@ -293,6 +355,7 @@ void* alInsertMany(arrayList* list, alIndex index, void* elements, alLength coun
 //Insert <count> elements at the end of the list, copying memory from <elements> to <elements + count - 1>. Returns a pointer to the beginning of the new elements in the list, or NULL if the operation failed (including cases where count < 1)
 void* alAppendMany(arrayList* list, void* elements, alLength count){
     null_check(list, NULL);
+    compact_over_threshold(list);
 
     if(count < 1) return NULL;
 
@@ -325,6 +388,7 @@ void* alPrependMany(arrayList* list, void* elements, alLength count){
 //Remove an element from the arrayList by index. Does not return the element. Returns 0 for success, or 1 if the provided index is out of bounds or the list is bad.
 int alRemove(arrayList* list, alIndex index){
     null_check(list, 1);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Do not remove from empty lists and ignore out-of-bounds indices
@@ -359,6 +423,7 @@ int alRemove(arrayList* list, alIndex index){
 //The last element is not overwritten; the array is simply shortened.
 int alRemoveLast(arrayList* list){
     null_check(list, 1);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Do not remove from empty lists
@@ -384,6 +449,7 @@ int alRemoveFirst(arrayList* list){
 //Remove <count> list elements from index <index> to <index + count - 1>. Returns 0 for success, or 1 if the list has too few elements or the list is bad.
 int alRemoveMany(arrayList* list, alIndex index, alLength count){
     null_check(list, 1);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Do not over-remove from lists that are too small and ignore out-of-bounds indices
@@ -418,6 +484,7 @@ int alRemoveMany(arrayList* list, alIndex index, alLength count){
 //Remove <count> list elements from the end of the list. Returns 0 for success, or 1 if the list has too few elements or the list is bad.
 int alRemoveLastMany(arrayList* list, alLength count){
     null_check(list, 1);
+    settle_tombstones(list);
 
     #ifndef NO_SAFETY
     //Do not over-remove from lists that are too small and ignore out-of-bounds indices
@@ -437,10 +504,666 @@ int alRemoveFirstMany(arrayList* list, alLength count){
 }
 
 
+//Sort the list in place with a qsort-style comparison function, which is passed pointers to two elements. The sort is not stable. Returns 0 for success, or 1 if the list is bad or no function is given.
+int alSort(arrayList* list, int (*compare)(const void*, const void*)){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(compare == NULL) return 1;
+    #endif
+
+    settle_tombstones(list);
+
+    if(list->length > 1) qsort(list->head, list->length, list->size, compare);
+    return 0;
+}
+
+
+//Reversal swaps vectors from the two ends of the memory inwards, reversing the elements within each vector with SSE2 shuffles. Element sizes that do not divide 16 are swapped whole, one pair at a time.
+
+//Rotations whose smaller side is at most this many bytes are finished through a stack buffer, with one memmove of the larger side
+#define ROTATE_BUFFER_BYTES 512
+
+#ifdef __SSE2__
+//Reverse the order of the elements of <size> bytes (1, 2, 4, 8 or 16) within a vector
+static inline __m128i reverseVector(__m128i v, alESize size){
+    switch(size){
+        case 1:
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        case 2:
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+            return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        case 4:
+            return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        case 8:
+            return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        default:
+            return v;
+    }
+}
+#endif
+
+//Swap two non-overlapping runs of <bytes> bytes
+static void swapBytes(char* a, char* b, unsigned long bytes){
+    unsigned long i = 0;
+
+    #ifdef __SSE2__
+    for(;i + 16 <= bytes;i += 16){
+        __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+        _mm_storeu_si128((__m128i*) (a + i), y);
+        _mm_storeu_si128((__m128i*) (b + i), x);
+    }
+    #endif
+
+    for(;i < bytes;i++){
+        char x = a[i];
+        a[i] = b[i];
+        b[i] = x;
+    }
+}
+
+//Reverse the order of <count> elements of <size> bytes, stored contiguously in memory
+void alReverseElements(void* elements, alLength count, alESize size){
+    if(elements == NULL || count < 2 || size < 1) return;
+
+    char* low = (char*) elements;
+    char* high = low + (count - 1) * size; //The last element
+
+    #ifdef __SSE2__
+    if(size <= 16 && (size & (size - 1)) == 0){
+        //Swap a vector from each end while the two vectors do not overlap
+        char* end = high + size;
+        while(end - low >= 32){
+            __m128i front = _mm_loadu_si128((const __m128i*) low);
+            __m128i back = _mm_loadu_si128((const __m128i*) (end - 16));
+            _mm_storeu_si128((__m128i*) low, reverseVector(back, size));
+            _mm_storeu_si128((__m128i*) (end - 16), reverseVector(front, size));
+            low += 16;
+            end -= 16;
+        }
+        high = end - size;
+    }
+    #endif
+
+    //Swap the remaining elements in pairs
+    if(size == 1){
+        for(;low < high;low++, high--){
+            char x = *low;
+            *low = *high;
+            *high = x;
+        }
+    } else {
+        for(;low < high;low += size, high -= size) swapBytes(low, high, size);
+    }
+}
+
+//Reverse the order of the elements in the list, in place. Returns 0 for success, or 1 if the list is bad.
+int alReverse(arrayList* list){
+    null_check(list, 1);
+    settle_tombstones(list);
+
+    alReverseElements(list->head, list->length, list->size);
+    return 0;
+}
+
+//Rotate the elements of the list in place, so the element at index <shift> becomes the first and the elements before it move to the end, keeping their order. A right rotation by r is a rotation by length - r.
+//Rotation uses block swaps, so it needs no temporary buffer larger than a small fixed stack buffer. Returns 0 for success, or 1 if the list is bad or <shift> is greater than the length of the list.
+int alRotate(arrayList* list, alIndex shift){
+    null_check(list, 1);
+    settle_tombstones(list);
+
+    if(shift > list->length) return 1;
+
+    //Rotate the bytes, which moves whole elements since both sides are whole numbers of elements
+    char* start = (char*) list->head;
+    unsigned long a = shift * list->size; //Bytes before the new first element
+    unsigned long b = (list->length - shift) * list->size; //Bytes from the new first element on
+
+    //Each block swap puts the smaller side's worth of bytes in their final place and leaves a smaller rotation, as in Gries and Mills' algorithm
+    while(a > 0 && b > 0){
+        if(a <= ROTATE_BUFFER_BYTES || b <= ROTATE_BUFFER_BYTES){
+            char buffer[ROTATE_BUFFER_BYTES];
+
+            if(a <= b){
+                memcpy(buffer, start, a);
+                memmove(start, start + a, b);
+                memcpy(start + b, buffer, a);
+            } else {
+                memcpy(buffer, start + a, b);
+                memmove(start + b, start, a);
+                memcpy(start, buffer, b);
+            }
+            break;
+        }
+
+        if(a <= b){
+            //A B1 B2 -> B2 B1 A, where B2 is as long as A. A is in place, and B2 B1 still needs rotating by the length of B2.
+            swapBytes(start, start + b, a);
+            b -= a;
+        } else {
+            //A1 A2 B -> B A2 A1, where A1 is as long as B. B is in place, and A2 A1 still needs rotating by the length of A2.
+            swapBytes(start, start + a, b);
+            start += b;
+            a -= b;
+        }
+    }
+
+    return 0;
+}
+
+
+//Tombstone mode lets elements be removed lazily: removal only marks a bit, and never moves elements, so removal is safe during iteration with alTombstoneNext.
+//Every other arrayList function compacts the list first if it holds any dead elements, so they always see a contiguous list. alAppend and alAppendMany do not need to, and only compact once enough elements are dead.
+
+
+//Find the first bit at or after <from> (and before <limit>) that is set (if wantSet is nonzero) or clear (if wantSet is 0). Scans a whole word at a time. Returns <limit> if there is no such bit.
+static alIndex tombstoneScan(const unsigned long* bits, alIndex from, alIndex limit, int wantSet){
+    while(from < limit){
+        //Load the word containing <from>, inverting it if we are searching for clear bits
+        unsigned long word = bits[from / TOMBSTONE_WORD_BITS];
+        if(!wantSet) word = ~word;
+
+        //Ignore bits before <from>
+        word &= ~0UL << (from % TOMBSTONE_WORD_BITS);
+
+        if(word != 0){
+            alIndex found = (from - from % TOMBSTONE_WORD_BITS) + __builtin_ctzl(word);
+            return found < limit ? found : limit;
+        }
+
+        //Skip to the start of the next word
+        from += TOMBSTONE_WORD_BITS - from % TOMBSTONE_WORD_BITS;
+    }
+
+    return limit;
+}
+
+//Rebuild the Fenwick tree from the bitmap in O(words)
+static void rebuildTombstoneTree(alTombstones* t){
+    for(alLength i = 1;i <= t->words;i++) t->deadTree[i] = __builtin_popcountl(t->dead[i - 1]);
+
+    for(alLength i = 1;i <= t->words;i++){
+        alLength parent = i + (i & -i);
+        if(parent <= t->words) t->deadTree[parent] += t->deadTree[i];
+    }
+}
+
+//Resize the tombstone bitmap and tree to cover <allocatedLength> elements. Returns 0 for success, or 1 if allocation failed (in which case the old state is kept).
+static int growTombstones(alTombstones* t, alLength allocatedLength){
+    alLength newWords = tombstoneWords(allocatedLength);
+    if(newWords <= t->words) return 0;
+
+    unsigned long* newDead = (unsigned long*) calloc(newWords, sizeof(unsigned long));
+    alLength* newTree = (alLength*) calloc(newWords + 1, sizeof(alLength));
+
+    if(newDead == NULL || newTree == NULL){
+        free(newDead);
+        free(newTree);
+        return 1;
+    }
+
+    //Copy the existing bitmap. The new words are clear, since they are past the end of the list.
+    memcpy(newDead, t->dead, t->words * sizeof(unsigned long));
+
+    free(t->dead);
+    free(t->deadTree);
+    t->dead = newDead;
+    t->deadTree = newTree;
+    t->words = newWords;
+
+    //The tree's shape depends on its size, so it must be rebuilt rather than copied
+    rebuildTombstoneTree(t);
+
+    return 0;
+}
+
+//Map a logical index (counting only live elements) to a physical index in O(log n). The logical index must be less than the number of live elements.
+static alIndex tombstoneSelect(arrayList* list, alIndex logical){
+    alTombstones* t = list->tombstones;
+
+    //Descend the Fenwick tree to find the bitmap word holding the target. Every word covers TOMBSTONE_WORD_BITS elements, so its live count is that number minus its dead count.
+    //Words past the end of the list count as fully live, which is harmless because the target is always a real element.
+    alLength word = 0;
+    alLength step = 1;
+    while(step * 2 <= t->words) step *= 2;
+
+    for(;step > 0;step /= 2){
+        if(word + step > t->words) continue;
+
+        alLength live = step * TOMBSTONE_WORD_BITS - t->deadTree[word + step];
+        if(live <= logical){
+            word += step;
+            logical -= live;
+        }
+    }
+
+    //Select the <logical>th clear bit in the word
+    unsigned long liveBits = ~t->dead[word];
+    for(alIndex i = 0;i < logical;i++) liveBits &= liveBits - 1;
+
+    return word * TOMBSTONE_WORD_BITS + __builtin_ctzl(liveBits);
+}
+
+//Enable tombstone mode. Appending to the list compacts it first whenever more than <compactPercent> percent of its elements are dead (0 selects the default of 25%). Returns 0 for success, or 1 if the list is bad or allocation failed.
+int alEnableTombstones(arrayList* list, unsigned char compactPercent){
+    null_check(list, 1);
+
+    if(compactPercent == 0 || compactPercent > 100) compactPercent = DEFAULT_COMPACT_PERCENT;
+
+    //If tombstone mode is already enabled, simply update the threshold
+    if(list->tombstones != NULL){
+        list->tombstones->compactPercent = compactPercent;
+        return 0;
+    }
+
+    alTombstones* t = (alTombstones*) malloc(sizeof(alTombstones));
+    if(t == NULL) return 1;
+
+    t->words = tombstoneWords(list->allocatedLength);
+    t->dead = (unsigned long*) calloc(t->words, sizeof(unsigned long));
+    t->deadTree = (alLength*) calloc(t->words + 1, sizeof(alLength));
+    t->deadCount = 0;
+    t->compactPercent = compactPercent;
+
+    if(t->dead == NULL || t->deadTree == NULL){
+        free(t->dead);
+        free(t->deadTree);
+        free(t);
+        return 1;
+    }
+
+    list->tombstones = t;
+
+    return 0;
+}
+
+//Compact the list and disable tombstone mode, freeing the tombstone bitmap. Does nothing if tombstone mode is already disabled.
+void alDisableTombstones(arrayList* list){
+    void_null_check(list);
+
+    if(list->tombstones == NULL) return;
+
+    alCompact(list);
+
+    free(list->tombstones->dead);
+    free(list->tombstones->deadTree);
+    free(list->tombstones);
+    list->tombstones = NULL;
+}
+
+//Compact the list, removing all lazily-removed elements while preserving the order of the remaining elements. Returns the new length of the list.
+alLength alCompact(arrayList* list){
+    null_check(list, 0);
+
+    alTombstones* t = list->tombstones;
+    if(t == NULL || t->deadCount == 0) return list->length;
+
+    //Move each run of live elements down in one memmove, skipping runs of dead elements a word at a time
+    alIndex write = 0;
+    alIndex read = tombstoneScan(t->dead, 0, list->length, 0);
+    while(read < list->length){
+        alIndex runEnd = tombstoneScan(t->dead, read, list->length, 1);
+        alLength runLength = runEnd - read;
+
+        if(read != write){
+            memmove((void*) ((unsigned long) list->head + (unsigned long) list->size * write),
+                (void*) ((unsigned long) list->head + (unsigned long) list->size * read),
+                runLength * list->size);
+        }
+
+        write += runLength;
+        read = tombstoneScan(t->dead, runEnd, list->length, 0);
+    }
+
+    //Update length and clear all tombstones
+    list->length = write;
+    memset(t->dead, 0, t->words * sizeof(unsigned long));
+    memset(t->deadTree, 0, (t->words + 1) * sizeof(alLength));
+    t->deadCount = 0;
+
+    return list->length;
+}
+
+//Lazily remove an element by logical index (i.e., its index among elements that have not been removed). Falls back to alRemove if tombstone mode is disabled. Returns 0 for success, or 1 if the provided index is out of bounds or the list is bad.
+int alTombstoneRemove(arrayList* list, alIndex index){
+    null_check(list, 1);
+
+    alTombstones* t = list->tombstones;
+    if(t == NULL) return alRemove(list, index);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length - t->deadCount) return 1;
+    #endif
+
+    //Find and mark the element
+    alIndex physical = t->deadCount > 0 ? tombstoneSelect(list, index) : index;
+    t->dead[physical / TOMBSTONE_WORD_BITS] |= 1UL << (physical % TOMBSTONE_WORD_BITS);
+    t->deadCount++;
+
+    //Update the Fenwick tree. The list is not compacted here, so iteration with alTombstoneNext can continue past a removal; the threshold is applied by the next append.
+    for(alLength i = physical / TOMBSTONE_WORD_BITS + 1;i <= t->words;i += i & -i) t->deadTree[i]++;
+
+    return 0;
+}
+
+//Get an element by logical index without compacting the list. Returns a pointer to the element, or NULL for invalid inputs (blank list, element out of bounds, etc.).
+void* alTombstoneGet(arrayList* list, alIndex index){
+    null_check(list, NULL);
+
+    alTombstones* t = list->tombstones;
+    if(t == NULL || t->deadCount == 0) return alGetElement(list, index);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length - t->deadCount) return NULL;
+    #endif
+
+    return (void*) ((unsigned long) list->head + (unsigned long) list->size * tombstoneSelect(list, index));
+}
+
+//Iterate over the live elements of the list in order, without compacting it. <cursor> must be set to 0 before the first call and is advanced by each call.
+//Returns a pointer to the next live element, or NULL once the end of the list is reached. The list must not be modified (other than by alTombstoneRemove) during iteration.
+void* alTombstoneNext(arrayList* list, alIndex* cursor){
+    null_check(list, NULL);
+
+    //Skip dead elements a word at a time
+    alIndex next = list->tombstones != NULL && list->tombstones->deadCount > 0
+        ? tombstoneScan(list->tombstones->dead, *cursor, list->length, 0)
+        : *cursor;
+
+    if(next >= list->length) return NULL;
+
+    *cursor = next + 1;
+
+    return (void*) ((unsigned long) list->head + (unsigned long) list->size * next);
+}
+
+
+//Buffer transfer hands a list's allocation to its caller, or takes over one the caller allocated, so data can move between lists (or to and from an lString) without being copied
+
+//Detach the list's buffer and give it to the caller, who must eventually free it with free(). The list is left empty, with a new buffer of DEFAULT_INITIAL_LENGTH elements.
+//The number of elements in the buffer and its allocated length (in elements) are stored in <length> and <allocatedLength>, either of which may be NULL. Returns the buffer, or NULL if the list is bad or allocation failed, in which case the list is unchanged.
+void* alDetachBuffer(arrayList* list, alLength* length, alLength* allocatedLength){
+    null_check(list, NULL);
+    settle_tombstones(list);
+
+    //Allocate the replacement first, so a failure leaves the list untouched
+    void* replacement = malloc(list->size * DEFAULT_INITIAL_LENGTH);
+    if(replacement == NULL) return NULL;
+
+    void* buffer = list->head;
+    if(length != NULL) *length = list->length;
+    if(allocatedLength != NULL) *allocatedLength = list->allocatedLength;
+
+    //The tombstone bitmap is at least as large as the new buffer needs, and every bit in it is clear after settling
+    list->head = replacement;
+    list->length = 0;
+    list->allocatedLength = DEFAULT_INITIAL_LENGTH;
+
+    return buffer;
+}
+
+//Replace the list's contents with a buffer from malloc that holds <length> elements and has room for <allocatedLength>. The list takes ownership of the buffer and frees its old one; nothing is copied.
+//Returns 0 for success, or 1 if the list or buffer is bad, <allocatedLength> is 0, less than <length> or unsafe, or allocation failed. On failure the list is unchanged and the caller still owns the buffer.
+int alAdoptBuffer(arrayList* list, void* buffer, alLength length, alLength allocatedLength){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(buffer == NULL || buffer == list->head || allocatedLength < 1 || allocatedLength < length || unsafeLength(list->size, allocatedLength)) return 1;
+    #endif
+
+    //The old contents are discarded, so dead elements only need to be forgotten, not compacted away
+    if(list->tombstones != NULL){
+        if(growTombstones(list->tombstones, allocatedLength) != 0) return 1;
+
+        memset(list->tombstones->dead, 0, list->tombstones->words * sizeof(unsigned long));
+        memset(list->tombstones->deadTree, 0, (list->tombstones->words + 1) * sizeof(alLength));
+        list->tombstones->deadCount = 0;
+    }
+
+    free(list->head);
+    list->head = buffer;
+    list->length = length;
+    list->allocatedLength = allocatedLength;
+
+    return 0;
+}
+
+
+//Binary serialization writes a list as an alFrameHeader followed by the raw contents of the list. Reads append the contents of a frame to an existing list.
+
+
+//Compute a 64-bit Fletcher-style checksum of <bytes> bytes of data
+//The data is summed as 32-bit words (zero-padding the final word), with both sums reduced modulo 2^32 - 1 only once per block of words
+unsigned long alChecksum(const void* data, unsigned long bytes){
+    const unsigned char* in = (const unsigned char*) data;
+    unsigned long sum1 = 0xFFFFFFFF;
+    unsigned long sum2 = 0xFFFFFFFF;
+
+    while(bytes > 0){
+        unsigned long blockWords = CHECKSUM_BLOCK_WORDS;
+
+        while(blockWords > 0 && bytes >= 4){
+            unsigned int word;
+            memcpy(&word, in, 4);
+            sum1 += word;
+            sum2 += sum1;
+            in += 4;
+            bytes -= 4;
+            blockWords--;
+        }
+
+        //Handle the final, partial word
+        if(blockWords > 0 && bytes > 0){
+            unsigned int word = 0;
+            memcpy(&word, in, bytes);
+            sum1 += word;
+            sum2 += sum1;
+            bytes = 0;
+        }
+
+        sum1 %= 0xFFFFFFFF;
+        sum2 %= 0xFFFFFFFF;
+    }
+
+    return (sum2 << 32) | sum1;
+}
+
+//Continue writing a frame with the given magic number, element size, and element count to a file descriptor, gathering the header and payload into a single writev call where possible. The first call fills in the writer's header.
+//Returns 0 once the whole frame is written, 1 if writing failed, or 2 if the file descriptor would block and the call should be repeated later with the same arguments.
+int alWriteFrame(alFrameWriter* writer, int fd, unsigned int magic, alESize size, alLength length, const void* data){
+    unsigned long payloadSize = (unsigned long) size * length;
+
+    if(writer->frameBytes == 0){
+        memset(&writer->header, 0, sizeof(alFrameHeader));
+        writer->header.magic = magic;
+        writer->header.version = AL_FRAME_VERSION;
+        writer->header.size = size;
+        writer->header.length = length;
+        writer->header.checksum = alChecksum(data, payloadSize);
+        writer->frameBytes = sizeof(alFrameHeader) + payloadSize;
+    }
+
+    //Keep writing until everything is written, since writev may write only part of the data
+    while(writer->writtenBytes < writer->frameBytes){
+        //Gather whatever is left of the header and the payload into one system call
+        struct iovec iov[2];
+        int count = 0;
+        unsigned long payloadWritten = 0;
+
+        if(writer->writtenBytes < sizeof(alFrameHeader)){
+            iov[count].iov_base = (void*) ((unsigned long) &writer->header + writer->writtenBytes);
+            iov[count].iov_len = sizeof(alFrameHeader) - writer->writtenBytes;
+            count++;
+        }
+        else payloadWritten = writer->writtenBytes - sizeof(alFrameHeader);
+
+        if(payloadWritten < payloadSize){
+            iov[count].iov_base = (void*) ((unsigned long) data + payloadWritten);
+            iov[count].iov_len = payloadSize - payloadWritten;
+            count++;
+        }
+
+        ssize_t written = writev(fd, iov, count);
+
+        if(written < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 2;
+            return 1;
+        }
+
+        writer->writtenBytes += written;
+    }
+
+    return 0;
+}
+
+//Read up to <count> bytes into <dest>, retrying after interrupts and short reads. Returns 0 once all bytes are read, 1 on an error or end-of-file, or 2 if the file descriptor would block. <done> is advanced by the number of bytes read.
+static int readSome(int fd, void* dest, unsigned long count, unsigned long* done){
+    while(*done < count){
+        ssize_t got = read(fd, (void*) ((unsigned long) dest + *done), count - *done);
+
+        if(got < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 2;
+            return 1;
+        }
+
+        //End-of-file before the frame is complete
+        if(got == 0) return 1;
+
+        *done += got;
+    }
+
+    return 0;
+}
+
+//Continue reading a frame header from a file descriptor. Returns 0 once the header is complete and valid, 1 if reading failed or the header is invalid, or 2 if the file descriptor would block.
+int alReadFrameHeader(alFrameReader* reader, int fd, unsigned int magic){
+    int status = readSome(fd, &reader->header, sizeof(alFrameHeader), &reader->headerBytes);
+    if(status != 0) return status;
+
+    //Validate the header
+    if(reader->header.magic != magic || reader->header.version != AL_FRAME_VERSION || reader->header.size < 1) return 1;
+    if(unsafeLength(reader->header.size, reader->header.length)) return 1;
+
+    return 0;
+}
+
+//Continue reading a frame payload from a file descriptor into <dest>, which has room for the first <room> bytes of it. If <holdFirst> is nonzero, the first payload byte is kept in the reader until the payload is complete, and only then stored in dest[0].
+//Returns 0 once the payload is complete and its checksum matches, 1 if reading failed or the checksum does not match, 2 if the file descriptor would block, or 3 if <dest> is full before the payload is complete.
+int alReadFramePayload(alFrameReader* reader, int fd, void* dest, unsigned long room, int holdFirst){
+    unsigned long payloadSize = (unsigned long) reader->header.size * reader->header.length;
+    if(room > payloadSize) room = payloadSize;
+
+    //The held byte is read into the reader, and everything after it straight into place
+    if(holdFirst && reader->payloadBytes == 0 && room > 0){
+        int status = readSome(fd, &reader->firstByte, 1, &reader->payloadBytes);
+        if(status != 0) return status;
+    }
+
+    int status = readSome(fd, dest, room, &reader->payloadBytes);
+    if(status != 0) return status;
+    if(room < payloadSize) return 3;
+
+    if(holdFirst && payloadSize > 0) *(unsigned char*) dest = reader->firstByte;
+
+    return alChecksum(dest, payloadSize) == reader->header.checksum ? 0 : 1;
+}
+
+//Write the list to a (blocking) file descriptor as a frame. Returns 0 for success, or 1 if the list is bad or writing failed. On a non-blocking file descriptor, use alWriteFdPartial instead.
+int alWriteFd(arrayList* list, int fd){
+    alFrameWriter writer;
+    alInitFrameWriter(&writer);
+
+    //A blocking file descriptor never reports that it would block, so a single call writes the whole frame
+    return alWriteFdPartial(list, &writer, fd) == 0 ? 0 : 1;
+}
+
+//Prepare a frame writer for a new streaming write
+void alInitFrameWriter(alFrameWriter* writer){
+    memset(writer, 0, sizeof(alFrameWriter));
+}
+
+//Continue a streaming write of the list to a (possibly non-blocking) file descriptor. The list must not be modified until the write finishes.
+//Returns 0 once the whole frame has been written, 1 if the list is bad or writing failed, or 2 if the file descriptor would block and the call should be repeated later.
+int alWriteFdPartial(arrayList* list, alFrameWriter* writer, int fd){
+    null_check(list, 1);
+    settle_tombstones(list);
+
+    return alWriteFrame(writer, fd, AL_FRAME_MAGIC, list->size, list->length, list->head);
+}
+
+//Read a frame from a (blocking) file descriptor and append its contents to the list, reading directly into the list's spare capacity. The frame's element size must match the list's.
+//Returns 0 for success, or 1 if the operation fails, in which case the list's contents are unchanged.
+int alReadFd(arrayList* list, int fd){
+    alFrameReader reader;
+    alInitFrameReader(&reader);
+
+    //A blocking file descriptor never reports that it would block, so a single call reads the whole frame
+    return alReadFdPartial(list, &reader, fd) == 0 ? 0 : 1;
+}
+
+//Prepare a frame reader for a new streaming read
+void alInitFrameReader(alFrameReader* reader){
+    memset(reader, 0, sizeof(alFrameReader));
+}
+
+//Continue a streaming read from a (possibly non-blocking) file descriptor, appending the frame's contents to the list once they are complete. The list must not be modified until the read finishes.
+//The list's capacity grows as the payload arrives, rather than to the length the frame header claims.
+//Returns 0 once the frame has been appended, 1 if the operation fails (the list's contents are unchanged), or 2 if the file descriptor would block and the call should be repeated later.
+int alReadFdPartial(arrayList* list, alFrameReader* reader, int fd){
+    null_check(list, 1);
+    settle_tombstones(list);
+
+    //Finish reading the header first
+    if(reader->headerBytes < sizeof(alFrameHeader)){
+        int status = alReadFrameHeader(reader, fd, AL_FRAME_MAGIC);
+        if(status != 0) return status;
+
+        if(reader->header.size != list->size) return 1;
+        if(reader->header.length > maxSafeLength(list->size) - list->length) return 1;
+    }
+
+    //Read the payload directly past the end of the list, and only count it as part of the list once its checksum has been verified
+    unsigned long payloadSize = (unsigned long) list->size * reader->header.length;
+    int status = 3;
+
+    while(status == 3){
+        //Make room for at most one more block of the payload than has arrived
+        unsigned long remaining = payloadSize - reader->payloadBytes;
+        unsigned long wanted = reader->payloadBytes + (remaining < FRAME_READ_BLOCK ? remaining : FRAME_READ_BLOCK);
+
+        while((unsigned long) list->size * (list->allocatedLength - list->length) < wanted){
+            alLength oldLen = list->allocatedLength;
+            if(expandList(list) <= oldLen) return 1;
+        }
+
+        void* endOfList = (void*) ((unsigned long) list->head + (unsigned long) list->size * list->length);
+        status = alReadFramePayload(reader, fd, endOfList, (unsigned long) list->size * (list->allocatedLength - list->length), 0);
+    }
+
+    if(status != 0) return status;
+
+    list->length += reader->header.length;
+
+    return 0;
+}
+
+
 //Destroy and de-allocate an arrayList
 void alFreeArrayList(arrayList* list){
     void_null_check(list);
 
+    //De-allocate tombstone state, if any
+    if(list->tombstones != NULL){
+        free(list->tombstones->dead);
+        free(list->tombstones->deadTree);
+        free(list->tombstones);
+    }
+
     //De-allocate list memory
     free(list->head);
 
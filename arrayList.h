@@ -1,3 +1,6 @@
+#ifndef ARRAYLIST_H
+#define ARRAYLIST_H
+
 //#include <stdlib.h>
 #include <limits.h>
 
@@ -13,6 +16,16 @@ typedef unsigned long alLength;
 //An arrayList element size
 typedef unsigned short alESize;
 
+//Magic numbers that identify framed arrayLists and lStrings ("ALST" and "LSTR" as little-endian integers)
+#define AL_FRAME_MAGIC 0x54534C41
+#define LSTR_FRAME_MAGIC 0x5254534C
+
+//Version of the frame format written by alWriteFd and lstrWriteFd
+#define AL_FRAME_VERSION 1
+
+//Lazy-removal state for an arrayList (a tombstone bitmap plus a rank/select tree). Defined in arrayList.c, since users should never touch it directly.
+typedef struct alTombstones alTombstones;
+
 
 //Define the arrayList type as a struct with all of the necessary fields
 typedef struct arrList {
@@ -35,9 +48,58 @@ typedef struct arrList {
     //Pointer to the current head of the list. This pointer is subject to change as the list grows, so it should not be referenced statically.
     //This pointer will point to an address allocated by malloc
     void* head;
+
+    //Pointer to the list's lazy-removal state, or NULL if tombstone mode is disabled (the default)
+    alTombstones* tombstones;
 } arrayList;
 
 
+//Header written before the contents of a list by alWriteFd and lstrWriteFd. All fields are stored in the host's byte order.
+typedef struct alFrameHeader {
+    //AL_FRAME_MAGIC or LSTR_FRAME_MAGIC
+    unsigned int magic;
+
+    //AL_FRAME_VERSION
+    unsigned short version;
+
+    //Size, in bytes, of each element in the payload (always 1 for a lString)
+    alESize size;
+
+    //Number of elements in the payload
+    alLength length;
+
+    //alChecksum of the payload
+    unsigned long checksum;
+} alFrameHeader;
+
+//Progress of a streaming read (alReadFdPartial or lstrReadFdPartial), which may be spread over many calls on a non-blocking file descriptor
+typedef struct alFrameReader {
+    //The frame header, which is only valid once headerBytes reaches sizeof(alFrameHeader)
+    alFrameHeader header;
+
+    //Number of header bytes read so far
+    unsigned long headerBytes;
+
+    //Number of payload bytes read so far
+    unsigned long payloadBytes;
+
+    //The first payload byte of an lString frame, which is held back until the payload is complete so that the string stays null-terminated
+    unsigned char firstByte;
+} alFrameReader;
+
+//Progress of a streaming write (alWriteFdPartial or lstrWriteFdPartial), which may be spread over many calls on a non-blocking file descriptor
+typedef struct alFrameWriter {
+    //The frame header, which the first call fills in
+    alFrameHeader header;
+
+    //Size of the whole frame in bytes, or 0 before the first call
+    unsigned long frameBytes;
+
+    //Number of frame bytes written so far
+    unsigned long writtenBytes;
+} alFrameWriter;
+
+
 //Set all bytes in an ArrayList to a set constant (including unused bytes)
 void alSetList(arrayList*, int);
 
@@ -61,7 +123,7 @@ arrayList* alNewBlankArrayList(alESize);
 //Get a pointer to the head of an arrayList dynamically. Users should never store the head pointer statically.
 void* alGetListHead(arrayList*);
 
-//Get the length of the list, in elements
+//Get the length of the list, in elements. Elements that have been lazily removed in tombstone mode are not counted.
 alLength alGetListLength(arrayList*);
 
 //Compute the actual size of the USED arrayList, in bytes. The list will always be smaller than MAXIMUM_LIST_BYTES.
@@ -124,8 +186,83 @@ int alRemoveLastMany(arrayList*, alLength);
 int alRemoveFirstMany(arrayList*, alLength);
 
 
+//Sort the list in place with a qsort-style comparison function, which is passed pointers to two elements. The sort is not stable. Returns 0 for success, or 1 if the list is bad or no function is given.
+int alSort(arrayList*, int (*)(const void*, const void*));
+
+//Reverse the order of <count> elements of <size> bytes, stored contiguously in memory
+void alReverseElements(void*, alLength, alESize);
+
+//Reverse the order of the elements in the list, in place. Returns 0 for success, or 1 if the list is bad.
+int alReverse(arrayList*);
+
+//Rotate the elements of the list in place, so the element at index <shift> becomes the first and the elements before it move to the end, keeping their order. A right rotation by r is a rotation by length - r.
+//Rotation uses block swaps, so it needs no temporary buffer larger than a small fixed stack buffer. Returns 0 for success, or 1 if the list is bad or <shift> is greater than the length of the list.
+int alRotate(arrayList*, alIndex);
+
+
+//Tombstone mode lets elements be removed lazily: removal only marks a bit, and never moves elements, so removal is safe during iteration with alTombstoneNext.
+//Every other arrayList function compacts the list first if it holds any dead elements, so they always see a contiguous list. alAppend and alAppendMany do not need to, and only compact once enough elements are dead.
+
+//Enable tombstone mode. Appending to the list compacts it first whenever more than <compactPercent> percent of its elements are dead (0 selects the default of 25%). Returns 0 for success, or 1 if the list is bad or allocation failed.
+int alEnableTombstones(arrayList*, unsigned char);
+
+//Compact the list and disable tombstone mode, freeing the tombstone bitmap. Does nothing if tombstone mode is already disabled.
+void alDisableTombstones(arrayList*);
+
+//Compact the list, removing all lazily-removed elements while preserving the order of the remaining elements. Returns the new length of the list.
+alLength alCompact(arrayList*);
+
+//Lazily remove an element by logical index (i.e., its index among elements that have not been removed). Falls back to alRemove if tombstone mode is disabled. Returns 0 for success, or 1 if the provided index is out of bounds or the list is bad.
+int alTombstoneRemove(arrayList*, alIndex);
+
+//Get an element by logical index without compacting the list. Returns a pointer to the element, or NULL for invalid inputs (blank list, element out of bounds, etc.).
+void* alTombstoneGet(arrayList*, alIndex);
+
+//Iterate over the live elements of the list in order, without compacting it. <cursor> must be set to 0 before the first call and is advanced by each call.
+//Returns a pointer to the next live element, or NULL once the end of the list is reached. The list must not be modified (other than by alTombstoneRemove) during iteration.
+void* alTombstoneNext(arrayList*, alIndex*);
+
+
+//Buffer transfer hands a list's allocation to its caller, or takes over one the caller allocated, so data can move between lists (or to and from an lString) without being copied
+
+//Detach the list's buffer and give it to the caller, who must eventually free it with free(). The list is left empty, with a new buffer of DEFAULT_INITIAL_LENGTH elements.
+//The number of elements in the buffer and its allocated length (in elements) are stored in <length> and <allocatedLength>, either of which may be NULL. Returns the buffer, or NULL if the list is bad or allocation failed, in which case the list is unchanged.
+void* alDetachBuffer(arrayList*, alLength*, alLength*);
+
+//Replace the list's contents with a buffer from malloc that holds <length> elements and has room for <allocatedLength>. The list takes ownership of the buffer and frees its old one; nothing is copied.
+//Returns 0 for success, or 1 if the list or buffer is bad, <allocatedLength> is 0, less than <length> or unsafe, or allocation failed. On failure the list is unchanged and the caller still owns the buffer.
+int alAdoptBuffer(arrayList*, void*, alLength, alLength);
+
+
+//Binary serialization writes a list as an alFrameHeader followed by the raw contents of the list. Reads append the contents of a frame to an existing list.
+
+//Write the list to a (blocking) file descriptor as a frame. Returns 0 for success, or 1 if the list is bad or writing failed. On a non-blocking file descriptor, use alWriteFdPartial instead.
+int alWriteFd(arrayList*, int);
+
+//Prepare a frame writer for a new streaming write
+void alInitFrameWriter(alFrameWriter*);
+
+//Continue a streaming write of the list to a (possibly non-blocking) file descriptor. The list must not be modified until the write finishes.
+//Returns 0 once the whole frame has been written, 1 if the list is bad or writing failed, or 2 if the file descriptor would block and the call should be repeated later.
+int alWriteFdPartial(arrayList*, alFrameWriter*, int);
+
+//Read a frame from a (blocking) file descriptor and append its contents to the list, reading directly into the list's spare capacity. The frame's element size must match the list's.
+//Returns 0 for success, or 1 if the operation fails, in which case the list's contents are unchanged.
+int alReadFd(arrayList*, int);
+
+//Prepare a frame reader for a new streaming read
+void alInitFrameReader(alFrameReader*);
+
+//Continue a streaming read from a (possibly non-blocking) file descriptor, appending the frame's contents to the list once they are complete. The list must not be modified until the read finishes.
+//The list's capacity grows as the payload arrives, rather than to the length the frame header claims.
+//Returns 0 once the frame has been appended, 1 if the operation fails (the list's contents are unchanged), or 2 if the file descriptor would block and the call should be repeated later.
+int alReadFdPartial(arrayList*, alFrameReader*, int);
+
+
 //Destroy and de-allocate an arrayList
 void alFreeArrayList(arrayList*);
 
 //Print diagnostic information for debugging and development
 void alDiagnostics(arrayList*);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef ARRAYLISTFRAME_H
+#define ARRAYLISTFRAME_H
+
+#include "arrayList.h"
+
+//Frame helpers shared by the arrayList and lString serialization functions. This header is private to arrayList.c and listString.c, and is not part of either public interface.
+
+#define FRAME_READ_BLOCK 65536 //The most payload bytes a streaming read makes room for before they arrive, so a frame header's claimed length cannot force a large allocation on its own
+
+
+//Compute a 64-bit Fletcher-style checksum of <bytes> bytes of data
+unsigned long alChecksum(const void*, unsigned long);
+
+//Continue writing a frame with the given magic number, element size, and element count to a file descriptor, gathering the header and payload into a single writev call where possible. The first call fills in the writer's header.
+//Returns 0 once the whole frame is written, 1 if writing failed, or 2 if the file descriptor would block and the call should be repeated later with the same arguments.
+int alWriteFrame(alFrameWriter*, int, unsigned int, alESize, alLength, const void*);
+
+//Continue reading a frame header from a file descriptor. Returns 0 once the header is complete and valid, 1 if reading failed or the header is invalid, or 2 if the file descriptor would block.
+int alReadFrameHeader(alFrameReader*, int, unsigned int);
+
+//Continue reading a frame payload from a file descriptor into <dest>, which has room for the first <room> bytes of it. If <holdFirst> is nonzero, the first payload byte is kept in the reader until the payload is complete, and only then stored in dest[0].
+//Returns 0 once the payload is complete and its checksum matches, 1 if reading failed or the checksum does not match, 2 if the file descriptor would block, or 3 if <dest> is full before the payload is complete.
+int alReadFramePayload(alFrameReader*, int, void*, unsigned long, int);
+
+#endif
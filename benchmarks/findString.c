@@ -0,0 +1,107 @@
+//Benchmark lstrFindString against the nested byte loop it replaced and against glibc's memmem, across needle lengths
+//Build and run with `make benchFind`
+
+//Expose memmem, which is a GNU extension
+#define _GNU_SOURCE
+
+#include "../listString.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HAYSTACK_BYTES (16 << 20) //Size of the text haystack
+#define ADVERSARIAL_BYTES (1 << 20) //Size of the repetitive haystack, which is smaller because the nested loop is quadratic on it
+
+//Get the current time, in seconds
+static double now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+//The nested-loop search that lstrFindString used before
+static lstrIndex nestedLoopFind(lString* lstr, char* str){
+    lstrLength len = strlen(str);
+    if(len > lstr->length || len < 1) return MAXIMUM_STRING_BYTES;
+
+    for(lstrIndex i = 0;i <= lstr->length - len;i++){
+        for(lstrIndex j = 0;j < len;j++){
+            if(lstr->head[i + j] != str[j]) break;
+            else if(j == len-1) return i;
+        }
+    }
+
+    return MAXIMUM_STRING_BYTES;
+}
+
+//Time one search with each method, repeating it enough times to measure, and print a row of milliseconds per search. Exits if the methods disagree.
+static void timeSearch(lString* haystack, char* needle){
+    lstrIndex expected = MAXIMUM_STRING_BYTES;
+    double times[3];
+
+    for(int method = 0;method < 3;method++){
+        int runs = 0;
+        lstrIndex found = MAXIMUM_STRING_BYTES;
+        double start = now(), elapsed;
+
+        do {
+            if(method == 0) found = nestedLoopFind(haystack, needle);
+            else if(method == 1) found = lstrFindString(haystack, needle);
+            else {
+                char* match = (char*) memmem(haystack->head, haystack->length, needle, strlen(needle));
+                found = match == NULL ? MAXIMUM_STRING_BYTES : (lstrIndex) (match - haystack->head);
+            }
+            runs++;
+            elapsed = now() - start;
+        } while(elapsed < 0.2);
+
+        if(method == 0) expected = found;
+        else if(found != expected){
+            printf("Methods disagree on a needle of %lu bytes\n", strlen(needle));
+            exit(1);
+        }
+
+        times[method] = elapsed * 1000 / runs;
+    }
+
+    printf("%8lu %14.3f %14.3f %14.3f\n", strlen(needle), times[0], times[1], times[2]);
+}
+
+int main(){
+    static const lstrLength needleLengths[] = {1, 2, 4, 8, 16, 32, 64, 256};
+    char needle[257];
+    srand(31);
+
+    //English-like text: lowercase words separated by spaces, with the needle planted once at the very end
+    lString* text = lstrNewLenString(HAYSTACK_BYTES + 1);
+    for(lstrIndex i = 0;i < HAYSTACK_BYTES;i++) text->head[i] = rand() % 6 == 0 ? ' ' : "etaoinshrdlucmfwyp"[rand() % 18];
+    text->length = HAYSTACK_BYTES;
+
+    printf("Text haystack (%d MB), milliseconds per search\n  needle    nested loop  lstrFindString         memmem\n", HAYSTACK_BYTES >> 20);
+    for(int n = 0;n < 8;n++){
+        lstrLength len = needleLengths[n];
+        for(lstrIndex i = 0;i < len;i++) needle[i] = "QXZJKV"[i % 6];
+        needle[len] = '\0';
+        memcpy(text->head + HAYSTACK_BYTES - len, needle, len);
+        timeSearch(text, needle);
+    }
+
+    //Repetitive input: all 'a', searched for a run of 'a' followed by 'b', which the nested loop matches almost fully at every position
+    lString* repetitive = lstrNewLenString(ADVERSARIAL_BYTES + 1);
+    memset(repetitive->head, 'a', ADVERSARIAL_BYTES);
+    repetitive->length = ADVERSARIAL_BYTES;
+
+    printf("\nRepetitive haystack (%d MB), milliseconds per search\n  needle    nested loop  lstrFindString         memmem\n", ADVERSARIAL_BYTES >> 20);
+    for(int n = 1;n < 8;n++){
+        lstrLength len = needleLengths[n];
+        memset(needle, 'a', len - 1);
+        needle[len - 1] = 'b';
+        needle[len] = '\0';
+        timeSearch(repetitive, needle);
+    }
+
+    lstrFreeString(text);
+    lstrFreeString(repetitive);
+    return 0;
+}
@@ -0,0 +1,146 @@
+//Benchmark lstrFindMatch against a naive backtracking matcher and against glibc's regexec, on inputs where backtracking and repeated anchored attempts go quadratic or worse
+//Build and run with `make benchMatch`
+
+#include "../stringMatcher.h"
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_BYTES (4 << 20) //Size of the log-like haystack
+
+//Get the current time, in seconds
+static double now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+//Naive backtracking for the subset of the syntax made of literal bytes, '.', '*', '^', '$' and '|' between whole alternatives. Each '*' tries the longest run first and backs off one byte at a time.
+static int backtrackHere(const char* pattern, const char* patternEnd, const char* text);
+
+static int backtrackStar(char c, const char* pattern, const char* patternEnd, const char* text){
+    const char* t = text;
+    while(*t != '\0' && (*t == c || c == '.')) t++;
+
+    do {
+        if(backtrackHere(pattern, patternEnd, t)) return 1;
+    } while(t-- > text);
+
+    return 0;
+}
+
+static int backtrackHere(const char* pattern, const char* patternEnd, const char* text){
+    if(pattern == patternEnd) return 1;
+    if(pattern + 1 < patternEnd && pattern[1] == '*') return backtrackStar(pattern[0], pattern + 2, patternEnd, text);
+    if(pattern[0] == '$' && pattern + 1 == patternEnd) return *text == '\0';
+    if(*text != '\0' && (pattern[0] == '.' || pattern[0] == *text)) return backtrackHere(pattern + 1, patternEnd, text + 1);
+    return 0;
+}
+
+//Find where the leftmost match starts, trying every alternative at every position. Returns the offset, or -1 if there is no match.
+static long backtrackFind(const char* pattern, const char* text){
+    const char* t = text;
+
+    do {
+        for(const char* alternative = pattern;;){
+            const char* end = strchr(alternative, '|');
+            if(end == NULL) end = alternative + strlen(alternative);
+
+            if(alternative[0] == '^'){
+                if(t == text && backtrackHere(alternative + 1, end, t)) return 0;
+            }
+            else if(backtrackHere(alternative, end, t)) return t - text;
+
+            if(*end == '\0') break;
+            alternative = end + 1;
+        }
+    } while(*t++ != '\0');
+
+    return -1;
+}
+
+//Time one search with each method, repeating it enough times to measure, and print a row of milliseconds per search. Exits if the methods disagree on where the match starts.
+static void timeSearch(const char* name, const char* pattern, lString* haystack){
+    lstrMatcher* matcher = lstrNewRegexMatcher((char*) pattern);
+    regex_t regex;
+    if(matcher == NULL || regcomp(&regex, pattern, REG_EXTENDED) != 0){
+        printf("Could not compile %s\n", pattern);
+        exit(1);
+    }
+
+    long expected = -1;
+    double times[3];
+
+    for(int method = 0;method < 3;method++){
+        int runs = 0;
+        long found = -1;
+        double start = now(), elapsed;
+
+        do {
+            if(method == 0) found = backtrackFind(pattern, haystack->head);
+            else if(method == 1){
+                lstrSpan match;
+                found = lstrFindMatch(haystack, matcher, 0, &match) == 0 ? (long) match.offset : -1;
+            }
+            else {
+                regmatch_t match;
+                found = regexec(&regex, haystack->head, 1, &match, 0) == 0 ? (long) match.rm_so : -1;
+            }
+            runs++;
+            elapsed = now() - start;
+        } while(elapsed < 0.2);
+
+        if(method == 0) expected = found;
+        else if(found != expected){
+            printf("Methods disagree on %s\n", name);
+            exit(1);
+        }
+
+        times[method] = elapsed * 1000 / runs;
+    }
+
+    printf("%-16s %9lu %14.3f %14.3f %14.3f\n", name, haystack->length, times[0], times[1], times[2]);
+
+    lstrFreeMatcher(matcher);
+    regfree(&regex);
+}
+
+//Make a string of <length> copies of <fill>, with <last> as its final byte
+static lString* repeated(char fill, char last, lstrLength length){
+    lString* lstr = lstrNewLenString(length + 1);
+    memset(lstr->head, fill, length - 1);
+    lstr->head[length - 1] = last;
+    lstr->length = length;
+    return lstr;
+}
+
+int main(){
+    printf("Milliseconds per search\ncase                 bytes   backtracking  lstrFindMatch        regexec\n");
+
+    //Every start runs 'a*c' to the 'x' before failing, so trying each start in turn is quadratic
+    for(lstrLength length = 8 << 10;length <= 32 << 10;length *= 2){
+        lString* lstr = repeated('a', 'x', length);
+        timeSearch("x|a*c", "x|a*c", lstr);
+        lstrFreeString(lstr);
+    }
+
+    //Backtracking tries every way of splitting each run of 'a' between the stars, at every start
+    for(lstrLength length = 256;length <= 1024;length *= 2){
+        lString* lstr = repeated('a', 'a', length);
+        timeSearch("a*a*b", "a*a*b", lstr);
+        lstrFreeString(lstr);
+    }
+
+    //Log-like text, where every method should be linear: lowercase words, with the match planted once at the very end
+    srand(47);
+    lString* log = lstrNewLenString(LOG_BYTES + 1);
+    for(lstrIndex i = 0;i < LOG_BYTES;i++) log->head[i] = rand() % 6 == 0 ? ' ' : rand() % 30 == 0 ? '\n' : "etaoinshrdlucmfwyp"[rand() % 18];
+    memcpy(log->head + LOG_BYTES - 20, "ERROR: read timeout", 19);
+    log->length = LOG_BYTES;
+    timeSearch("ERROR.*timeout", "ERROR.*timeout", log);
+    lstrFreeString(log);
+
+    return 0;
+}
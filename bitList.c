@@ -0,0 +1,355 @@
+#include "bitList.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(list, retVal) if(list==NULL || list->head==NULL) return retVal;
+    #define void_null_check(list) if(list==NULL || list->head==NULL) return;
+#else
+    #define null_check(list, retVal)
+    #define void_null_check(list)
+#endif
+
+//Number of bits in each word
+#define WORD_BITS 64
+
+//Number of words needed to hold <bits> bits
+#define wordsFor(bits) (((bits) + WORD_BITS - 1) / WORD_BITS)
+
+
+//Create a new, empty bitList with room for at least the specified number of bits before it must grow. Returns NULL if allocation failed.
+bitList* blNewLenBitList(alLength bits){
+    alLength words = wordsFor(bits);
+
+    //Do not allow allocations of size 0
+    if(words < 1) words = 1;
+
+    bitList* list = (bitList*) malloc(sizeof(bitList));
+    if(list == NULL) return NULL;
+
+    list->length = 0;
+    list->allocatedWords = words;
+
+    //Every unused bit must be 0, so the words are zeroed
+    list->head = (unsigned long*) calloc(words, sizeof(unsigned long));
+
+    if(list->head == NULL){
+        free(list);
+        return NULL;
+    }
+
+    return list;
+}
+
+//Create a new, empty bitList with the default initial length. Returns NULL if allocation failed.
+bitList* blNewBitList(){
+    return blNewLenBitList(DEFAULT_INITIAL_BIT_WORDS * WORD_BITS);
+}
+
+
+//Get a pointer to the list's words dynamically. Users should never store the head pointer statically.
+unsigned long* blGetListHead(bitList* list){
+    null_check(list, NULL);
+    return list->head;
+}
+
+//Get the length of the list, in bits
+alLength blGetListLength(bitList* list){
+    null_check(list, 0);
+    return list->length;
+}
+
+
+//Get a bit by index. Returns the bit (0 or 1), or -1 for invalid inputs (bit out of bounds, etc.).
+int blGet(bitList* list, alIndex index){
+    null_check(list, -1);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length) return -1;
+    #endif
+
+    return (list->head[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+}
+
+//Set a bit by index to 0 (if <bit> is 0) or 1 (otherwise). Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int blSet(bitList* list, alIndex index, int bit){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length) return 1;
+    #endif
+
+    if(bit) list->head[index / WORD_BITS] |= 1UL << (index % WORD_BITS);
+    else list->head[index / WORD_BITS] &= ~(1UL << (index % WORD_BITS));
+
+    return 0;
+}
+
+
+//Double the list's allocated length, if possible. Returns the new number of allocated words, which may not be any larger if the operation failed.
+static alLength expandBitList(bitList* list){
+    alLength curWords = list->allocatedWords;
+    if(curWords > ULONG_MAX / WORD_BITS / 2) return curWords;
+
+    alLength newWords = curWords * 2;
+
+    unsigned long* newHead = (unsigned long*) realloc(list->head, newWords * sizeof(unsigned long));
+    if(newHead == NULL) return curWords;
+
+    //Zero out the new words, since every unused bit must be 0
+    memset(newHead + curWords, 0, (newWords - curWords) * sizeof(unsigned long));
+
+    list->head = newHead;
+    list->allocatedWords = newWords;
+
+    return newWords;
+}
+
+
+//Insert a bit at an arbitrary index. All later bits are shifted up, a word at a time. Returns 0 for success, or 1 if the operation failed (index out of bounds, allocation failed, etc.).
+int blInsert(bitList* list, alIndex index, int bit){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index > list->length) return 1;
+    #endif
+
+    //Expand list if necessary
+    if(list->length >= list->allocatedWords * WORD_BITS){
+        alLength oldWords = list->allocatedWords;
+        if(expandBitList(list) <= oldWords) return 1;
+    }
+
+    alIndex word = index / WORD_BITS;
+    unsigned long shift = index % WORD_BITS;
+    alIndex lastWord = list->length / WORD_BITS;
+
+    //Shift every later word up by one bit, carrying the top bit of the previous word into the bottom
+    for(alIndex i = lastWord;i > word;i--){
+        list->head[i] = (list->head[i] << 1) | (list->head[i - 1] >> (WORD_BITS - 1));
+    }
+
+    //Within the insertion word, keep the bits below the index and shift the rest up
+    unsigned long lowMask = (1UL << shift) - 1;
+    unsigned long cur = list->head[word];
+    list->head[word] = (cur & lowMask) | ((cur & ~lowMask) << 1) | ((unsigned long) (bit != 0) << shift);
+
+    list->length++;
+
+    return 0;
+}
+
+//Add a bit to the end of the list. Returns 0 for success, or 1 if the operation failed.
+int blAppend(bitList* list, int bit){
+    null_check(list, 1);
+
+    //Expand list if necessary
+    if(list->length >= list->allocatedWords * WORD_BITS){
+        alLength oldWords = list->allocatedWords;
+        if(expandBitList(list) <= oldWords) return 1;
+    }
+
+    //The new bit is already 0, so only a 1 needs to be written
+    if(bit) list->head[list->length / WORD_BITS] |= 1UL << (list->length % WORD_BITS);
+
+    list->length++;
+
+    return 0;
+}
+
+//Add a bit to the start of the list. Returns 0 for success, or 1 if the operation failed.
+int blPrepend(bitList* list, int bit){
+    return blInsert(list, 0, bit);
+}
+
+
+//Remove a bit by index. All later bits are shifted down, a word at a time. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int blRemove(bitList* list, alIndex index){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length) return 1;
+    #endif
+
+    alIndex word = index / WORD_BITS;
+    unsigned long shift = index % WORD_BITS;
+    alIndex lastWord = (list->length - 1) / WORD_BITS;
+
+    //Within the removal word, keep the bits below the index and shift the rest down
+    unsigned long lowMask = (1UL << shift) - 1;
+    unsigned long cur = list->head[word];
+    list->head[word] = (cur & lowMask) | ((cur >> 1) & ~lowMask);
+
+    //Shift every later word down by one bit, carrying its bottom bit into the top of the previous word
+    for(alIndex i = word + 1;i <= lastWord;i++){
+        list->head[i - 1] |= list->head[i] << (WORD_BITS - 1);
+        list->head[i] >>= 1;
+    }
+
+    list->length--;
+
+    return 0;
+}
+
+//Remove the last bit. Returns 0 for success, or 1 if the list is empty or bad.
+int blRemoveLast(bitList* list){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(list->length < 1) return 1;
+    #endif
+
+    //Clear the bit, since every unused bit must be 0
+    list->length--;
+    list->head[list->length / WORD_BITS] &= ~(1UL << (list->length % WORD_BITS));
+
+    return 0;
+}
+
+//Remove the first bit. Returns 0 for success, or 1 if the list is empty or bad.
+int blRemoveFirst(bitList* list){
+    return blRemove(list, 0);
+}
+
+
+//Count the set bits in <words> words with the compiler's generic population count
+static alLength countGeneric(const unsigned long* words, alLength count){
+    alLength total = 0;
+    for(alLength i = 0;i < count;i++) total += __builtin_popcountl(words[i]);
+    return total;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//Count the set bits in <words> words with the POPCNT instruction, which the baseline x86-64 target does not assume
+__attribute__((target("popcnt")))
+static alLength countHardware(const unsigned long* words, alLength count){
+    alLength total = 0;
+    for(alLength i = 0;i < count;i++) total += __builtin_popcountl(words[i]);
+    return total;
+}
+#endif
+
+//Count the set bits in the list, using the hardware population count instruction where available
+alLength blCount(bitList* list){
+    null_check(list, 0);
+
+    //Unused bits are always 0, so whole words can be counted
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(__builtin_cpu_supports("popcnt")) return countHardware(list->head, wordsFor(list->length));
+    #endif
+
+    return countGeneric(list->head, wordsFor(list->length));
+}
+
+//Find the first set bit in the list. Returns its index, or BIT_NOT_FOUND if no bit is set.
+alIndex blFindFirstSet(bitList* list){
+    null_check(list, BIT_NOT_FOUND);
+
+    alLength words = wordsFor(list->length);
+    for(alIndex i = 0;i < words;i++){
+        if(list->head[i] != 0) return i * WORD_BITS + __builtin_ctzl(list->head[i]);
+    }
+
+    return BIT_NOT_FOUND;
+}
+
+//Find the first set bit after the given index. Returns its index, or BIT_NOT_FOUND if no later bit is set.
+alIndex blFindNextSet(bitList* list, alIndex index){
+    null_check(list, BIT_NOT_FOUND);
+
+    index++;
+    if(index >= list->length || index == 0) return BIT_NOT_FOUND;
+
+    //Check the rest of the current word, then scan whole words
+    alIndex word = index / WORD_BITS;
+    unsigned long bits = list->head[word] & (~0UL << (index % WORD_BITS));
+
+    alLength words = wordsFor(list->length);
+    while(bits == 0){
+        word++;
+        if(word >= words) return BIT_NOT_FOUND;
+        bits = list->head[word];
+    }
+
+    return word * WORD_BITS + __builtin_ctzl(bits);
+}
+
+
+//Apply a bitwise operation to every word of <dest> and <src>, two words at a time with SSE2 where available
+#ifdef __SSE2__
+    #define bulkOperation(dest, src, words, op, sse) \
+        alIndex i = 0; \
+        for(;i + 2 <= words;i += 2){ \
+            __m128i a = _mm_loadu_si128((__m128i*) (dest + i)); \
+            __m128i b = _mm_loadu_si128((__m128i*) (src + i)); \
+            _mm_storeu_si128((__m128i*) (dest + i), sse(a, b)); \
+        } \
+        for(;i < words;i++) dest[i] = dest[i] op src[i];
+#else
+    #define bulkOperation(dest, src, words, op, sse) \
+        for(alIndex i = 0;i < words;i++) dest[i] = dest[i] op src[i];
+#endif
+
+//Set each bit of the first list to the AND of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blAnd(bitList* dest, bitList* src){
+    null_check(dest, 1);
+    null_check(src, 1);
+
+    if(dest->length != src->length) return 1;
+
+    alLength words = wordsFor(dest->length);
+    bulkOperation(dest->head, src->head, words, &, _mm_and_si128);
+
+    return 0;
+}
+
+//Set each bit of the first list to the OR of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blOr(bitList* dest, bitList* src){
+    null_check(dest, 1);
+    null_check(src, 1);
+
+    if(dest->length != src->length) return 1;
+
+    alLength words = wordsFor(dest->length);
+    bulkOperation(dest->head, src->head, words, |, _mm_or_si128);
+
+    return 0;
+}
+
+//Set each bit of the first list to the XOR of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blXor(bitList* dest, bitList* src){
+    null_check(dest, 1);
+    null_check(src, 1);
+
+    if(dest->length != src->length) return 1;
+
+    alLength words = wordsFor(dest->length);
+    bulkOperation(dest->head, src->head, words, ^, _mm_xor_si128);
+
+    return 0;
+}
+
+
+//Destroy and de-allocate a bitList
+void blFreeBitList(bitList* list){
+    void_null_check(list);
+    free(list->head);
+    free(list);
+}
+
+//Print diagnostic information for debugging and development
+void blDiagnostics(bitList* list){
+    printf("Length: %ld\nWords Allocated: %ld\nSet Bits: %ld\nHead: %p\n",
+        blGetListLength(list), list->allocatedWords, blCount(list), (void*) blGetListHead(list)
+        );
+
+    printf("Contents:\n");
+    for(alIndex i = 0;i < list->length;i++) printf("%d", blGet(list, i));
+    printf("\n");
+}
@@ -0,0 +1,93 @@
+#ifndef BITLIST_H
+#define BITLIST_H
+
+#include "arrayList.h"
+
+#define DEFAULT_INITIAL_BIT_WORDS 4 //The default initial allocated length of a bitList, in 64-bit words
+#define BIT_NOT_FOUND ULONG_MAX //Returned by bitList search functions when no bit is found
+
+
+//Define the bitList type, a list of single bits packed into 64-bit words
+typedef struct bitArrList {
+    //Number of bits in the list
+    alLength length;
+
+    //Number of 64-bit words allocated for the list
+    alLength allocatedWords;
+
+    //Pointer to the list's words. Bit i is stored in bit (i % 64) of word (i / 64). Bits past the end of the list are always 0.
+    //This pointer is subject to change as the list grows, so it should not be referenced statically.
+    unsigned long* head;
+} bitList;
+
+
+//Create a new, empty bitList with room for at least the specified number of bits before it must grow. Returns NULL if allocation failed.
+bitList* blNewLenBitList(alLength);
+
+//Create a new, empty bitList with the default initial length. Returns NULL if allocation failed.
+bitList* blNewBitList();
+
+
+//Get a pointer to the list's words dynamically. Users should never store the head pointer statically.
+unsigned long* blGetListHead(bitList*);
+
+//Get the length of the list, in bits
+alLength blGetListLength(bitList*);
+
+
+//Get a bit by index. Returns the bit (0 or 1), or -1 for invalid inputs (bit out of bounds, etc.).
+int blGet(bitList*, alIndex);
+
+//Set a bit by index to 0 (if <bit> is 0) or 1 (otherwise). Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int blSet(bitList*, alIndex, int);
+
+
+//Insert a bit at an arbitrary index. All later bits are shifted up, a word at a time. Returns 0 for success, or 1 if the operation failed (index out of bounds, allocation failed, etc.).
+int blInsert(bitList*, alIndex, int);
+
+//Add a bit to the end of the list. Returns 0 for success, or 1 if the operation failed.
+int blAppend(bitList*, int);
+
+//Add a bit to the start of the list. Returns 0 for success, or 1 if the operation failed.
+int blPrepend(bitList*, int);
+
+
+//Remove a bit by index. All later bits are shifted down, a word at a time. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int blRemove(bitList*, alIndex);
+
+//Remove the last bit. Returns 0 for success, or 1 if the list is empty or bad.
+int blRemoveLast(bitList*);
+
+//Remove the first bit. Returns 0 for success, or 1 if the list is empty or bad.
+int blRemoveFirst(bitList*);
+
+
+//Count the set bits in the list, using the hardware population count instruction where available
+alLength blCount(bitList*);
+
+//Find the first set bit in the list. Returns its index, or BIT_NOT_FOUND if no bit is set.
+alIndex blFindFirstSet(bitList*);
+
+//Find the first set bit after the given index. Returns its index, or BIT_NOT_FOUND if no later bit is set.
+alIndex blFindNextSet(bitList*, alIndex);
+
+
+//Bulk operations combine two lists of the same length, storing the result in the first list. Each returns 0 for success, or 1 if the lengths differ or either list is bad.
+
+//Set each bit of the first list to the AND of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blAnd(bitList*, bitList*);
+
+//Set each bit of the first list to the OR of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blOr(bitList*, bitList*);
+
+//Set each bit of the first list to the XOR of the corresponding bits in both lists. Returns 0 for success, or 1 if the lists differ in length or either list is bad.
+int blXor(bitList*, bitList*);
+
+
+//Destroy and de-allocate a bitList
+void blFreeBitList(bitList*);
+
+//Print diagnostic information for debugging and development
+void blDiagnostics(bitList*);
+
+#endif
@@ -0,0 +1,287 @@
+//Expose the POSIX reader-writer lock, which strict C17 mode hides
+#define _POSIX_C_SOURCE 200809L
+
+#include "internPool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    //Only fields that are fixed when the pool is created are checked, since the slot table is replaced (under the write lock) as it grows
+    #define null_check(pool, retVal) if(pool==NULL || pool->lock==NULL) return retVal;
+    #define void_null_check(pool) if(pool==NULL || pool->lock==NULL) return;
+#else
+    #define null_check(pool, retVal)
+    #define void_null_check(pool)
+#endif
+
+//Every stored string is preceded by its length and padded so the next length is aligned
+#define ENTRY_ALIGNMENT sizeof(lstrLength)
+
+
+//A block of the arena. Stored strings are packed into <data> one after another, and are never moved or freed until the pool is.
+struct internBlock {
+    internBlock* next;
+    lstrLength size;
+    char data[];
+};
+
+//The pool's reader-writer lock
+struct internLock {
+    pthread_rwlock_t rwlock;
+};
+
+
+//Find a string in the table. Returns its stored copy, or NULL if it is not there. The caller must hold the lock.
+static const char* findSlot(const lstrInternPool* pool, unsigned long hash, const char* str, lstrLength len){
+    unsigned long mask = pool->slotCount - 1;
+
+    for(unsigned long i = hash & mask;;i = (i + 1) & mask){
+        const lstrInternSlot* slot = pool->slots + i;
+        if(slot->string == NULL) return NULL;
+
+        if(slot->hash == hash && lstrInternedLength(slot->string) == len && memcmp(slot->string, str, len) == 0) return slot->string;
+    }
+}
+
+//Place a stored string in the first free slot of its probe sequence. The caller must hold the write lock.
+static void placeSlot(lstrInternSlot* slots, unsigned long slotCount, unsigned long hash, const char* string){
+    unsigned long mask = slotCount - 1;
+    unsigned long i = hash & mask;
+
+    while(slots[i].string != NULL) i = (i + 1) & mask;
+
+    slots[i].hash = hash;
+    slots[i].string = string;
+}
+
+//Double the number of slots in the table. Returns 0 for success, or 1 if allocation failed. The caller must hold the write lock.
+static int growTable(lstrInternPool* pool){
+    unsigned long newCount = pool->slotCount * 2;
+    lstrInternSlot* newSlots = (lstrInternSlot*) calloc(newCount, sizeof(lstrInternSlot));
+    if(newSlots == NULL) return 1;
+
+    for(unsigned long i = 0; i < pool->slotCount; i++){
+        if(pool->slots[i].string != NULL) placeSlot(newSlots, newCount, pool->slots[i].hash, pool->slots[i].string);
+    }
+
+    free(pool->slots);
+    pool->slots = newSlots;
+    pool->slotCount = newCount;
+    return 0;
+}
+
+//Copy a string into the arena, after its length and before a null terminator. Returns the copy, or NULL if allocation failed. The caller must hold the write lock.
+static const char* storeString(lstrInternPool* pool, const char* str, lstrLength len){
+    //Room for the length, the bytes and the null terminator, rounded up so the next entry's length is aligned
+    if(len > MAXIMUM_STRING_BYTES - 2 * ENTRY_ALIGNMENT) return NULL;
+    lstrLength need = (sizeof(lstrLength) + len + 1 + ENTRY_ALIGNMENT - 1) & ~(ENTRY_ALIGNMENT - 1);
+
+    if(need > pool->arenaLeft){
+        lstrLength size = need > INTERN_BLOCK_BYTES ? need : INTERN_BLOCK_BYTES;
+        if(size > MAXIMUM_STRING_BYTES - sizeof(internBlock)) return NULL;
+
+        internBlock* block = (internBlock*) malloc(sizeof(internBlock) + size);
+        if(block == NULL) return NULL;
+
+        block->next = pool->blocks;
+        block->size = size;
+        pool->blocks = block;
+        pool->arenaNext = block->data;
+        pool->arenaLeft = size;
+        pool->arenaBytes += sizeof(internBlock) + size;
+    }
+
+    char* entry = pool->arenaNext;
+    memcpy(entry, &len, sizeof(lstrLength));
+
+    char* copy = entry + sizeof(lstrLength);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    pool->arenaNext += need;
+    pool->arenaLeft -= need;
+    pool->storedBytes += len;
+
+    return copy;
+}
+
+
+//Create a new, empty intern pool. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeInternPool.
+lstrInternPool* lstrNewInternPool(){
+    lstrInternPool* pool = (lstrInternPool*) malloc(sizeof(lstrInternPool));
+    if(pool == NULL) return NULL;
+
+    pool->lock = (internLock*) malloc(sizeof(internLock));
+    pool->slots = (lstrInternSlot*) calloc(INTERN_INITIAL_SLOTS, sizeof(lstrInternSlot));
+
+    if(pool->lock == NULL || pool->slots == NULL || pthread_rwlock_init(&pool->lock->rwlock, NULL) != 0){
+        free(pool->lock);
+        free(pool->slots);
+        free(pool);
+        return NULL;
+    }
+
+    pool->slotCount = INTERN_INITIAL_SLOTS;
+    pool->used = 0;
+
+    pool->blocks = NULL;
+    pool->arenaNext = NULL;
+    pool->arenaLeft = 0;
+
+    pool->lookups = 0;
+    pool->hits = 0;
+    pool->requestedBytes = 0;
+    pool->storedBytes = 0;
+    pool->arenaBytes = 0;
+
+    return pool;
+}
+
+//Intern a null-terminated string: return the pool's copy of it, adding a copy first if the pool does not have one. Returns NULL if the operation fails.
+//The returned string is null-terminated, must not be modified, and is valid until the pool is freed.
+const char* lstrIntern(lstrInternPool* pool, char* str){
+    #ifndef NO_SAFETY
+    if(str == NULL) return NULL;
+    #endif
+
+    return lstrInternLen(pool, str, strlen(str));
+}
+
+//Intern <len> bytes whose hash (from lstrHashBytes) is already known
+static const char* internHashed(lstrInternPool* pool, const char* str, lstrLength len, unsigned long hash){
+    __atomic_fetch_add(&pool->lookups, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool->requestedBytes, len, __ATOMIC_RELAXED);
+
+    //Most requests find a string that is already stored, which only needs the shared lock
+    pthread_rwlock_rdlock(&pool->lock->rwlock);
+    const char* found = findSlot(pool, hash, str, len);
+    pthread_rwlock_unlock(&pool->lock->rwlock);
+
+    if(found != NULL){
+        __atomic_fetch_add(&pool->hits, 1, __ATOMIC_RELAXED);
+        return found;
+    }
+
+    //Another thread may have stored the same string between the two locks, so look again before inserting
+    pthread_rwlock_wrlock(&pool->lock->rwlock);
+    found = findSlot(pool, hash, str, len);
+
+    if(found != NULL) __atomic_fetch_add(&pool->hits, 1, __ATOMIC_RELAXED);
+    else {
+        //Keep the table at most three quarters full, so probe sequences stay short
+        if((pool->used + 1) * 4 > pool->slotCount * 3 && growTable(pool)){
+            pthread_rwlock_unlock(&pool->lock->rwlock);
+            return NULL;
+        }
+
+        found = storeString(pool, str, len);
+        if(found != NULL){
+            placeSlot(pool->slots, pool->slotCount, hash, found);
+            pool->used++;
+        }
+    }
+
+    pthread_rwlock_unlock(&pool->lock->rwlock);
+    return found;
+}
+
+//Intern the first <len> bytes of a string, which may include '\0'. Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternLen(lstrInternPool* pool, char* str, lstrLength len){
+    null_check(pool, NULL);
+
+    #ifndef NO_SAFETY
+    if(str == NULL) return NULL;
+    #endif
+
+    return internHashed(pool, str, len, lstrHashBytes(str, len));
+}
+
+//Intern the contents of an lString (including any '\0' bytes within its length). Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternString(lstrInternPool* pool, lString* lstr){
+    null_check(pool, NULL);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL) return NULL;
+    #endif
+
+    //The string's cached hash saves rehashing strings that are interned repeatedly
+    return internHashed(pool, lstr->head, lstr->length, lstrHash(lstr));
+}
+
+//Intern the bytes in a view. Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternView(lstrInternPool* pool, lstrView view){
+    null_check(pool, NULL);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(view)) return NULL;
+    #endif
+
+    return internHashed(pool, view.data, view.length, lstrHashView(view));
+}
+
+//Get the length of an interned string (excluding the null terminator) without scanning it. The pointer must have been returned by an intern function.
+lstrLength lstrInternedLength(const char* interned){
+    lstrLength len;
+    memcpy(&len, interned - sizeof(lstrLength), sizeof(lstrLength));
+    return len;
+}
+
+
+//Get statistics for the pool, including the deduplication ratio. Returns 0 for success, or 1 if the operation fails.
+int lstrInternStatistics(lstrInternPool* pool, lstrInternStats* stats){
+    null_check(pool, 1);
+
+    #ifndef NO_SAFETY
+    if(stats == NULL) return 1;
+    #endif
+
+    //The read lock keeps the stored totals consistent with each other
+    pthread_rwlock_rdlock(&pool->lock->rwlock);
+
+    stats->lookups = __atomic_load_n(&pool->lookups, __ATOMIC_RELAXED);
+    stats->hits = __atomic_load_n(&pool->hits, __ATOMIC_RELAXED);
+    stats->uniqueStrings = pool->used;
+    stats->requestedBytes = __atomic_load_n(&pool->requestedBytes, __ATOMIC_RELAXED);
+    stats->storedBytes = pool->storedBytes;
+    stats->memoryBytes = pool->arenaBytes + pool->slotCount * sizeof(lstrInternSlot);
+
+    pthread_rwlock_unlock(&pool->lock->rwlock);
+
+    stats->dedupRatio = stats->storedBytes > 0 ? (double) stats->requestedBytes / (double) stats->storedBytes : 0;
+
+    return 0;
+}
+
+//Destroy and de-allocate an intern pool, including every string it stores
+void lstrFreeInternPool(lstrInternPool* pool){
+    void_null_check(pool);
+
+    while(pool->blocks != NULL){
+        internBlock* next = pool->blocks->next;
+        free(pool->blocks);
+        pool->blocks = next;
+    }
+
+    pthread_rwlock_destroy(&pool->lock->rwlock);
+    free(pool->lock);
+    free(pool->slots);
+    free(pool);
+}
+
+//Print diagnostic information for debugging and development
+void lstrInternDiagnostics(lstrInternPool* pool){
+    lstrInternStats stats;
+    if(lstrInternStatistics(pool, &stats)) return;
+
+    pthread_rwlock_rdlock(&pool->lock->rwlock);
+    unsigned long slotCount = pool->slotCount;
+    pthread_rwlock_unlock(&pool->lock->rwlock);
+
+    printf("Lookups: %ld\nHits: %ld\nUnique: %ld\nRequested bytes: %ld\nStored bytes: %ld\nMemory: %ld\nDedup ratio: %.2f\nSlots: %ld\n",
+        stats.lookups, stats.hits, stats.uniqueStrings, stats.requestedBytes, stats.storedBytes, stats.memoryBytes, stats.dedupRatio, slotCount
+        );
+}
@@ -0,0 +1,96 @@
+#ifndef INTERNPOOL_H
+#define INTERNPOOL_H
+
+#include "listString.h"
+
+#define INTERN_BLOCK_BYTES 65536 //The size of each block of an intern pool's arena. Longer strings get a block of their own.
+#define INTERN_INITIAL_SLOTS 1024 //The initial number of slots in an intern pool's hash table (always a power of two)
+
+
+//One slot of an intern pool's hash table. A slot is empty if <string> is NULL.
+typedef struct lstrInternSlot {
+    unsigned long hash;
+    const char* string;
+} lstrInternSlot;
+
+//A block of an intern pool's arena, and the pool's reader-writer lock. Defined in internPool.c, since users should never touch them directly.
+typedef struct internBlock internBlock;
+typedef struct internLock internLock;
+
+//Statistics for an intern pool, as reported by lstrInternStatistics
+typedef struct lstrInternStats {
+    //Number of intern requests, and how many of them found the string already in the pool
+    unsigned long lookups;
+    unsigned long hits;
+
+    //Number of distinct strings stored
+    unsigned long uniqueStrings;
+
+    //Total length of every string passed in, and of the distinct strings actually stored (both excluding null terminators)
+    lstrLength requestedBytes;
+    lstrLength storedBytes;
+
+    //Total memory held by the pool's arena and hash table
+    lstrLength memoryBytes;
+
+    //requestedBytes / storedBytes: how many times over the average stored byte has been requested (0 for an empty pool)
+    double dedupRatio;
+} lstrInternStats;
+
+
+//Define the lstrInternPool type, which stores one copy of each distinct string in a large arena and hands out pointers to it
+//Interning the same bytes always returns the same pointer, so interned strings can be compared for equality by comparing pointers. The pointers stay valid until the pool is freed.
+//Every function may be called from many threads at once: lookups share a read lock, and only inserting a new string takes the write lock.
+typedef struct internPool {
+    internLock* lock;
+
+    //Open-addressing hash table (linear probing) of stored strings, and the number of slots in use
+    lstrInternSlot* slots;
+    unsigned long slotCount;
+    unsigned long used;
+
+    //Arena blocks (most recent first), and the unused space at the end of the current block
+    internBlock* blocks;
+    char* arenaNext;
+    lstrLength arenaLeft;
+
+    //Statistics, which are updated atomically so that lookups under the read lock can count themselves
+    unsigned long lookups;
+    unsigned long hits;
+    lstrLength requestedBytes;
+    lstrLength storedBytes;
+    lstrLength arenaBytes;
+} lstrInternPool;
+
+
+//Create a new, empty intern pool. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeInternPool.
+lstrInternPool* lstrNewInternPool();
+
+//Intern a null-terminated string: return the pool's copy of it, adding a copy first if the pool does not have one. Returns NULL if the operation fails.
+//The returned string is null-terminated, must not be modified, and is valid until the pool is freed.
+const char* lstrIntern(lstrInternPool*, char*);
+
+//Intern the first <len> bytes of a string, which may include '\0'. Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternLen(lstrInternPool*, char*, lstrLength);
+
+//Intern the contents of an lString (including any '\0' bytes within its length). Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternString(lstrInternPool*, lString*);
+
+//Intern the bytes in a view. Returns the pool's null-terminated copy of them, or NULL if the operation fails.
+const char* lstrInternView(lstrInternPool*, lstrView);
+
+//Get the length of an interned string (excluding the null terminator) without scanning it. The pointer must have been returned by an intern function.
+lstrLength lstrInternedLength(const char*);
+
+
+//Get statistics for the pool, including the deduplication ratio. Returns 0 for success, or 1 if the operation fails.
+int lstrInternStatistics(lstrInternPool*, lstrInternStats*);
+
+//Destroy and de-allocate an intern pool, including every string it stores
+void lstrFreeInternPool(lstrInternPool*);
+
+//Print diagnostic information for debugging and development
+void lstrInternDiagnostics(lstrInternPool*);
+
+#endif
@@ -0,0 +1,455 @@
+#include "keywordSet.h"
+#include <stdlib.h>
+#include <string.h>
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(set, retVal) if(set==NULL || set->keywords==NULL) return retVal;
+    #define void_null_check(set) if(set==NULL || set->keywords==NULL) return;
+#else
+    #define null_check(set, retVal)
+    #define void_null_check(set)
+#endif
+
+//Compressed states with more goto edges than this are searched by binary search instead of a linear scan
+#define KEYWORD_LINEAR_EDGES 8
+
+
+//The best match found so far at one start, kept while building a replacement until no later match could start there
+typedef struct keywordSpan {
+    lstrIndex start;
+    lstrIndex end;
+    alIndex id;
+} keywordSpan;
+
+
+//Create a new, empty keyword set. Returns NULL if allocation failed.
+lstrKeywordSet* lstrNewKeywordSet(){
+    lstrKeywordSet* set = (lstrKeywordSet*) calloc(1, sizeof(lstrKeywordSet));
+    if(set == NULL) return NULL;
+
+    set->keywordBytes = lstrNewBlankString();
+    set->keywords = alNewArrayList(2 * sizeof(lstrIndex));
+
+    if(set->keywordBytes == NULL || set->keywords == NULL){
+        if(set->keywordBytes != NULL) lstrFreeString(set->keywordBytes);
+        if(set->keywords != NULL) alFreeArrayList(set->keywords);
+        free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+
+//Free every compiled table, leaving the set uncompiled
+static void freeTables(lstrKeywordSet* set){
+    free(set->delta);
+    free(set->edgeStart);
+    free(set->edgeClass);
+    free(set->edgeTarget);
+    free(set->fail);
+    free(set->firstMatch);
+    free(set->nextMatch);
+    free(set->outputLink);
+    free(set->depth);
+
+    set->delta = NULL;
+    set->edgeStart = NULL;
+    set->edgeClass = NULL;
+    set->edgeTarget = NULL;
+    set->fail = NULL;
+    set->firstMatch = NULL;
+    set->nextMatch = NULL;
+    set->outputLink = NULL;
+    set->depth = NULL;
+
+    set->compiled = 0;
+}
+
+
+//Add a null-terminated keyword to the set. Returns the keyword's ID (IDs count up from 0 in the order keywords are added), or KEYWORD_NOT_FOUND if the keyword is empty or the operation fails.
+alIndex lstrAddKeyword(lstrKeywordSet* set, char* keyword){
+    #ifndef NO_SAFETY
+    if(keyword == NULL) return KEYWORD_NOT_FOUND;
+    #endif
+
+    return lstrAddKeywordLen(set, keyword, strlen(keyword));
+}
+
+//Add the first <len> bytes of a keyword, which may include '\0', to the set. Returns the keyword's ID, or KEYWORD_NOT_FOUND if the keyword is empty or the operation fails.
+alIndex lstrAddKeywordLen(lstrKeywordSet* set, char* keyword, lstrLength len){
+    null_check(set, KEYWORD_NOT_FOUND);
+
+    #ifndef NO_SAFETY
+    if(keyword == NULL || len < 1 || alGetListLength(set->keywords) >= UINT_MAX - 1) return KEYWORD_NOT_FOUND;
+    #endif
+
+    //Record the keyword's position in the arena, then copy its bytes in
+    lstrIndex pair[2] = {set->keywordBytes->length, len};
+
+    if(alAppend(set->keywords, pair) == NULL) return KEYWORD_NOT_FOUND;
+
+    if(lstrAppendBytes(set->keywordBytes, keyword, len) == NULL){
+        alRemoveLast(set->keywords);
+        return KEYWORD_NOT_FOUND;
+    }
+
+    //The automaton no longer covers every keyword
+    freeTables(set);
+
+    return alGetListLength(set->keywords) - 1;
+}
+
+
+//Find the goto edge of a trie state for a byte class while the trie is being built. Returns the child state, or 0 if there is none.
+static unsigned int trieChild(const unsigned int* firstChild, const unsigned int* nextSibling, const unsigned short* label, unsigned int state, unsigned short class){
+    for(unsigned int child = firstChild[state];child != 0;child = nextSibling[child]){
+        if(label[child] == class) return child;
+    }
+    return 0;
+}
+
+//Compile the keyword set into its automaton. Searching compiles the set automatically if needed, so calling this is only necessary to control when the work happens. Returns 0 for success, or 1 if the set is empty or allocation failed.
+int lstrCompileKeywordSet(lstrKeywordSet* set){
+    null_check(set, 1);
+
+    if(set->compiled) return 0;
+
+    alLength keywordCount = alGetListLength(set->keywords);
+    if(keywordCount < 1) return 1;
+
+    const lstrIndex* pairs = (const lstrIndex*) alGetListHead(set->keywords);
+    const unsigned char* bytes = (const unsigned char*) set->keywordBytes->head;
+    lstrLength totalBytes = set->keywordBytes->length;
+
+    #ifndef NO_SAFETY
+    if(totalBytes >= UINT_MAX) return 1;
+    #endif
+
+    freeTables(set);
+
+    //Give each distinct keyword byte its own class. Every other byte shares class 0, which can never start or extend a match.
+    memset(set->classMap, 0, sizeof(set->classMap));
+    set->classCount = 1;
+    for(lstrIndex i = 0;i < totalBytes;i++){
+        if(set->classMap[bytes[i]] == 0) set->classMap[bytes[i]] = set->classCount++;
+    }
+
+    //The trie has at most one state per keyword byte, plus the root
+    unsigned long maxStates = totalBytes + 1;
+
+    unsigned int* firstChild = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+    unsigned int* nextSibling = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+    unsigned short* label = (unsigned short*) calloc(maxStates, sizeof(unsigned short));
+    unsigned int* queue = (unsigned int*) malloc(maxStates * sizeof(unsigned int));
+    set->firstMatch = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+    set->nextMatch = (unsigned int*) calloc(keywordCount, sizeof(unsigned int));
+    set->outputLink = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+    set->fail = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+    set->depth = (unsigned int*) calloc(maxStates, sizeof(unsigned int));
+
+    if(firstChild == NULL || nextSibling == NULL || label == NULL || queue == NULL || set->firstMatch == NULL || set->nextMatch == NULL || set->outputLink == NULL || set->fail == NULL || set->depth == NULL){
+        free(firstChild);
+        free(nextSibling);
+        free(label);
+        free(queue);
+        freeTables(set);
+        return 1;
+    }
+
+    //Build the trie, with each state's children kept as a singly linked list (state 0 is the root, so 0 also means "no child")
+    unsigned int stateCount = 1;
+    set->maxDepth = 0;
+    for(alIndex id = 0;id < keywordCount;id++){
+        const unsigned char* keyword = bytes + pairs[2 * id];
+        unsigned int state = 0;
+
+        for(lstrIndex i = 0;i < pairs[2 * id + 1];i++){
+            unsigned short class = set->classMap[keyword[i]];
+            unsigned int child = trieChild(firstChild, nextSibling, label, state, class);
+
+            if(child == 0){
+                child = stateCount++;
+                label[child] = class;
+                set->depth[child] = set->depth[state] + 1;
+                nextSibling[child] = firstChild[state];
+                firstChild[state] = child;
+            }
+
+            state = child;
+        }
+
+        if(set->depth[state] > set->maxDepth) set->maxDepth = set->depth[state];
+
+        //Chain keywords with identical bytes together
+        set->nextMatch[id] = set->firstMatch[state];
+        set->firstMatch[state] = id + 1;
+    }
+
+    set->stateCount = stateCount;
+
+    //Breadth-first traversal computes each state's failure link from its parent's, which is always nearer the root
+    unsigned long head = 0, tail = 0;
+    for(unsigned int child = firstChild[0];child != 0;child = nextSibling[child]) queue[tail++] = child;
+
+    while(head < tail){
+        unsigned int state = queue[head++];
+
+        for(unsigned int child = firstChild[state];child != 0;child = nextSibling[child]){
+            unsigned int fallback = set->fail[state];
+            unsigned int target = trieChild(firstChild, nextSibling, label, fallback, label[child]);
+
+            while(target == 0 && fallback != 0){
+                fallback = set->fail[fallback];
+                target = trieChild(firstChild, nextSibling, label, fallback, label[child]);
+            }
+
+            set->fail[child] = target;
+            set->outputLink[child] = set->firstMatch[target] != 0 ? target : set->outputLink[target];
+
+            queue[tail++] = child;
+        }
+    }
+
+    int failed = 0;
+
+    if(set->classCount <= KEYWORD_DENSE_CLASSES){
+        //Dense table: fold the failure links into a full transition row per state, so matching takes exactly one lookup per byte
+        set->dense = 1;
+        set->delta = (unsigned int*) calloc((unsigned long) stateCount * set->classCount, sizeof(unsigned int));
+
+        if(set->delta == NULL) failed = 1;
+        else {
+            for(unsigned int child = firstChild[0];child != 0;child = nextSibling[child]) set->delta[label[child]] = child;
+
+            //Each state's row starts as a copy of its failure state's row, which the breadth-first order has already filled
+            for(unsigned long i = 0;i < tail;i++){
+                unsigned int state = queue[i];
+                unsigned int* row = set->delta + (unsigned long) state * set->classCount;
+
+                memcpy(row, set->delta + (unsigned long) set->fail[state] * set->classCount, set->classCount * sizeof(unsigned int));
+                for(unsigned int child = firstChild[state];child != 0;child = nextSibling[child]) row[label[child]] = child;
+            }
+
+            //The dense table replaces the failure links
+            free(set->fail);
+            set->fail = NULL;
+        }
+    }
+    else {
+        //Compressed table: store only the goto edges, sorted by class within each state, and follow failure links at match time
+        set->dense = 0;
+        set->edgeStart = (unsigned int*) malloc((stateCount + 1UL) * sizeof(unsigned int));
+        set->edgeClass = (unsigned short*) malloc(stateCount * sizeof(unsigned short));
+        set->edgeTarget = (unsigned int*) malloc(stateCount * sizeof(unsigned int));
+
+        if(set->edgeStart == NULL || set->edgeClass == NULL || set->edgeTarget == NULL) failed = 1;
+        else {
+            unsigned int edge = 0;
+            for(unsigned int state = 0;state < stateCount;state++){
+                set->edgeStart[state] = edge;
+
+                //Insertion sort the children by class as they are copied in
+                for(unsigned int child = firstChild[state];child != 0;child = nextSibling[child]){
+                    unsigned int j = edge++;
+                    while(j > set->edgeStart[state] && set->edgeClass[j - 1] > label[child]){
+                        set->edgeClass[j] = set->edgeClass[j - 1];
+                        set->edgeTarget[j] = set->edgeTarget[j - 1];
+                        j--;
+                    }
+                    set->edgeClass[j] = label[child];
+                    set->edgeTarget[j] = child;
+                }
+            }
+            set->edgeStart[stateCount] = edge;
+        }
+    }
+
+    free(firstChild);
+    free(nextSibling);
+    free(label);
+    free(queue);
+
+    if(failed){
+        freeTables(set);
+        return 1;
+    }
+
+    set->compiled = 1;
+    return 0;
+}
+
+
+//Find the next state of a compressed automaton, following failure links until a goto edge matches (or the root is reached)
+static unsigned int compressedStep(const lstrKeywordSet* set, unsigned int state, unsigned short class){
+    while(1){
+        unsigned int low = set->edgeStart[state], high = set->edgeStart[state + 1];
+
+        //Bisect large edge lists down to a short run, then scan it
+        while(high - low > KEYWORD_LINEAR_EDGES){
+            unsigned int mid = low + (high - low) / 2;
+            if(set->edgeClass[mid] <= class) low = mid;
+            else high = mid;
+        }
+
+        for(unsigned int i = low;i < high;i++){
+            if(set->edgeClass[i] == class) return set->edgeTarget[i];
+        }
+
+        if(state == 0) return 0;
+        state = set->fail[state];
+    }
+}
+
+//Find every occurrence of every keyword in the lString in a single pass, including overlapping occurrences. Returns an arrayList of lstrKeywordMatch (which may be empty), ordered by the end of each match, or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindKeywords(lString* lstr, lstrKeywordSet* set){
+    null_check(set, NULL);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL) return NULL;
+    #endif
+
+    if(lstrCompileKeywordSet(set) != 0) return NULL;
+
+    arrayList* matches = alNewArrayList(sizeof(lstrKeywordMatch));
+    if(matches == NULL) return NULL;
+
+    const unsigned char* text = (const unsigned char*) lstr->head;
+    const lstrIndex* pairs = (const lstrIndex*) alGetListHead(set->keywords);
+    unsigned int state = 0;
+
+    for(lstrIndex i = 0;i < lstr->length;i++){
+        unsigned short class = set->classMap[text[i]];
+
+        if(set->dense) state = set->delta[(unsigned long) state * set->classCount + class];
+        else state = compressedStep(set, state, class);
+
+        //Report every keyword ending here: those at this state, then those along its output links
+        unsigned int output = set->firstMatch[state] != 0 ? state : set->outputLink[state];
+
+        while(output != 0){
+            for(unsigned int id = set->firstMatch[output];id != 0;id = set->nextMatch[id - 1]){
+                lstrKeywordMatch match = {id - 1, i + 1 - pairs[2 * (id - 1) + 1]};
+
+                if(alAppend(matches, &match) == NULL){
+                    alFreeArrayList(matches);
+                    return NULL;
+                }
+            }
+
+            output = set->outputLink[output];
+        }
+    }
+
+    return matches;
+}
+
+
+//Append a run of bytes to a replacement being built. Returns 0 for success, or 1 if the operation fails.
+static int appendRun(lString* result, const char* bytes, lstrLength len){
+    return len > 0 && lstrAppendBytes(result, (char*) bytes, len) == NULL;
+}
+
+//Decide every start before <limit>, which no later match can reach: from the first undecided start, replace the candidate at the leftmost start that has one and skip to its end, then repeat.
+//<cursor> is the end of the last replacement (everything before it has been written), and <scan> is the first start that is still undecided. Returns 0 for success, or 1 if the operation fails.
+static int replaceDecided(lString* result, const lString* lstr, const keywordSpan* candidates, lstrLength window, char** replacements, lstrIndex* cursor, lstrIndex* scan, lstrIndex limit){
+    lstrIndex start = *scan > *cursor ? *scan : *cursor;
+
+    while(start < limit){
+        const keywordSpan* candidate = candidates + start % window;
+
+        if(candidate->start != start || candidate->end <= start){
+            start++;
+            continue;
+        }
+
+        char* replacement = replacements[candidate->id];
+        if(appendRun(result, lstr->head + *cursor, start - *cursor) || (replacement != NULL && appendRun(result, replacement, strlen(replacement)))) return 1;
+
+        *cursor = candidate->end;
+        start = candidate->end;
+    }
+
+    *scan = start;
+    return 0;
+}
+
+//Build a new lString in which every keyword occurrence is replaced by <replacements>[ID]. Overlapping occurrences are resolved leftmost-first, preferring the longest keyword. Returns the new string, or NULL if the operation fails.
+//A NULL replacement removes the keyword.
+//Matches are chosen while the automaton runs, so the only scratch memory is one candidate per byte of the longest keyword, however many matches there are.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrReplaceKeywords(lString* lstr, lstrKeywordSet* set, char** replacements){
+    null_check(set, NULL);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL || replacements == NULL) return NULL;
+    #endif
+
+    if(lstrCompileKeywordSet(set) != 0) return NULL;
+
+    //A match that ends at the current position is a suffix of the current state's prefix, so every start that is still undecided lies within the last <maxDepth> bytes, and a ring of that many slots (indexed by start) holds them all
+    lstrLength window = set->maxDepth;
+    keywordSpan* candidates = (keywordSpan*) calloc(window, sizeof(keywordSpan));
+    lString* result = lstrNewBlankString();
+
+    //The result is usually about as long as the input, so reserve that much up front
+    int failed = (candidates == NULL || result == NULL || (lstr->length > 0 && lstrReserve(result, lstr->length) != 0));
+
+    const unsigned char* text = (const unsigned char*) lstr->head;
+    const lstrIndex* pairs = (const lstrIndex*) alGetListHead(set->keywords);
+    unsigned int state = 0;
+    lstrIndex cursor = 0, scan = 0;
+
+    for(lstrIndex i = 0;i < lstr->length && !failed;i++){
+        unsigned short class = set->classMap[text[i]];
+
+        if(set->dense) state = set->delta[(unsigned long) state * set->classCount + class];
+        else state = compressedStep(set, state, class);
+
+        //No match from here on can start before the current state's prefix, so every earlier start is decided
+        failed = replaceDecided(result, lstr, candidates, window, replacements, &cursor, &scan, i + 1 - set->depth[state]);
+
+        //Offer every keyword ending here as the candidate for its start, keeping the longest (then the lowest ID) at each start
+        for(unsigned int output = set->firstMatch[state] != 0 ? state : set->outputLink[state];output != 0;output = set->outputLink[output]){
+            for(unsigned int id = set->firstMatch[output];id != 0;id = set->nextMatch[id - 1]){
+                lstrIndex start = i + 1 - pairs[2 * (id - 1) + 1];
+                if(start < cursor) continue;
+
+                keywordSpan* candidate = candidates + start % window;
+                int empty = (candidate->start != start || candidate->end <= start);
+
+                if(empty || i + 1 > candidate->end || (i + 1 == candidate->end && id - 1 < candidate->id)){
+                    candidate->start = start;
+                    candidate->end = i + 1;
+                    candidate->id = id - 1;
+                }
+            }
+        }
+    }
+
+    //At the end of the string, every remaining start is decided
+    if(!failed) failed = replaceDecided(result, lstr, candidates, window, replacements, &cursor, &scan, lstr->length);
+    if(!failed) failed = appendRun(result, lstr->head + cursor, lstr->length - cursor);
+
+    free(candidates);
+
+    if(failed){
+        if(result != NULL) lstrFreeString(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+//Destroy and de-allocate a keyword set
+void lstrFreeKeywordSet(lstrKeywordSet* set){
+    void_null_check(set);
+
+    freeTables(set);
+    lstrFreeString(set->keywordBytes);
+    alFreeArrayList(set->keywords);
+    free(set);
+}
@@ -0,0 +1,95 @@
+#ifndef KEYWORDSET_H
+#define KEYWORDSET_H
+
+#include "listString.h"
+
+#define KEYWORD_NOT_FOUND ULONG_MAX //Returned by lstrAddKeyword when a keyword cannot be added
+
+//Compiled keyword sets whose alphabet has at most this many byte classes use a dense transition table; larger alphabets use a compressed (sparse) table
+#define KEYWORD_DENSE_CLASSES 64
+
+
+//One match of a keyword in a string
+typedef struct lstrKeywordMatch {
+    //ID of the matching keyword, as returned by lstrAddKeyword
+    alIndex id;
+
+    //Index of the start of the match in the string
+    lstrIndex offset;
+} lstrKeywordMatch;
+
+
+//Define the lstrKeywordSet type, a set of keywords compiled into an Aho-Corasick automaton so that every keyword can be found in a single pass over a string
+//Bytes that appear in no keyword share one byte class, so the automaton's tables only need a column per distinct keyword byte (plus one)
+typedef struct keywordSet {
+    //All keyword bytes, stored back to back
+    lString* keywordBytes;
+
+    //arrayList of lstrIndex pairs (offset into keywordBytes, then length), one pair per keyword, indexed by keyword ID
+    arrayList* keywords;
+
+    //Nonzero if the tables below reflect every added keyword
+    int compiled;
+
+    //Byte class of each byte value (0 for bytes that appear in no keyword), and the number of classes
+    unsigned short classMap[256];
+    unsigned short classCount;
+
+    //Number of automaton states (state 0 is the root)
+    unsigned int stateCount;
+
+    //Nonzero if the dense table is in use, or 0 if the compressed table is
+    int dense;
+
+    //Dense table: the next state for every (state, class) pair, with failure transitions already folded in. Indexed by state * classCount + class.
+    unsigned int* delta;
+
+    //Compressed table: the goto edges of state s are edgeClass/edgeTarget[edgeStart[s]] to [edgeStart[s + 1] - 1], sorted by class. Missing edges follow fail[s].
+    unsigned int* edgeStart;
+    unsigned short* edgeClass;
+    unsigned int* edgeTarget;
+    unsigned int* fail;
+
+    //For each state, 1 + the ID of the first keyword that ends exactly at that state (0 for none)
+    unsigned int* firstMatch;
+
+    //For each keyword, 1 + the ID of the next keyword with identical bytes (0 for none)
+    unsigned int* nextMatch;
+
+    //For each state, the nearest state along its failure chain with a nonzero firstMatch (0 for none)
+    unsigned int* outputLink;
+
+    //For each state, the length of the keyword prefix it stands for, and the length of the longest keyword
+    unsigned int* depth;
+    unsigned int maxDepth;
+} lstrKeywordSet;
+
+
+//Create a new, empty keyword set. Returns NULL if allocation failed.
+lstrKeywordSet* lstrNewKeywordSet();
+
+//Add a null-terminated keyword to the set. Returns the keyword's ID (IDs count up from 0 in the order keywords are added), or KEYWORD_NOT_FOUND if the keyword is empty or the operation fails.
+alIndex lstrAddKeyword(lstrKeywordSet*, char*);
+
+//Add the first <len> bytes of a keyword, which may include '\0', to the set. Returns the keyword's ID, or KEYWORD_NOT_FOUND if the keyword is empty or the operation fails.
+alIndex lstrAddKeywordLen(lstrKeywordSet*, char*, lstrLength);
+
+//Compile the keyword set into its automaton. Searching compiles the set automatically if needed, so calling this is only necessary to control when the work happens. Returns 0 for success, or 1 if the set is empty or allocation failed.
+int lstrCompileKeywordSet(lstrKeywordSet*);
+
+
+//Find every occurrence of every keyword in the lString in a single pass, including overlapping occurrences. Returns an arrayList of lstrKeywordMatch (which may be empty), ordered by the end of each match, or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindKeywords(lString*, lstrKeywordSet*);
+
+//Build a new lString in which every keyword occurrence is replaced by <replacements>[ID]. Overlapping occurrences are resolved leftmost-first, preferring the longest keyword. Returns the new string, or NULL if the operation fails.
+//A NULL replacement removes the keyword.
+//Matches are chosen while the automaton runs, so the only scratch memory is one candidate per byte of the longest keyword, however many matches there are.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrReplaceKeywords(lString*, lstrKeywordSet*, char**);
+
+
+//Destroy and de-allocate a keyword set
+void lstrFreeKeywordSet(lstrKeywordSet*);
+
+#endif
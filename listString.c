@@ -1,7 +1,28 @@
+//Expose POSIX file functions (open, fstat, read, mmap), which strict C17 mode hides
+#define _POSIX_C_SOURCE 200809L
+
 #include "listString.h"
+#include "arrayListFrame.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <float.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+//AVX2 kernels are compiled separately with a target attribute and chosen at run time, since the baseline x86-64 target does not assume AVX2
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+#endif
 
 //If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
 #ifndef NO_SAFETY
@@ -12,17 +33,35 @@
     #define void_null_check(lstr)
 #endif
 
+//Letters in rough order of decreasing frequency in English text, used to pick rare anchor bytes for substring search
+#define COMMON_LETTERS "etaoinshrdlcumwfgypbvkjxqz"
+
+//Bytes of candidate verification that substring search may spend per byte of haystack scanned before falling back to Two-Way (plus a fixed allowance)
+#define VERIFY_BUDGET_RATIO 2
+#define VERIFY_BUDGET_BASE 256
+
+//Bytes the UTF-8 index is extended by at a time, when a lookup needs more of the string indexed
+#define UTF8_SCAN_CHUNK 4096
+
+//Update the string's caches after <removed> bytes at <index> have been replaced by <inserted> bytes
+static void noteEdit(lString*, lstrIndex, lstrLength, lstrLength);
+
+//Update the string's line index after an edit (defined with the line functions, which share its helpers)
+static void patchLineIndex(lString*, lstrIndex, lstrLength, lstrLength);
+
 
 //Set every non-terminating character in the string (including unused ones) to a character constant
 void lstrSetString(lString* lstr, char setConstant){
     void_null_check(lstr);
     memset(lstr->head, setConstant, lstr->allocatedLength - 1);
+    noteEdit(lstr, 0, lstr->length, lstr->length);
 }
 
 //Set all characters in a lString to \0 (including unused ones and the null terminator)
 void lstrSetStringNull(lString* lstr){
     void_null_check(lstr);
     memset(lstr->head, '\0', lstr->allocatedLength);
+    noteEdit(lstr, 0, lstr->length, lstr->length);
 }
 
 //Set all post-terminator (i.e., unused) characters in a lString to \0
@@ -50,6 +89,14 @@ lString* lstrNewLenString(lstrLength allocatedLength){
     lstr->length = 0;
     lstr->allocatedLength = allocatedLength;
 
+    //The UTF-8 index is only built when it is first needed
+    lstr->utf8Index = NULL;
+    lstr->utf8Covered = 0;
+    lstr->utf8CoveredPoints = 0;
+    lstr->lineIndex = NULL;
+    lstr->generation = 0;
+    lstr->hashValid = 0;
+
     //Allocate specified initial allocated length
     lstr->head = (char*) malloc(allocatedLength);
 
@@ -77,11 +124,12 @@ lString* lstrNewString(char* str){
         ? MAXIMUM_STRING_BYTES
         : DEFAULT_INITIAL_STRING_LENGTH;
 
-    while(toAlloc < len && toAlloc < MAXIMUM_STRING_BYTES){
+    //Leave room for the null terminator
+    while(toAlloc <= len && toAlloc < MAXIMUM_STRING_BYTES){
         toAlloc *= 2;
     }
 
-    if(toAlloc < len && toAlloc < MAXIMUM_STRING_BYTES) toAlloc = MAXIMUM_STRING_BYTES;
+    if(toAlloc <= len && toAlloc < MAXIMUM_STRING_BYTES) toAlloc = MAXIMUM_STRING_BYTES;
 
     //Attempt to allocate a new string
     lString* lstr = lstrNewLenString(toAlloc);
@@ -196,6 +244,7 @@ lstrLength expandLString(lString* lstr){
 
     //Allocate and zero out new memory
     char* newHead = (char*) malloc(newAlloc);
+    if(newHead == NULL) return curAlloc;
     memset(newHead, '\0', newAlloc);
 
     //Copy data from old to new memory
@@ -204,14 +253,21 @@ lstrLength expandLString(lString* lstr){
     //Free old memory
     free(lstr->head);
 
-    //Update allocatedLength and head in lstr
+    //Update allocatedLength and head in lstr, which invalidates any views of the old buffer
     lstr->allocatedLength = newAlloc;
     lstr->head = newHead;
+    lstr->generation++;
 
     //Return new allocated size
     return newAlloc;
 }
 
+//Get the allocated length that repeated calls to expandLString would reach from <alloc> before the string could hold <len> characters (plus the null terminator)
+static lstrLength grownSize(lstrLength alloc, lstrLength len){
+    while(alloc <= len) alloc = (alloc >= MAXIMUM_STRING_BYTES / 2) ? MAXIMUM_STRING_BYTES : alloc * 2;
+    return alloc;
+}
+
 
 //Insertion operations never overwrite existing string data
 
@@ -241,6 +297,7 @@ char* lstrInsertChar(lString* lstr, lstrIndex index, char c){
 
     //Update string length
     lstr->length++;
+    noteEdit(lstr, index, 0, 1);
 
     return lstr->head + index;
 }
@@ -279,6 +336,7 @@ char* lstrInsertString(lString* lstr, lstrIndex index, char* str){
 
     //Update string length
     lstr->length += len;
+    noteEdit(lstr, index, 0, len);
 
     return insertAddr;
 }
@@ -318,6 +376,7 @@ char* lstrInsertPartial(lString* lstr, lstrIndex index, char* str, unsigned long
 
     //Update string length
     lstr->length += len;
+    noteEdit(lstr, index, 0, len);
 
     return insertAddr;
 }
@@ -343,6 +402,7 @@ char* lstrAppendChar(lString* lstr, char c){
 
     //Update string length
     lstr->length++;
+    noteEdit(lstr, lstr->length - 1, 0, 1);
 
     return insertAddr;
 }
@@ -372,6 +432,7 @@ char* lstrAppendString(lString* lstr, char* str){
 
     //Update string length
     lstr->length += len;
+    noteEdit(lstr, lstr->length - len, 0, len);
 
     return insertAddr;
 }
@@ -402,10 +463,288 @@ char* lstrAppendPartial(lString* lstr, char* str, unsigned long len){
 
     //Update string length
     lstr->length += len;
+    noteEdit(lstr, lstr->length - len, 0, len);
+
+    return insertAddr;
+}
+
+//Insert exactly <len> bytes (which may include '\0') at the end of the string, without measuring the input with strlen. Returns a pointer to the start of the copy of the input, or NULL for a failed operation (including cases where len < 1).
+char* lstrAppendBytes(lString* lstr, char* bytes, lstrLength len){
+    null_check(lstr, NULL);
+
+    if(len < 1) return NULL;
+
+    #ifndef NO_SAFETY
+    if(len > MAXIMUM_STRING_BYTES - 1 - lstr->length) return NULL;
+    #endif
+
+    //Expand list if necessary
+    while(lstr->allocatedLength - (lstr->length + 1) < len){
+        lstrLength oldLen = lstr->allocatedLength;
+        if(expandLString(lstr) <= oldLen) return NULL;
+    }
+
+    //Get the insertion address
+    char* insertAddr = lstr->head + lstr->length;
+
+    //Copy the new bytes into place. The unused characters after them are already '\0'.
+    memcpy(insertAddr, bytes, len);
+
+    //Update string length
+    lstr->length += len;
+    noteEdit(lstr, lstr->length - len, 0, len);
+
+    return insertAddr;
+}
+
+//Expand the string, if necessary, until it can hold at least <len> characters (plus the null terminator) without re-allocating. Returns 0 for success, or 1 if the operation fails.
+int lstrReserve(lString* lstr, lstrLength len){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(len > MAXIMUM_STRING_BYTES - 1) return 1;
+    #endif
+
+    if(lstr->allocatedLength - 1 >= len) return 0;
+
+    //Find the doubled size that fits, so the string is re-allocated (and copied) only once
+    lstrLength newAlloc = grownSize(lstr->allocatedLength, len);
+
+    char* newHead = (char*) realloc(lstr->head, newAlloc);
+    if(newHead == NULL) return 1;
+
+    //Zero out the new memory, since every unused character must be '\0'
+    memset(newHead + lstr->allocatedLength, '\0', newAlloc - lstr->allocatedLength);
+
+    lstr->head = newHead;
+    lstr->allocatedLength = newAlloc;
+    lstr->generation++;
+
+    return 0;
+}
+
+//Pairs of decimal digits for every value from 0 to 99, so integers can be converted two digits at a time
+static const char digitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+//lstrAppendDouble writes values from 1e-4 (inclusive) up to 2^53 (exclusive) in fixed notation
+#define FIXED_DOUBLE_MIN 1e-4
+#define FIXED_DOUBLE_LIMIT 9007199254740992.0
+
+//Count the decimal digits of an unsigned integer
+static int decimalDigits(unsigned long value){
+    int digits = 1;
+    while(value >= 10000){
+        value /= 10000;
+        digits += 4;
+    }
+    if(value >= 1000) return digits + 3;
+    if(value >= 100) return digits + 2;
+    if(value >= 10) return digits + 1;
+    return digits;
+}
+
+//Write the <digits> decimal digits of <value> backwards, ending just before <end>
+static void writeDigits(char* end, unsigned long value, int digits){
+    while(digits >= 2){
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        *--end = digitPairs[pair + 1];
+        *--end = digitPairs[pair];
+        digits -= 2;
+    }
+    if(digits == 1) *--end = (char) ('0' + value);
+}
+
+//Append an optional minus sign followed by the decimal digits of <magnitude>, with a decimal point placed <decimals> digits from the right (no point if <decimals> is 0). Returns a pointer to the start of the appended text, or NULL for a failed operation.
+static char* appendDecimal(lString* lstr, int negative, unsigned long magnitude, int decimals){
+    int digits = decimalDigits(magnitude);
+
+    //Values below 1 need a leading "0." and zero padding before their digits
+    int width = (digits > decimals) ? digits : decimals + 1;
+    lstrLength len = negative + width + (decimals > 0);
+
+    #ifndef NO_SAFETY
+    if(len > MAXIMUM_STRING_BYTES - 1 - lstr->length) return NULL;
+    #endif
+
+    if(lstrReserve(lstr, lstr->length + len)) return NULL;
+
+    char* start = lstr->head + lstr->length;
+    char* end = start + len;
+    if(negative) *start = '-';
+
+    if(decimals > 0){
+        //Split off the fraction (all of the digits, if the value is below 1), padding it with zeros if it has fewer digits than decimals
+        unsigned long fraction = magnitude;
+        if(digits > decimals){
+            unsigned long scale = 1;
+            for(int i = 0; i < decimals; i++) scale *= 10;
+            fraction = magnitude % scale;
+            magnitude /= scale;
+        }
+        else magnitude = 0;
+
+        memset(end - decimals, '0', decimals);
+        writeDigits(end, fraction, (fraction == 0) ? 0 : decimalDigits(fraction));
+        end -= decimals;
+        *--end = '.';
+        digits = decimalDigits(magnitude);
+    }
+    writeDigits(end, magnitude, digits);
+
+    lstr->length += len;
+    noteEdit(lstr, lstr->length - len, 0, len);
+
+    return start;
+}
+
+#ifdef __SIZEOF_INT128__
+//Find the shortest fixed-notation form of a positive double below 2^53: the fewest <decimals> such that some integer <digits> * 10^-decimals reads back as exactly the same double. Returns 0 for success, or 1 if no form with at most 17 significant digits was found.
+//The double is exactly f * 2^-s for integers f and s, so each candidate is computed and checked exactly in 128-bit integer arithmetic instead of with floating-point operations that would themselves round.
+static int shortestFixed(double value, unsigned long* digits, int* decimals){
+    unsigned long bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    //Values in the fixed range are always normal, so the mantissa has an implicit leading 1 bit
+    unsigned long f = (bits & ((1UL << 52) - 1)) | (1UL << 52);
+    int s = 1075 - (int) ((bits >> 52) & 0x7FF);
+    if(s <= 0){
+        *digits = f << -s;
+        *decimals = 0;
+        return 0;
+    }
+
+    //Reading a decimal back rounds it to the nearest double (ties to an even mantissa, and f is even exactly when ties round to it), so a candidate round-trips when it lies within half a gap of the value
+    //The gap below a power of two is half the size of the gap above it
+    int evenMantissa = (f & 1) == 0;
+    int lowerBoundary = f == (1UL << 52);
+
+    unsigned __int128 scale = 1;
+    for(int d = 0; d <= 17 + 4; d++, scale *= 10){
+        unsigned __int128 exact = (unsigned __int128) f * scale;
+        unsigned __int128 candidate = exact >> s;
+        unsigned __int128 remainder = exact - (candidate << s);
+
+        //Round the candidate to the nearest integer
+        if(remainder > ((unsigned __int128) 1 << (s - 1))) candidate++;
+
+        for(int attempt = 0; attempt < 2; attempt++, candidate++){
+            //The distance from the value, scaled by 10^d * 2^s so that it is an integer
+            unsigned __int128 scaled = candidate << s;
+            int below = scaled < exact;
+            unsigned __int128 distance = below ? exact - scaled : scaled - exact;
+
+            //A candidate within half a gap of the value satisfies 2 * distance < 10^d (or 4 * distance below a power of two)
+            unsigned __int128 limit = (below && lowerBoundary) ? distance * 4 : distance * 2;
+            if(limit < scale || (limit == scale && evenMantissa)){
+                if(candidate >= 1000000000000000000UL) return 1;
+                *digits = (unsigned long) candidate;
+                *decimals = d;
+                return 0;
+            }
+
+            //Only a value just above a power of two can have a round-tripping candidate on the far side of the nearest one
+            if(!(below && lowerBoundary)) break;
+        }
+    }
+
+    return 1;
+}
+#endif
+
+//Append printf-style formatted text to the end of the string. The text is formatted directly into the string's unused space, which is expanded only if the text does not fit. Returns a pointer to the start of the appended text, or NULL for a failed operation (including cases where the formatted text is empty).
+//The arguments must not point into the string itself, since formatting writes into the same buffer.
+char* lstrAppendFormat(lString* lstr, const char* format, ...){
+    null_check(lstr, NULL);
+
+    va_list args;
+    va_start(args, format);
+
+    //Try to format into the space that is already allocated (vsnprintf always leaves room for the null terminator)
+    lstrLength spare = lstr->allocatedLength - lstr->length;
+    va_list retry;
+    va_copy(retry, args);
+    int written = vsnprintf(lstr->head + lstr->length, spare, format, args);
+    va_end(args);
+
+    if(written < 1 || (lstrLength) written > MAXIMUM_STRING_BYTES - 1 - lstr->length){
+        //Restore the unused characters to '\0' after a truncated or failed attempt
+        memset(lstr->head + lstr->length, '\0', spare);
+        va_end(retry);
+        return NULL;
+    }
+
+    lstrLength len = (lstrLength) written;
+    if(len >= spare){
+        //The text was truncated, so grow the string once to fit it and format it again
+        memset(lstr->head + lstr->length, '\0', spare);
+        if(lstrReserve(lstr, lstr->length + len)){
+            va_end(retry);
+            return NULL;
+        }
+        vsnprintf(lstr->head + lstr->length, len + 1, format, retry);
+    }
+    va_end(retry);
+
+    char* insertAddr = lstr->head + lstr->length;
+    lstr->length += len;
+    noteEdit(lstr, lstr->length - len, 0, len);
 
     return insertAddr;
 }
 
+//Append the decimal representation of a signed integer to the end of the string, without going through printf. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+char* lstrAppendInt(lString* lstr, long value){
+    null_check(lstr, NULL);
+
+    //Negate in unsigned arithmetic so that LONG_MIN does not overflow
+    unsigned long magnitude = (value < 0) ? 0UL - (unsigned long) value : (unsigned long) value;
+    return appendDecimal(lstr, value < 0, magnitude, 0);
+}
+
+//Append the decimal representation of an unsigned integer to the end of the string, without going through printf. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+char* lstrAppendUint(lString* lstr, unsigned long value){
+    null_check(lstr, NULL);
+    return appendDecimal(lstr, 0, value, 0);
+}
+
+//Append the shortest decimal representation of a double that reads back (with strtod) as exactly the same value. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+//Values from 1e-4 up to 2^53 are written in fixed notation without going through printf; all other values are written in printf's %g style. Infinities and NaNs are written as printf writes them.
+char* lstrAppendDouble(lString* lstr, double value){
+    null_check(lstr, NULL);
+
+    if(isfinite(value)){
+        int negative = signbit(value) != 0;
+        double magnitude = negative ? -value : value;
+
+        if(magnitude == 0) return appendDecimal(lstr, negative, 0, 0);
+
+        #ifdef __SIZEOF_INT128__
+        unsigned long digits;
+        int decimals;
+        if(magnitude >= FIXED_DOUBLE_MIN && magnitude < FIXED_DOUBLE_LIMIT && shortestFixed(magnitude, &digits, &decimals) == 0){
+            return appendDecimal(lstr, negative, digits, decimals);
+        }
+        #endif
+    }
+
+    //Fall back to printf, using the fewest significant digits (from 15, which always suffice for normal values with a short form, up to 17, which always round-trip) that read back exactly
+    //Subnormal values carry fewer significant bits, so their search starts from a single digit
+    char buffer[32];
+    int written = 0;
+    int first = (value > -DBL_MIN && value < DBL_MIN) ? 1 : 15;
+    for(int precision = first; precision <= 17; precision++){
+        written = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if(!isfinite(value) || strtod(buffer, NULL) == value) break;
+    }
+    if(written < 1 || written >= (int) sizeof(buffer)) return NULL;
+
+    return lstrAppendBytes(lstr, buffer, (lstrLength) written);
+}
+
 //Insert a character at the start of the string. Returns a pointer to the element, or NULL for a failed operation
 char* lstrPrependChar(lString* lstr, char c){
     return lstrInsertChar(lstr, 0, c);
@@ -444,6 +783,7 @@ int lstrRemoveChar(lString* lstr, lstrIndex index){
 
     //Update string length
     lstr->length--;
+    noteEdit(lstr, index, 1, 0);
 
     return 0;
 }
@@ -465,6 +805,7 @@ int lstrRemoveLastChar(lString* lstr){
 
     //Update string length
     lstr->length--;
+    noteEdit(lstr, lstr->length, 1, 0);
 
     return 0;
 
@@ -498,6 +839,7 @@ int lstrRemoveString(lString* lstr, lstrIndex index, lstrLength len){
     
     //Update string length
     lstr->length -= len;
+    noteEdit(lstr, index, len, 0);
 
     return 0;
 }
@@ -516,6 +858,7 @@ int lstrRemoveLastString(lString* lstr, lstrLength len){
 
     //Update string length
     lstr->length -= len;
+    noteEdit(lstr, lstr->length, len, 0);
 
     return 0;
 }
@@ -526,254 +869,2659 @@ int lstrRemoveFirstString(lString* lstr, lstrLength len){
 }
 
 
-//Find the first instance of a given character in the lString. Returns the index of the character, or MAXIMUM_STRING_BYTES on a failed operation. Note that MAXIMUM_STRING_BYTES, as an index, will always either be unused or contain the null terminator, never an actual member of the string.
-lstrIndex lstrFindChar(lString* lstr, char c){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
-
-    //Iterate over the string
-    for(lstrIndex i = 0;i < lstr->length;i++){
-        if(lstr->head[i] == c) return i;
-    }
+//Substring search scans for a pair of rare "anchor" bytes from the needle 16 positions at a time, verifying each candidate with memcmp.
+//If candidates keep failing (e.g., on repetitive input), the search falls back to the Two-Way algorithm, so the worst case is linear. Searches respect the string's length rather than stopping at a '\0'.
 
-    return MAXIMUM_STRING_BYTES;
-}
 
-//Find the first instance of a given string in the lString. Returns the index of the start of the matching string, or MAXIMUM_STRING_BYTES on a failed operation (including cases where the input string is empty).
-lstrIndex lstrFindString(lString* lstr, char* str){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
+//Estimate how common a byte is in typical text. Lower scores are rarer.
+static int byteCommonness(unsigned char c){
+    if(c == ' ') return 100;
 
-    //Get length of search string
-    lstrLength len = strlen(str);
+    //Lowercase letters score by their English frequency
+    if(c >= 'a' && c <= 'z') return 90 - (int) (strchr(COMMON_LETTERS, c) - COMMON_LETTERS);
+    if(c >= 'A' && c <= 'Z') return 40 - (int) (strchr(COMMON_LETTERS, c + 32) - COMMON_LETTERS);
+    if(c >= '0' && c <= '9') return 45;
+    if(c == '\n' || c == ',' || c == '.' || c == '\t') return 50;
+    if(c >= 0x20 && c < 0x7F) return 10;
 
-    //Sanity check
-    if(len > lstr->length || len < 1) return MAXIMUM_STRING_BYTES;
+    //Control characters and non-ASCII bytes are rarest
+    return 0;
+}
 
-    //Search lstr for str
-    for(lstrIndex i = 0;i <= lstr->length - len;i++){
-        for(lstrIndex j = 0;j < len;j++){
-            if(lstr->head[i + j] != str[j]) break;
-            else if(j == len-1) return i;
+//Compute the critical factorization of the needle for the Two-Way algorithm (Crochemore and Perrin). Returns the split position and stores the period of the right half.
+//The maximal suffix is computed for both byte orderings, and the later of the two is used. Index arithmetic intentionally wraps at ULONG_MAX, which stands in for -1.
+static lstrIndex criticalFactorization(const unsigned char* needle, lstrLength len, lstrLength* period){
+    lstrIndex maxSuffix = ULONG_MAX;
+    lstrIndex j = 0;
+    lstrLength k = 1;
+    lstrLength p = 1;
+
+    //Maximal suffix for the natural byte order
+    while(j + k < len){
+        unsigned char a = needle[j + k];
+        unsigned char b = needle[maxSuffix + k];
+        if(a < b){
+            j += k;
+            k = 1;
+            p = j - maxSuffix;
+        } else if(a == b){
+            if(k != p) k++;
+            else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            maxSuffix = j++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+
+    //Maximal suffix for the reversed byte order
+    lstrIndex maxSuffixRev = ULONG_MAX;
+    j = 0;
+    k = p = 1;
+    while(j + k < len){
+        unsigned char a = needle[j + k];
+        unsigned char b = needle[maxSuffixRev + k];
+        if(b < a){
+            j += k;
+            k = 1;
+            p = j - maxSuffixRev;
+        } else if(a == b){
+            if(k != p) k++;
+            else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            maxSuffixRev = j++;
+            k = p = 1;
         }
     }
 
-    return MAXIMUM_STRING_BYTES;
+    if(maxSuffixRev + 1 < maxSuffix + 1) return maxSuffix + 1;
+
+    *period = p;
+    return maxSuffixRev + 1;
 }
 
+//Fill in a search pattern for a needle of the given length. The needle must not be empty, and it is not copied.
+static void planSearch(lstrPattern* plan, const char* needle, lstrLength len){
+    const unsigned char* n = (const unsigned char*) needle;
 
-//Replace the first instance of one character in the string with a new character. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails (but not if the operation simply makes no replacements).
-lstrLength lstrReplaceChar(lString* lstr, char old, char new){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
+    plan->needle = needle;
+    plan->length = len;
 
-    //Iterate over the string and replace the first instance of old with new
-    for(lstrIndex i = 0;i < lstr->length;i++){
-        if(lstr->head[i] == old){
-            lstr->head[i] = new;
-            return 1;
-        }
+    //Pick the rarest byte as the first anchor, and the rarest byte with a different value (or, failing that, at a different offset) as the second
+    plan->anchorOffset1 = 0;
+    for(lstrIndex i = 1;i < len;i++){
+        if(byteCommonness(n[i]) < byteCommonness(n[plan->anchorOffset1])) plan->anchorOffset1 = i;
     }
 
-    return 0;
-}
+    plan->anchorOffset2 = plan->anchorOffset1 == 0 ? len - 1 : 0;
+    for(lstrIndex i = 0;i < len;i++){
+        if(i == plan->anchorOffset1) continue;
 
-//Replace all instances of one character in the string with a new character. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails (but not if the operation simply makes no replacements).
-lstrLength lstrReplaceCharAll(lString* lstr, char old, char new){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
+        int better = byteCommonness(n[i]) < byteCommonness(n[plan->anchorOffset2]);
+        int distinct = n[i] != n[plan->anchorOffset1];
+        int curDistinct = n[plan->anchorOffset2] != n[plan->anchorOffset1];
+        if((distinct && !curDistinct) || (distinct == curDistinct && better)) plan->anchorOffset2 = i;
+    }
 
-    //Ignore redundant replacement
-    if(old == new) return 0;
+    plan->anchor1 = n[plan->anchorOffset1];
+    plan->anchor2 = n[plan->anchorOffset2];
 
-    //Iterate over the string and replace all instances of old with new
-    lstrLength replaced = 0;
-    for(lstrIndex i = 0;i < lstr->length;i++){
-        if(lstr->head[i] == old){
-            lstr->head[i] = new;
-            replaced++;
+    //Precompute the Two-Way factorization for the fallback
+    plan->suffix = criticalFactorization(n, len, &plan->period);
+    plan->periodic = memcmp(n, n + plan->period, plan->suffix) == 0;
+    if(!plan->periodic) plan->period = (plan->suffix > len - plan->suffix ? plan->suffix : len - plan->suffix) + 1;
+}
+
+//Search for a pattern with the Two-Way algorithm, which runs in linear time and constant space. Returns the index of the first match, or MAXIMUM_STRING_BYTES if there is none.
+static lstrIndex twoWaySearch(const lstrPattern* plan, const char* haystack, lstrLength hayLen){
+    const unsigned char* n = (const unsigned char*) plan->needle;
+    const unsigned char* h = (const unsigned char*) haystack;
+    lstrLength len = plan->length;
+    lstrIndex suffix = plan->suffix;
+    lstrIndex j = 0;
+
+    if(plan->periodic){
+        //<memory> records how much of the needle's prefix is already known to match after a shift by the period
+        lstrLength memory = 0;
+        while(j + len <= hayLen){
+            lstrIndex i = suffix > memory ? suffix : memory;
+            while(i < len && n[i] == h[i + j]) i++;
+
+            if(i >= len){
+                i = suffix - 1;
+                while(memory < i + 1 && n[i] == h[i + j]) i--;
+                if(i + 1 < memory + 1) return j;
+
+                j += plan->period;
+                memory = len - plan->period;
+            } else {
+                j += i - suffix + 1;
+                memory = 0;
+            }
+        }
+    } else {
+        while(j + len <= hayLen){
+            lstrIndex i = suffix;
+            while(i < len && n[i] == h[i + j]) i++;
+
+            if(i >= len){
+                i = suffix - 1;
+                while(i != ULONG_MAX && n[i] == h[i + j]) i--;
+                if(i == ULONG_MAX) return j;
+
+                j += plan->period;
+            } else {
+                j += i - suffix + 1;
+            }
         }
     }
 
-    return replaced;
+    return MAXIMUM_STRING_BYTES;
 }
 
-//Replace the first instance of one substring with a new substring. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
-lstrLength lstrReplaceString(lString* lstr, char* old, char* new){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
-
-    //Get string lengths
-    lstrLength oldLen = strlen(old);
-    lstrLength newLen = strlen(new);
-
-    //Ignore empty old strings
-    if(oldLen < 1) return 0;
+//Search for a pattern in a haystack of the given length, starting at index <from>. Returns the index of the first match, or MAXIMUM_STRING_BYTES if there is none.
+static lstrIndex runSearch(const lstrPattern* plan, const char* haystack, lstrLength hayLen, lstrIndex from){
+    lstrLength len = plan->length;
 
-    //Find the first instance of the old string, if applicable
-    lstrIndex index = lstrFindString(lstr, old);
+    if(from > hayLen || len > hayLen - from) return MAXIMUM_STRING_BYTES;
 
-    //If the old string is even present, find it
-    if(index != MAXIMUM_STRING_BYTES){
-        //Compute useful values
-        char* indexAddr = lstr->head + index;
-        lstrLength laterBytes = lstr->length + 1 - (index + oldLen);
+    //Single bytes are best handled by the C library's vectorized memchr
+    if(len == 1){
+        const char* found = (const char*) memchr(haystack + from, plan->needle[0], hayLen - from);
+        return found == NULL ? MAXIMUM_STRING_BYTES : (lstrIndex) (found - haystack);
+    }
 
-        //Replace strings, with possible string expansion
-        if(newLen == 0){
-            return lstrRemoveString(lstr, index, oldLen) == 0 ? 1 : MAXIMUM_STRING_BYTES;
-        } else if(newLen > oldLen){
-            //Allocate new space as needed
-            while(lstr->allocatedLength - (lstr->length + 1) < newLen - oldLen){
-                lstrLength oldLen = lstr->allocatedLength;
-                if(expandLString(lstr) <= oldLen) return MAXIMUM_STRING_BYTES;
+    lstrIndex pos = from;
+    lstrIndex last = hayLen - len; //The last possible match position
+    unsigned long verifyWork = 0;
+
+    #ifdef __SSE2__
+    const __m128i a1 = _mm_set1_epi8((char) plan->anchor1);
+    const __m128i a2 = _mm_set1_epi8((char) plan->anchor2);
+
+    //Check 16 candidate positions at a time, as long as all 16 are possible match positions
+    while(pos + 15 <= last){
+        __m128i block1 = _mm_loadu_si128((const __m128i*) (haystack + pos + plan->anchorOffset1));
+        __m128i block2 = _mm_loadu_si128((const __m128i*) (haystack + pos + plan->anchorOffset2));
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, a1), _mm_cmpeq_epi8(block2, a2)));
+
+        while(mask != 0){
+            lstrIndex candidate = pos + __builtin_ctz(mask);
+            if(memcmp(haystack + candidate, plan->needle, len) == 0) return candidate;
+
+            //Fall back to Two-Way if verification is costing too much
+            verifyWork += len;
+            if(verifyWork > VERIFY_BUDGET_RATIO * (candidate - from) + VERIFY_BUDGET_BASE){
+                lstrIndex found = twoWaySearch(plan, haystack + candidate, hayLen - candidate);
+                return found == MAXIMUM_STRING_BYTES ? found : candidate + found;
             }
-            
-            //Update string length
-            lstr->length += (newLen - oldLen);
 
-        } else {
-            //Update string length
-            lstr->length -= (oldLen - newLen);
+            mask &= mask - 1;
         }
 
-        //Move up all bytes that fall after the old string
-        memmove(indexAddr + newLen, indexAddr + oldLen, laterBytes);
+        pos += 16;
+    }
+    #endif
 
-        //Copy the new string into position
-        memmove(indexAddr, new, newLen);
+    //Check the remaining positions one at a time
+    for(;pos <= last;pos++){
+        if((unsigned char) haystack[pos + plan->anchorOffset1] != plan->anchor1) continue;
+        if((unsigned char) haystack[pos + plan->anchorOffset2] != plan->anchor2) continue;
+        if(memcmp(haystack + pos, plan->needle, len) == 0) return pos;
 
-        return 1;
-    //If we make no replacement, return 0
-    } else {
-        return 0;
+        verifyWork += len;
+        if(verifyWork > VERIFY_BUDGET_RATIO * (pos - from) + VERIFY_BUDGET_BASE){
+            lstrIndex found = twoWaySearch(plan, haystack + pos, hayLen - pos);
+            return found == MAXIMUM_STRING_BYTES ? found : pos + found;
+        }
     }
-}
 
-//Replace all instances of one substring with a new substring. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
-lstrLength lstrReplaceStringAll(lString* lstr, char* old, char* new){
-    null_check(lstr, MAXIMUM_STRING_BYTES);
+    return MAXIMUM_STRING_BYTES;
+}
 
-    //Get string lengths
-    lstrLength oldLen = strlen(old);
-    lstrLength newLen = strlen(new);
 
-    //Ignore empty old strings
-    if(oldLen < 1) return 0;
+//Byte scanners shared by the finding, counting and line functions. Each compares 16 bytes at a time, then either sums the matches or turns the match mask into positions.
 
-    //Track replacements
-    lstrLength replaced = 0;
+//Positions found by a scan are collected in a stack batch of this many and appended to the output list together
+#define SCAN_BATCH_OFFSETS 256
 
-    //Make a copy of the original lString. We will perform operations on this new string.
-    lString* copy = lstrNewString(lstr->head);
+//Count the instances of a byte in <len> bytes of memory
+static lstrLength countByte(const char* str, lstrLength len, char c){
+    lstrLength count = 0;
+    lstrIndex i = 0;
 
-    //Find (as a pointer) the first instance of the old string, if applicable
-    char* indexAddr = strstr(copy->head, old);
+    #ifdef __SSE2__
+    const __m128i target = _mm_set1_epi8(c);
 
-    //If the old string is even present, find it
-    while(indexAddr != NULL){
-        //Compute useful values
-        lstrIndex index = (lstrIndex) (indexAddr - copy->head);
-        lstrLength laterBytes = copy->length + 1 - (index + oldLen);
+    //Count matches in per-byte counters, as countPoints does
+    while(i + 16 <= len){
+        __m128i counters = _mm_setzero_si128();
 
-        //Replace strings, with possible string expansion
-        if(newLen == 0){
-            int rem = lstrRemoveString(copy, index, oldLen);
+        for(int block = 0;block < 255 && i + 16 <= len;block++, i += 16){
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (str + i)), target));
+        }
 
-            //If removal fails, free everything and return an error
-            if(rem == 1){
-                lstrFreeString(copy);
-                return MAXIMUM_STRING_BYTES;
-            }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += (lstrLength) _mm_cvtsi128_si32(sums) + (lstrLength) _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    #endif
 
-            //Otherwise, skip extraneous remaining steps
-            replaced++;
-            
-            //Search forward for the old string
-            indexAddr = strstr(indexAddr, old);
-            continue;
+    for(;i < len;i++) count += (str[i] == c);
 
-        } else if(newLen > oldLen){
-            //Allocate new space as needed
-            while(copy->allocatedLength - (copy->length + 1) < newLen - oldLen){
-                lstrLength oldAllocLen = copy->allocatedLength;
-                if(expandLString(copy) <= oldAllocLen){
-                    //If we ran out of space, free everything and return the error code
-                    lstrFreeString(copy);
-                    return MAXIMUM_STRING_BYTES;
-                }
-            }
-            //Move indexAddr to the corresponding location in the new string
-            indexAddr = copy->head + index;
-            
-            //Update string length
-            copy->length += (newLen - oldLen);
+    return count;
+}
 
-        } else {
-            //Update string length
-            copy->length -= (oldLen - newLen);
-        }
+//Append the position of every instance of a byte in bytes <from> to <end> - 1 to <out>, an arrayList of lstrIndex. Returns 0 for success, or 1 if allocation failed.
+static int scanByte(const char* str, lstrIndex from, lstrIndex end, char c, arrayList* out){
+    lstrIndex batch[SCAN_BATCH_OFFSETS];
+    int batched = 0;
+    lstrIndex i = from;
 
-        //Move up/back all bytes that fall after the old string
-        memmove(indexAddr + newLen, indexAddr + oldLen, laterBytes);
+    #ifdef __SSE2__
+    const __m128i target = _mm_set1_epi8(c);
 
-        //Copy the new string into position
-        memmove(indexAddr, new, newLen);
+    for(;i + 16 <= end;i += 16){
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (str + i)), target));
 
-        replaced++;
+        while(mask != 0){
+            batch[batched++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
 
-        //Search for the old string, starting from the end of the area we have already searched
-        //This is necessary for overlapping new/old strings, such as replacing "." with ".."
-        indexAddr = strstr(indexAddr + newLen, old);
+            if(batched == SCAN_BATCH_OFFSETS){
+                if(alAppendMany(out, batch, batched) == NULL) return 1;
+                batched = 0;
+            }
+        }
     }
+    #endif
 
-    //At this point, we have performed all the replacements, and the copy has all of the right data. Overwrite the original.
-    lstrOverwrite(lstr, copy->head);
+    for(;i < end;i++){
+        if(str[i] != c) continue;
 
-    //Delete the copy
-    lstrFreeString(copy);
+        batch[batched++] = i;
+        if(batched == SCAN_BATCH_OFFSETS){
+            if(alAppendMany(out, batch, batched) == NULL) return 1;
+            batched = 0;
+        }
+    }
 
-    return replaced;
+    return (batched > 0 && alAppendMany(out, batch, batched) == NULL) ? 1 : 0;
 }
 
 
-//For ASCII characters only, return a copy of the string where all alphabetical characters are UPPERCASE. Returns a pointer to the new string, or NULL if the operation fails. The returned string may be empty.
+//Find the first instance of a given character in the lString. Returns the index of the character, or MAXIMUM_STRING_BYTES on a failed operation. Note that MAXIMUM_STRING_BYTES, as an index, will always either be unused or contain the null terminator, never an actual member of the string.
+lstrIndex lstrFindChar(lString* lstr, char c){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //memchr scans many bytes at a time and, unlike strchr, respects the string's length
+    char* found = (char*) memchr(lstr->head, c, lstr->length);
+
+    return found == NULL ? MAXIMUM_STRING_BYTES : (lstrIndex) (found - lstr->head);
+}
+
+//Find the first instance of a given string in the lString. Returns the index of the start of the matching string, or MAXIMUM_STRING_BYTES on a failed operation (including cases where the input string is empty).
+lstrIndex lstrFindString(lString* lstr, char* str){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Get length of search string
+    lstrLength len = strlen(str);
+
+    //Sanity check
+    if(len > lstr->length || len < 1) return MAXIMUM_STRING_BYTES;
+
+    lstrPattern plan;
+    planSearch(&plan, str, len);
+
+    return runSearch(&plan, lstr->head, lstr->length, 0);
+}
+
+//Find the first instance of a given character at or after index <from>. Returns the index of the character, or MAXIMUM_STRING_BYTES if there is none or the operation fails.
+lstrIndex lstrFindCharFrom(lString* lstr, char c, lstrIndex from){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(from >= lstr->length) return MAXIMUM_STRING_BYTES;
+
+    char* found = (char*) memchr(lstr->head + from, c, lstr->length - from);
+
+    return found == NULL ? MAXIMUM_STRING_BYTES : (lstrIndex) (found - lstr->head);
+}
+
+//Find the first instance of a given string that starts at or after index <from>. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES if there is none or the operation fails (including cases where the input string is empty).
+lstrIndex lstrFindStringFrom(lString* lstr, char* str, lstrIndex from){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    #ifndef NO_SAFETY
+    if(str == NULL) return MAXIMUM_STRING_BYTES;
+    #endif
+
+    lstrLength len = strlen(str);
+    if(len < 1) return MAXIMUM_STRING_BYTES;
+
+    lstrPattern plan;
+    planSearch(&plan, str, len);
+
+    return runSearch(&plan, lstr->head, lstr->length, from);
+}
+
+
+//Counting and bulk finding make one pass over the string: single bytes go through the byte scanners, and longer needles are planned once and searched from each match to the next
+
+//Find every instance of a byte from index <from>. Returns an arrayList of lstrIndex (which may be empty), or NULL if allocation failed.
+//Counting first is several times faster than scanning, and lets the list be allocated once at its exact size instead of being doubled (and zeroed and copied) as it fills.
+static arrayList* collectByte(const char* haystack, lstrLength hayLen, lstrIndex from, char c){
+    arrayList* matches = alNewLenArrayList(sizeof(lstrIndex), countByte(haystack + from, hayLen - from, c));
+    if(matches == NULL) return NULL;
+
+    if(scanByte(haystack, from, hayLen, c, matches)){
+        alFreeArrayList(matches);
+        return NULL;
+    }
+
+    return matches;
+}
+
+//Count the non-overlapping matches of a search plan from index <from>
+static lstrLength countMatches(const lstrPattern* plan, const char* haystack, lstrLength hayLen, lstrIndex from){
+    if(plan->length == 1) return countByte(haystack + from, hayLen - from, plan->needle[0]);
+
+    lstrLength count = 0;
+    for(lstrIndex index = runSearch(plan, haystack, hayLen, from);index != MAXIMUM_STRING_BYTES;index = runSearch(plan, haystack, hayLen, index + plan->length)) count++;
+
+    return count;
+}
+
+//Find every non-overlapping match of a search plan from index <from>. Returns an arrayList of lstrIndex (which may be empty), or NULL if allocation failed.
+static arrayList* collectMatches(const lstrPattern* plan, const char* haystack, lstrLength hayLen, lstrIndex from){
+    if(plan->length == 1) return collectByte(haystack, hayLen, from, plan->needle[0]);
+
+    arrayList* matches = alNewArrayList(sizeof(lstrIndex));
+    if(matches == NULL) return NULL;
+
+    //Positions are batched on the stack, as in scanByte, so the list grows once per batch
+    lstrIndex batch[SCAN_BATCH_OFFSETS];
+    int batched = 0;
+
+    for(lstrIndex index = runSearch(plan, haystack, hayLen, from);index != MAXIMUM_STRING_BYTES;index = runSearch(plan, haystack, hayLen, index + plan->length)){
+        batch[batched++] = index;
+
+        if(batched == SCAN_BATCH_OFFSETS){
+            if(alAppendMany(matches, batch, batched) == NULL){
+                alFreeArrayList(matches);
+                return NULL;
+            }
+            batched = 0;
+        }
+    }
+
+    if(batched > 0 && alAppendMany(matches, batch, batched) == NULL){
+        alFreeArrayList(matches);
+        return NULL;
+    }
+
+    return matches;
+}
+
+//Count the instances of a given character in the lString. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails.
+lstrLength lstrCountChar(lString* lstr, char c){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    return countByte(lstr->head, lstr->length, c);
+}
+
+//Count the instances of a given character at or after index <from>. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where <from> is past the end of the string).
+lstrLength lstrCountCharFrom(lString* lstr, char c, lstrIndex from){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(from > lstr->length) return MAXIMUM_STRING_BYTES;
+
+    return countByte(lstr->head + from, lstr->length - from, c);
+}
+
+//Count the non-overlapping instances of a given string in the lString, from left to right. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where the input string is empty).
+lstrLength lstrCountString(lString* lstr, char* str){
+    return lstrCountStringFrom(lstr, str, 0);
+}
+
+//Count the non-overlapping instances of a given string that start at or after index <from>, from left to right. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where the input string is empty or <from> is past the end of the string).
+lstrLength lstrCountStringFrom(lString* lstr, char* str, lstrIndex from){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    #ifndef NO_SAFETY
+    if(str == NULL) return MAXIMUM_STRING_BYTES;
+    #endif
+
+    lstrLength len = strlen(str);
+    if(len < 1 || from > lstr->length) return MAXIMUM_STRING_BYTES;
+
+    lstrPattern plan;
+    planSearch(&plan, str, len);
+
+    return countMatches(&plan, lstr->head, lstr->length, from);
+}
+
+//Find every instance of a given character in the lString. Returns an arrayList of lstrIndex positions (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllChar(lString* lstr, char c){
+    return lstrFindAllCharFrom(lstr, c, 0);
+}
+
+//Find every instance of a given character at or after index <from>. Returns an arrayList of lstrIndex positions (which may be empty), or NULL if the operation fails (including cases where <from> is past the end of the string).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllCharFrom(lString* lstr, char c, lstrIndex from){
+    null_check(lstr, NULL);
+
+    if(from > lstr->length) return NULL;
+
+    return collectByte(lstr->head, lstr->length, from, c);
+}
+
+//Find every non-overlapping instance of a given string in the lString, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails (including cases where the input string is empty).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllString(lString* lstr, char* str){
+    return lstrFindAllStringFrom(lstr, str, 0);
+}
+
+//Find every non-overlapping instance of a given string that starts at or after index <from>, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails (including cases where the input string is empty or <from> is past the end of the string).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllStringFrom(lString* lstr, char* str, lstrIndex from){
+    null_check(lstr, NULL);
+
+    #ifndef NO_SAFETY
+    if(str == NULL) return NULL;
+    #endif
+
+    lstrLength len = strlen(str);
+    if(len < 1 || from > lstr->length) return NULL;
+
+    lstrPattern plan;
+    planSearch(&plan, str, len);
+
+    return collectMatches(&plan, lstr->head, lstr->length, from);
+}
+
+
+//Precompiled patterns hold everything a substring search needs, so repeated searches for the same needle skip all per-call setup
+
+//Compile a reusable search pattern from a null-terminated needle. The needle is copied. Returns NULL if the needle is empty or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreePattern.
+lstrPattern* lstrNewPattern(char* str){
+    #ifndef NO_SAFETY
+    if(str == NULL) return NULL;
+    #endif
+
+    return lstrNewPatternLen(str, strlen(str));
+}
+
+//Compile a reusable search pattern from the first <len> bytes of a needle, which may include '\0' bytes. The needle is copied. Returns NULL if the needle is empty or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreePattern.
+lstrPattern* lstrNewPatternLen(char* str, lstrLength len){
+    #ifndef NO_SAFETY
+    if(str == NULL) return NULL;
+    #endif
+
+    if(len < 1) return NULL;
+
+    lstrPattern* pattern = (lstrPattern*) malloc(sizeof(lstrPattern));
+    char* needle = (char*) malloc(len + 1);
+
+    if(pattern == NULL || needle == NULL){
+        free(pattern);
+        free(needle);
+        return NULL;
+    }
+
+    memcpy(needle, str, len);
+    needle[len] = '\0';
+
+    planSearch(pattern, needle, len);
+
+    return pattern;
+}
+
+//Find the first instance of a compiled pattern in the lString. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES if there is no match or the operation fails.
+lstrIndex lstrFindPattern(lString* lstr, lstrPattern* pattern){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    #ifndef NO_SAFETY
+    if(pattern == NULL) return MAXIMUM_STRING_BYTES;
+    #endif
+
+    return runSearch(pattern, lstr->head, lstr->length, 0);
+}
+
+//Find every non-overlapping instance of a compiled pattern in the lString, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllPattern(lString* lstr, lstrPattern* pattern){
+    null_check(lstr, NULL);
+
+    #ifndef NO_SAFETY
+    if(pattern == NULL) return NULL;
+    #endif
+
+    return collectMatches(pattern, lstr->head, lstr->length, 0);
+}
+
+//Replace every non-overlapping match of a search plan with <newLen> bytes of <new>, from left to right. Returns the number of replacements, or MAXIMUM_STRING_BYTES if the operation fails (in which case the string is not altered).
+//Replacements that do not lengthen the string are streamed in place in a single pass. Longer replacements first count the matches, then stream the result into one exactly-sized buffer.
+static lstrLength replaceAll(lString* lstr, const lstrPattern* plan, const char* new, lstrLength newLen){
+    lstrLength oldLen = plan->length;
+    lstrLength count = 0;
+
+    if(newLen <= oldLen){
+        //The write position never passes the read position, and searching only looks at bytes from the read position on, so the string can be rewritten as it is scanned
+        lstrIndex read = 0, write = 0;
+        lstrIndex index = runSearch(plan, lstr->head, lstr->length, 0);
+        lstrIndex first = index;
+
+        while(index != MAXIMUM_STRING_BYTES){
+            memmove(lstr->head + write, lstr->head + read, index - read);
+            write += index - read;
+            memcpy(lstr->head + write, new, newLen);
+            write += newLen;
+            read = index + oldLen;
+            count++;
+
+            index = runSearch(plan, lstr->head, lstr->length, read);
+        }
+
+        if(count == 0) return 0;
+
+        memmove(lstr->head + write, lstr->head + read, lstr->length - read);
+        write += lstr->length - read;
+
+        //Clear the bytes the string no longer uses
+        memset(lstr->head + write, '\0', lstr->length - write);
+        lstrLength oldLength = lstr->length;
+        lstr->length = write;
+        noteEdit(lstr, first, oldLength - first, write - first);
+
+        return count;
+    }
+
+    //Count the matches to size the result exactly
+    lstrIndex first = runSearch(plan, lstr->head, lstr->length, 0);
+    for(lstrIndex index = first;index != MAXIMUM_STRING_BYTES;index = runSearch(plan, lstr->head, lstr->length, index + oldLen)) count++;
+
+    if(count == 0) return 0;
+
+    //Fail if the result would be too long
+    if(count > (MAXIMUM_STRING_BYTES - 1 - lstr->length) / (newLen - oldLen)) return MAXIMUM_STRING_BYTES;
+    lstrLength resultLen = lstr->length + count * (newLen - oldLen);
+
+    //Size the new buffer in the same powers of two that expandLString would reach
+    lstrLength toAlloc = grownSize(lstr->allocatedLength, resultLen);
+
+    char* output = (char*) calloc(toAlloc, 1);
+    if(output == NULL) return MAXIMUM_STRING_BYTES;
+
+    //Copy each unchanged segment followed by the replacement
+    char* write = output;
+    lstrIndex read = 0;
+    for(lstrIndex index = runSearch(plan, lstr->head, lstr->length, 0);index != MAXIMUM_STRING_BYTES;index = runSearch(plan, lstr->head, lstr->length, read)){
+        memcpy(write, lstr->head + read, index - read);
+        write += index - read;
+        memcpy(write, new, newLen);
+        write += newLen;
+        read = index + oldLen;
+    }
+    memcpy(write, lstr->head + read, lstr->length - read);
+
+    //Swap the new buffer in
+    free(lstr->head);
+    lstr->head = output;
+    lstr->allocatedLength = toAlloc;
+    lstr->generation++;
+    lstrLength oldLength = lstr->length;
+    lstr->length = resultLen;
+    noteEdit(lstr, first, oldLength - first, resultLen - first);
+
+    return count;
+}
+
+//Replace every non-overlapping instance of a compiled pattern with a new string, from left to right. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails, in which case the original string is not altered.
+lstrLength lstrReplacePatternAll(lString* lstr, lstrPattern* pattern, char* new){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    #ifndef NO_SAFETY
+    if(pattern == NULL || new == NULL) return MAXIMUM_STRING_BYTES;
+    #endif
+
+    return replaceAll(lstr, pattern, new, strlen(new));
+}
+
+//Destroy and de-allocate a compiled pattern
+void lstrFreePattern(lstrPattern* pattern){
+    if(pattern == NULL) return;
+    free((char*) pattern->needle);
+    free(pattern);
+}
+
+
+//Replace the first instance of one character in the string with a new character. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails (but not if the operation simply makes no replacements).
+lstrLength lstrReplaceChar(lString* lstr, char old, char new){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Iterate over the string and replace the first instance of old with new
+    for(lstrIndex i = 0;i < lstr->length;i++){
+        if(lstr->head[i] == old){
+            lstr->head[i] = new;
+            noteEdit(lstr, i, 1, 1);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+//Replace all instances of one character in the string with a new character. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails (but not if the operation simply makes no replacements).
+lstrLength lstrReplaceCharAll(lString* lstr, char old, char new){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Ignore redundant replacement
+    if(old == new) return 0;
+
+    //Iterate over the string and replace all instances of old with new
+    lstrLength replaced = 0;
+    lstrIndex first = 0, last = 0;
+    for(lstrIndex i = 0;i < lstr->length;i++){
+        if(lstr->head[i] == old){
+            lstr->head[i] = new;
+            if(replaced == 0) first = i;
+            last = i;
+            replaced++;
+        }
+    }
+
+    if(replaced > 0) noteEdit(lstr, first, last + 1 - first, last + 1 - first);
+
+    return replaced;
+}
+
+//Replace the first instance of one substring with a new substring. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
+lstrLength lstrReplaceString(lString* lstr, char* old, char* new){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Get string lengths
+    lstrLength oldLen = strlen(old);
+    lstrLength newLen = strlen(new);
+
+    //Ignore empty old strings
+    if(oldLen < 1) return 0;
+
+    //Find the first instance of the old string, if applicable
+    lstrIndex index = lstrFindString(lstr, old);
+
+    //If the old string is even present, find it
+    if(index != MAXIMUM_STRING_BYTES){
+        //Compute useful values
+        char* indexAddr = lstr->head + index;
+        lstrLength laterBytes = lstr->length + 1 - (index + oldLen);
+
+        //Replace strings, with possible string expansion
+        if(newLen == 0){
+            return lstrRemoveString(lstr, index, oldLen) == 0 ? 1 : MAXIMUM_STRING_BYTES;
+        } else if(newLen > oldLen){
+            //Allocate new space as needed
+            while(lstr->allocatedLength - (lstr->length + 1) < newLen - oldLen){
+                lstrLength oldLen = lstr->allocatedLength;
+                if(expandLString(lstr) <= oldLen) return MAXIMUM_STRING_BYTES;
+            }
+            
+            //Update string length
+            lstr->length += (newLen - oldLen);
+
+        } else {
+            //Update string length
+            lstr->length -= (oldLen - newLen);
+        }
+
+        //Move up all bytes that fall after the old string
+        memmove(indexAddr + newLen, indexAddr + oldLen, laterBytes);
+
+        //Copy the new string into position
+        memmove(indexAddr, new, newLen);
+        noteEdit(lstr, index, oldLen, newLen);
+
+        return 1;
+    //If we make no replacement, return 0
+    } else {
+        return 0;
+    }
+}
+
+//Replace all instances of one substring with a new substring, from left to right. The whole string is searched, including any part after an embedded '\0'. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
+lstrLength lstrReplaceStringAll(lString* lstr, char* old, char* new){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    #ifndef NO_SAFETY
+    if(old == NULL || new == NULL) return MAXIMUM_STRING_BYTES;
+    #endif
+
+    //Get string lengths
+    lstrLength oldLen = strlen(old);
+
+    //Ignore empty old strings
+    if(oldLen < 1 || oldLen > lstr->length) return 0;
+
+    lstrPattern plan;
+    planSearch(&plan, old, oldLen);
+
+    return replaceAll(lstr, &plan, new, strlen(new));
+}
+
+
+//Edit batches apply many inserts, removals and replacements in one linear pass, instead of shifting the rest of the string once per edit
+
+//A queued edit: remove <removed> characters at <index>, putting <textLength> bytes of the batch's text (from <textOffset>) in their place
+typedef struct batchEdit {
+    lstrIndex index;
+    lstrLength removed;
+    lstrIndex textOffset;
+    lstrLength textLength;
+
+    //Position in the queue, which keeps the sort stable for edits at the same index
+    alIndex order;
+} batchEdit;
+
+//Create a new, empty edit batch. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeEditBatch.
+lstrEditBatch* lstrNewEditBatch(){
+    lstrEditBatch* batch = (lstrEditBatch*) malloc(sizeof(lstrEditBatch));
+    if(batch == NULL) return NULL;
+
+    batch->edits = alNewArrayList(sizeof(batchEdit));
+    batch->text = lstrNewBlankString();
+
+    if(batch->edits == NULL || batch->text == NULL){
+        if(batch->edits != NULL) alFreeArrayList(batch->edits);
+        if(batch->text != NULL) lstrFreeString(batch->text);
+        free(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+//Queue an edit, copying its text into the batch
+static int queueEdit(lstrEditBatch* batch, lstrIndex index, lstrLength removed, char* str){
+    #ifndef NO_SAFETY
+    if(batch == NULL || batch->edits == NULL) return 1;
+    #endif
+
+    lstrLength textLength = str == NULL ? 0 : strlen(str);
+    batchEdit edit = {index, removed, batch->text->length, textLength, alGetListLength(batch->edits)};
+
+    if(textLength > 0 && lstrAppendBytes(batch->text, str, textLength) == NULL) return 1;
+
+    if(alAppend(batch->edits, &edit) == NULL){
+        //Drop the text again, keeping the unused bytes zeroed
+        memset(batch->text->head + edit.textOffset, '\0', textLength);
+        batch->text->length = edit.textOffset;
+        return 1;
+    }
+
+    return 0;
+}
+
+//Queue an insertion of a null-terminated string before the character at <index> of the original string (or at the end, if <index> is the string's length). Returns 0 for success, or 1 if the operation fails.
+int lstrBatchInsert(lstrEditBatch* batch, lstrIndex index, char* str){
+    #ifndef NO_SAFETY
+    if(str == NULL) return 1;
+    #endif
+
+    return queueEdit(batch, index, 0, str);
+}
+
+//Queue the removal of <len> characters starting at <index> of the original string. Returns 0 for success, or 1 if the operation fails.
+int lstrBatchRemove(lstrEditBatch* batch, lstrIndex index, lstrLength len){
+    return queueEdit(batch, index, len, NULL);
+}
+
+//Queue the replacement of <len> characters starting at <index> of the original string with a null-terminated string. Returns 0 for success, or 1 if the operation fails.
+int lstrBatchReplace(lstrEditBatch* batch, lstrIndex index, lstrLength len, char* str){
+    #ifndef NO_SAFETY
+    if(str == NULL) return 1;
+    #endif
+
+    return queueEdit(batch, index, len, str);
+}
+
+//Order edits by index, then by queue order
+static int compareEdits(const void* a, const void* b){
+    const batchEdit* x = (const batchEdit*) a;
+    const batchEdit* y = (const batchEdit*) b;
+
+    if(x->index != y->index) return x->index < y->index ? -1 : 1;
+    return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+//Apply every queued edit to the string at once. Edits at the same index are applied in the order they were queued. The batch is emptied on success, so it can be reused.
+//Returns 0 for success, or 1 if the operation fails (any edit is out of bounds, two edits remove overlapping ranges, an insertion falls inside a removed range, or allocation failed), in which case neither the string nor the batch is altered.
+int lstrCommitEdits(lString* lstr, lstrEditBatch* batch){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(batch == NULL || batch->edits == NULL) return 1;
+    #endif
+
+    alLength count = alGetListLength(batch->edits);
+    if(count == 0) return 0;
+
+    //Sorting by (index, queue order) leaves the batch's meaning unchanged, so it can be done in place
+    batchEdit* edits = (batchEdit*) alGetListHead(batch->edits);
+    qsort(edits, count, sizeof(batchEdit), compareEdits);
+
+    //Validate the edits and total up the size of the result
+    lstrIndex removalStart = 0, removalEnd = 0;
+    lstrLength removedTotal = 0;
+    for(alIndex i = 0;i < count;i++){
+        if(edits[i].index > lstr->length || edits[i].removed > lstr->length - edits[i].index) return 1;
+
+        //An edit may only start inside the last removed range if it is a pure insertion at that range's start
+        if(edits[i].index < removalEnd && (edits[i].removed > 0 || edits[i].index != removalStart)) return 1;
+
+        if(edits[i].removed > 0){
+            removalStart = edits[i].index;
+            removalEnd = edits[i].index + edits[i].removed;
+            removedTotal += edits[i].removed;
+        }
+    }
+
+    //All of the batch's text is inserted exactly once
+    lstrLength keptLength = lstr->length - removedTotal;
+    if(batch->text->length > MAXIMUM_STRING_BYTES - 1 - keptLength) return 1;
+    lstrLength resultLen = keptLength + batch->text->length;
+
+    lstrLength toAlloc = grownSize(lstr->allocatedLength, resultLen);
+    char* output = (char*) calloc(toAlloc, 1);
+    if(output == NULL) return 1;
+
+    //Copy each unchanged segment followed by the edit's text, skipping removed ranges
+    char* write = output;
+    lstrIndex read = 0;
+    for(alIndex i = 0;i < count;i++){
+        if(edits[i].index > read){
+            memcpy(write, lstr->head + read, edits[i].index - read);
+            write += edits[i].index - read;
+            read = edits[i].index;
+        }
+
+        memcpy(write, batch->text->head + edits[i].textOffset, edits[i].textLength);
+        write += edits[i].textLength;
+
+        if(edits[i].index + edits[i].removed > read) read = edits[i].index + edits[i].removed;
+    }
+    memcpy(write, lstr->head + read, lstr->length - read);
+
+    //Swap the new buffer in
+    free(lstr->head);
+    lstr->head = output;
+    lstr->allocatedLength = toAlloc;
+    lstr->generation++;
+    lstrLength oldLength = lstr->length;
+    lstr->length = resultLen;
+    noteEdit(lstr, edits[0].index, oldLength - edits[0].index, resultLen - edits[0].index);
+
+    lstrClearEditBatch(batch);
+
+    return 0;
+}
+
+//Discard every queued edit
+void lstrClearEditBatch(lstrEditBatch* batch){
+    if(batch == NULL || batch->edits == NULL) return;
+
+    alRemoveLastMany(batch->edits, alGetListLength(batch->edits));
+    memset(batch->text->head, '\0', batch->text->length);
+    batch->text->length = 0;
+}
+
+//Destroy and de-allocate an edit batch
+void lstrFreeEditBatch(lstrEditBatch* batch){
+    if(batch == NULL) return;
+
+    if(batch->edits != NULL) alFreeArrayList(batch->edits);
+    if(batch->text != NULL) lstrFreeString(batch->text);
+    free(batch);
+}
+
+
+//Case conversion and classification kernels. Each flips or tests bytes by range-comparing whole vectors, with a branch-free scalar loop for the tail.
+
+//Copy <len> bytes from <src> to <dest> (which may be the same buffer), flipping the ASCII case bit of every byte in the range [low, high]
+static void caseScalar(char* dest, const char* src, lstrLength len, char low, char high){
+    for(lstrIndex i = 0;i < len;i++){
+        unsigned char c = (unsigned char) src[i];
+        dest[i] = (char) (c ^ (((unsigned char) (c - low) <= (unsigned char) (high - low)) << 5));
+    }
+}
+
+#ifdef __SSE2__
+//SSE2 version of caseScalar, 16 bytes at a time. Bytes above 127 compare as negative, so they never fall in an ASCII range.
+static void caseSSE2(char* dest, const char* src, lstrLength len, char low, char high){
+    const __m128i below = _mm_set1_epi8((char) (low - 1));
+    const __m128i above = _mm_set1_epi8((char) (high + 1));
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    lstrIndex i = 0;
+    for(;i + 16 <= len;i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above));
+        _mm_storeu_si128((__m128i*) (dest + i), _mm_xor_si128(v, _mm_and_si128(inRange, flip)));
+    }
+
+    caseScalar(dest + i, src + i, len - i, low, high);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//AVX2 version of caseScalar, 32 bytes at a time
+__attribute__((target("avx2")))
+static void caseAVX2(char* dest, const char* src, lstrLength len, char low, char high){
+    const __m256i below = _mm256_set1_epi8((char) (low - 1));
+    const __m256i above = _mm256_set1_epi8((char) (high + 1));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+
+    lstrIndex i = 0;
+    for(;i + 32 <= len;i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(v, below), _mm256_cmpgt_epi8(above, v));
+        _mm256_storeu_si256((__m256i*) (dest + i), _mm256_xor_si256(v, _mm256_and_si256(inRange, flip)));
+    }
+
+    caseScalar(dest + i, src + i, len - i, low, high);
+}
+#endif
+
+//Flip the case of every byte in [low, high], using the widest kernel the processor supports
+static void convertCase(char* dest, const char* src, lstrLength len, char low, char high){
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        caseAVX2(dest, src, len, low, high);
+        return;
+    }
+    #endif
+
+    #ifdef __SSE2__
+    caseSSE2(dest, src, len, low, high);
+    #else
+    caseScalar(dest, src, len, low, high);
+    #endif
+}
+
+//Check whether a byte is ASCII whitespace (space, \t, \n, \v, \f or \r)
+#define isSpaceByte(c) ((c) == ' ' || ((unsigned char) (c) - 9u) <= 4u)
+
+#ifdef __SSE2__
+//Get a mask with one bit set for each byte of <v> that is not ASCII whitespace
+static unsigned int nonSpaceMask(__m128i v){
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+        _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(8)), _mm_cmplt_epi8(v, _mm_set1_epi8(14))));
+    return ~_mm_movemask_epi8(space) & 0xFFFF;
+}
+#endif
+
+//Get the index of the first byte that is not ASCII whitespace, or <len> if there is none
+static lstrIndex skipLeadingSpace(const char* str, lstrLength len){
+    lstrIndex i = 0;
+
+    #ifdef __SSE2__
+    for(;i + 16 <= len;i += 16){
+        unsigned int mask = nonSpaceMask(_mm_loadu_si128((const __m128i*) (str + i)));
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+    #endif
+
+    while(i < len && isSpaceByte(str[i])) i++;
+    return i;
+}
+
+//Get the length of the string once any trailing ASCII whitespace is removed
+static lstrLength skipTrailingSpace(const char* str, lstrLength len){
+    #ifdef __SSE2__
+    while(len >= 16){
+        unsigned int mask = nonSpaceMask(_mm_loadu_si128((const __m128i*) (str + len - 16)));
+        if(mask != 0) return len - 16 + (32 - __builtin_clz(mask));
+        len -= 16;
+    }
+    #endif
+
+    while(len > 0 && isSpaceByte(str[len - 1])) len--;
+    return len;
+}
+
+
+//For ASCII characters only, return a copy of the string where all alphabetical characters are UPPERCASE. Returns a pointer to the new string, or NULL if the operation fails. The returned string may be empty.
+//This function dynamically allocates memory, and its return value must be freed.
+char* lstrToUpper(lString* lstr){
+    null_check(lstr, NULL);
+
+    char* copy = (char*) malloc(lstr->length + 1);
+    if(copy == NULL) return NULL;
+
+    return lstrToUpperInto(lstr, copy);
+}
+
+//For ASCII characters only, return a copy of the string where all alphabetical characters are lowercase. Returns a pointer to the new string, or NULL if the operation fails. The returned string may be empty.
+//This function dynamically allocates memory, and its return value must be freed.
+char* lstrToLower(lString* lstr){
+    null_check(lstr, NULL);
+
+    char* copy = (char*) malloc(lstr->length + 1);
+    if(copy == NULL) return NULL;
+
+    return lstrToLowerInto(lstr, copy);
+}
+
+//For ASCII characters only, write an UPPERCASE copy of the string (including the null terminator) into <buffer>, which must hold at least length + 1 bytes. Returns <buffer>, or NULL if the operation fails.
+char* lstrToUpperInto(lString* lstr, char* buffer){
+    null_check(lstr, NULL);
+
+    #ifndef NO_SAFETY
+    if(buffer == NULL) return NULL;
+    #endif
+
+    convertCase(buffer, lstr->head, lstr->length, 'a', 'z');
+    buffer[lstr->length] = '\0';
+
+    return buffer;
+}
+
+//For ASCII characters only, write a lowercase copy of the string (including the null terminator) into <buffer>, which must hold at least length + 1 bytes. Returns <buffer>, or NULL if the operation fails.
+char* lstrToLowerInto(lString* lstr, char* buffer){
+    null_check(lstr, NULL);
+
+    #ifndef NO_SAFETY
+    if(buffer == NULL) return NULL;
+    #endif
+
+    convertCase(buffer, lstr->head, lstr->length, 'A', 'Z');
+    buffer[lstr->length] = '\0';
+
+    return buffer;
+}
+
+//For ASCII characters only, convert every alphabetical character in the string to UPPERCASE, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrToUpperInPlace(lString* lstr){
+    null_check(lstr, 1);
+
+    //Flipping the case of ASCII letters never changes which bytes start code points, so the UTF-8 index stays valid, but the hash does change
+    convertCase(lstr->head, lstr->head, lstr->length, 'a', 'z');
+    lstr->hashValid = 0;
+    return 0;
+}
+
+//For ASCII characters only, convert every alphabetical character in the string to lowercase, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrToLowerInPlace(lString* lstr){
+    null_check(lstr, 1);
+
+    //Flipping the case of ASCII letters never changes which bytes start code points, so the UTF-8 index stays valid, but the hash does change
+    convertCase(lstr->head, lstr->head, lstr->length, 'A', 'Z');
+    lstr->hashValid = 0;
+    return 0;
+}
+
+
+//Check whether every byte of the string is ASCII (below 128). Returns 1 if so (including for an empty string), 0 if not, or -1 for an invalid string.
+int lstrIsAscii(lString* lstr){
+    null_check(lstr, -1);
+
+    const char* str = lstr->head;
+    lstrLength len = lstr->length;
+    lstrIndex i = 0;
+
+    #ifdef __SSE2__
+    //OR blocks together and test the high bits once per 64 bytes
+    for(;i + 64 <= len;i += 64){
+        __m128i v = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((const __m128i*) (str + i)), _mm_loadu_si128((const __m128i*) (str + i + 16))),
+            _mm_or_si128(_mm_loadu_si128((const __m128i*) (str + i + 32)), _mm_loadu_si128((const __m128i*) (str + i + 48))));
+        if(_mm_movemask_epi8(v) != 0) return 0;
+    }
+    #endif
+
+    unsigned char bits = 0;
+    for(;i < len;i++) bits |= (unsigned char) str[i];
+
+    return bits < 128;
+}
+
+//Count the ASCII digits ('0' to '9') in the string. Returns the count, or MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrCountDigits(lString* lstr){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    const char* str = lstr->head;
+    lstrLength len = lstr->length;
+    lstrLength count = 0;
+    lstrIndex i = 0;
+
+    #ifdef __SSE2__
+    const __m128i below = _mm_set1_epi8('0' - 1);
+    const __m128i above = _mm_set1_epi8('9' + 1);
+
+    //Count matches in per-byte counters (subtracting the all-ones compare mask adds 1), then sum the counters before any can overflow
+    while(i + 16 <= len){
+        __m128i counters = _mm_setzero_si128();
+
+        for(int block = 0;block < 255 && i + 16 <= len;block++, i += 16){
+            __m128i v = _mm_loadu_si128((const __m128i*) (str + i));
+            counters = _mm_sub_epi8(counters, _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above)));
+        }
+
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += (lstrLength) _mm_cvtsi128_si32(sums) + (lstrLength) _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    #endif
+
+    for(;i < len;i++) count += ((unsigned char) str[i] - (unsigned char) '0') <= 9u;
+
+    return count;
+}
+
+//Remove ASCII whitespace (space, \t, \n, \v, \f and \r) from both ends of the string, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrTrim(lString* lstr){
+    null_check(lstr, 1);
+
+    lstrLength end = skipTrailingSpace(lstr->head, lstr->length);
+    lstrIndex start = skipLeadingSpace(lstr->head, end);
+
+    //Drop the trailing whitespace, then shift the kept bytes down, clearing what is left behind since every unused character must be '\0'
+    lstrLength oldLength = lstr->length;
+    memset(lstr->head + end, '\0', oldLength - end);
+    lstr->length = end;
+    noteEdit(lstr, end, oldLength - end, 0);
+
+    memmove(lstr->head, lstr->head + start, end - start);
+    memset(lstr->head + (end - start), '\0', start);
+    lstr->length = end - start;
+    noteEdit(lstr, 0, start, 0);
+
+    return 0;
+}
+
+
+//UTF-8 support. A byte starts a code point unless it is a continuation byte (10xxxxxx), which as a signed char is exactly the range [-128, -65].
+
+//A UTF-8 index checkpoint: <points> code points start before byte <byte>
+typedef struct utf8Checkpoint {
+    lstrIndex byte;
+    lstrLength points;
+} utf8Checkpoint;
+
+//Check whether a byte starts a code point
+#define isLeadByte(c) ((signed char) (c) > -65)
+
+//Count the code points that start in <len> bytes
+static lstrLength countPoints(const char* str, lstrLength len){
+    lstrLength count = 0;
+    lstrIndex i = 0;
+
+    #ifdef __SSE2__
+    const __m128i continuation = _mm_set1_epi8(-65);
+
+    //Count lead bytes in per-byte counters, as lstrCountDigits does
+    while(i + 16 <= len){
+        __m128i counters = _mm_setzero_si128();
+
+        for(int block = 0;block < 255 && i + 16 <= len;block++, i += 16){
+            counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*) (str + i)), continuation));
+        }
+
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += (lstrLength) _mm_cvtsi128_si32(sums) + (lstrLength) _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    #endif
+
+    for(;i < len;i++) count += isLeadByte(str[i]);
+
+    return count;
+}
+
+//Scan bytes <pos> to <end> - 1, which start after <count> code points, adding a checkpoint to <out> at every lead byte where the count reaches a multiple of UTF8_CHECKPOINT_SPACING. Returns the number of code points before <end>, or MAXIMUM_STRING_BYTES if allocation failed.
+static lstrLength scanCheckpoints(const char* str, lstrIndex pos, lstrLength count, lstrIndex end, arrayList* out){
+    lstrLength next = (count / UTF8_CHECKPOINT_SPACING + 1) * UTF8_CHECKPOINT_SPACING;
+
+    while(pos < end){
+        #ifdef __SSE2__
+        //Skip whole blocks that cannot contain the next checkpoint
+        if(pos + 16 <= end){
+            __m128i v = _mm_loadu_si128((const __m128i*) (str + pos));
+            lstrLength leads = __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(-65))));
+
+            if(count + leads <= next){
+                count += leads;
+                pos += 16;
+                continue;
+            }
+        }
+        #endif
+
+        if(isLeadByte(str[pos])){
+            if(count == next){
+                utf8Checkpoint checkpoint = {pos, count};
+                if(alAppend(out, &checkpoint) == NULL) return MAXIMUM_STRING_BYTES;
+                next += UTF8_CHECKPOINT_SPACING;
+            }
+            count++;
+        }
+
+        pos++;
+    }
+
+    return count;
+}
+
+//Discard the string's UTF-8 index, which is rebuilt from scratch when next needed
+static void dropIndex(lString* lstr){
+    alFreeArrayList(lstr->utf8Index);
+    lstr->utf8Index = NULL;
+}
+
+//Extend the UTF-8 index until it covers at least <byteTarget> bytes and more than <pointTarget> code points (or the whole string), creating it if necessary. Returns 0 for success, or 1 if allocation failed.
+static int extendIndex(lString* lstr, lstrIndex byteTarget, lstrLength pointTarget){
+    if(lstr->utf8Index == NULL){
+        lstr->utf8Index = alNewArrayList(sizeof(utf8Checkpoint));
+        if(lstr->utf8Index == NULL) return 1;
+
+        utf8Checkpoint start = {0, 0};
+        if(alAppend(lstr->utf8Index, &start) == NULL){
+            dropIndex(lstr);
+            return 1;
+        }
+
+        lstr->utf8Covered = 0;
+        lstr->utf8CoveredPoints = 0;
+    }
+
+    //Scan a chunk at a time, so lookups near the start of a long string only index what they need
+    while(lstr->utf8Covered < lstr->length && (lstr->utf8Covered < byteTarget || lstr->utf8CoveredPoints <= pointTarget)){
+        lstrIndex end = lstr->length - lstr->utf8Covered > UTF8_SCAN_CHUNK ? lstr->utf8Covered + UTF8_SCAN_CHUNK : lstr->length;
+        lstrLength points = scanCheckpoints(lstr->head, lstr->utf8Covered, lstr->utf8CoveredPoints, end, lstr->utf8Index);
+
+        if(points == MAXIMUM_STRING_BYTES){
+            dropIndex(lstr);
+            return 1;
+        }
+
+        lstr->utf8Covered = end;
+        lstr->utf8CoveredPoints = points;
+    }
+
+    return 0;
+}
+
+//Find the last checkpoint at or before a byte index
+static alIndex checkpointByByte(const utf8Checkpoint* checkpoints, alLength count, lstrIndex byte){
+    alIndex low = 0, high = count;
+    while(high - low > 1){
+        alIndex mid = low + (high - low) / 2;
+        if(checkpoints[mid].byte <= byte) low = mid;
+        else high = mid;
+    }
+    return low;
+}
+
+//Update the string's caches after <removed> bytes at <index> have been replaced by <inserted> bytes. The string's length and contents must already reflect the edit.
+//Checkpoints before the edit are kept, those inside it are dropped, and those after it are shifted, with the gap around the edit re-scanned to find how far they move.
+static void noteEdit(lString* lstr, lstrIndex index, lstrLength removed, lstrLength inserted){
+    //Every edit changes the string's hash
+    lstr->hashValid = 0;
+
+    if(lstr->lineIndex != NULL) patchLineIndex(lstr, index, removed, inserted);
+
+    //Edits past the indexed region leave it intact
+    if(lstr->utf8Index == NULL || index >= lstr->utf8Covered) return;
+
+    utf8Checkpoint* checkpoints = (utf8Checkpoint*) alGetListHead(lstr->utf8Index);
+    alLength count = alGetListLength(lstr->utf8Index);
+    lstrIndex oldEnd = index + removed;
+
+    //The checkpoint before the edit still describes an unchanged prefix. Find the first checkpoint after it that the edit did not remove.
+    alIndex before = checkpointByByte(checkpoints, count, index);
+    alIndex after = before + 1;
+    while(after < count && checkpoints[after].byte < oldEnd) after++;
+
+    if(after > before + 1){
+        alRemoveMany(lstr->utf8Index, before + 1, after - (before + 1));
+        count -= after - (before + 1);
+        after = before + 1;
+    }
+
+    //If the edit reaches past the indexed region, the index now ends at the edit
+    if(after == count && lstr->utf8Covered < oldEnd){
+        lstr->utf8Covered = index;
+        lstr->utf8CoveredPoints = checkpoints[before].points + countPoints(lstr->head + checkpoints[before].byte, index - checkpoints[before].byte);
+        return;
+    }
+
+    //Re-scan from the checkpoint before the edit to the next one (or the end of the indexed region), adding checkpoints for any text the edit inserted
+    arrayList* added = alNewArrayList(sizeof(utf8Checkpoint));
+    if(added == NULL){
+        dropIndex(lstr);
+        return;
+    }
+
+    lstrIndex gapEnd = (after < count ? checkpoints[after].byte : lstr->utf8Covered) - removed + inserted;
+    lstrLength gapPoints = scanCheckpoints(lstr->head, checkpoints[before].byte, checkpoints[before].points, gapEnd, added);
+
+    if(gapPoints == MAXIMUM_STRING_BYTES){
+        alFreeArrayList(added);
+        dropIndex(lstr);
+        return;
+    }
+
+    //Shift everything after the gap by the change in bytes and code points (unsigned arithmetic wraps correctly for decreases)
+    lstrLength pointShift = gapPoints - (after < count ? checkpoints[after].points : lstr->utf8CoveredPoints);
+    lstrLength byteShift = inserted - removed;
+
+    for(alIndex i = after;i < count;i++){
+        checkpoints[i].byte += byteShift;
+        checkpoints[i].points += pointShift;
+    }
+    lstr->utf8Covered += byteShift;
+    lstr->utf8CoveredPoints += pointShift;
+
+    if(alGetListLength(added) > 0 && alInsertMany(lstr->utf8Index, after, alGetListHead(added), alGetListLength(added)) == NULL) dropIndex(lstr);
+
+    alFreeArrayList(added);
+}
+
+
+//Check a buffer for valid UTF-8 one sequence at a time, skipping runs of ASCII 16 bytes at a time where SSE2 is available
+static int validUtf8Scalar(const unsigned char* str, lstrLength len){
+    lstrIndex i = 0;
+
+    while(i < len){
+        #ifdef __SSE2__
+        //Skip runs of ASCII 16 bytes at a time
+        if(i + 16 <= len && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (str + i))) == 0){
+            i += 16;
+            continue;
+        }
+        #endif
+
+        unsigned char c = str[i];
+        if(c < 0x80){
+            i++;
+            continue;
+        }
+
+        //The lead byte sets the sequence length and the allowed range of the second byte, which excludes overlong forms, surrogates and values above U+10FFFF
+        lstrLength extra;
+        unsigned char low = 0x80, high = 0xBF;
+
+        if(c >= 0xC2 && c <= 0xDF) extra = 1;
+        else if(c >= 0xE0 && c <= 0xEF){
+            extra = 2;
+            if(c == 0xE0) low = 0xA0;
+            else if(c == 0xED) high = 0x9F;
+        }
+        else if(c >= 0xF0 && c <= 0xF4){
+            extra = 3;
+            if(c == 0xF0) low = 0x90;
+            else if(c == 0xF4) high = 0x8F;
+        }
+        else return 0;
+
+        if(len - i <= extra) return 0;
+        if(str[i + 1] < low || str[i + 1] > high) return 0;
+        for(lstrIndex j = 2;j <= extra;j++){
+            if((str[i + j] & 0xC0) != 0x80) return 0;
+        }
+
+        i += extra + 1;
+    }
+
+    return 1;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//Error classes for the UTF-8 lookup tables. Each pair of adjacent bytes is looked up by the high nibble of the first byte, the low nibble of the first byte and the high nibble of the second byte, and the pair is invalid if some class is set in all three results.
+#define UTF8_TOO_SHORT (1 << 0) //A lead byte followed by something other than a continuation byte
+#define UTF8_TOO_LONG (1 << 1) //An ASCII byte followed by a continuation byte
+#define UTF8_OVERLONG_3 (1 << 2) //E0 followed by 80-9F
+#define UTF8_TOO_LARGE (1 << 3) //F4 followed by 90-BF, or F5-FF followed by a continuation byte
+#define UTF8_SURROGATE (1 << 4) //ED followed by A0-BF
+#define UTF8_OVERLONG_2 (1 << 5) //C0 or C1 followed by a continuation byte
+#define UTF8_TOO_LARGE_1000 (1 << 6) //F5-FF followed by 80-8F
+#define UTF8_OVERLONG_4 (1 << 6) //F0 followed by 80-8F
+#define UTF8_TWO_CONTS (1 << 7) //Two continuation bytes in a row, which is only valid inside a 3 or 4 byte sequence
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+//Shift <input> right by <n> bytes across both lanes, filling in from the end of <previous>
+#define utf8Previous(input, previous, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - (n))
+
+//Find the UTF-8 errors in a 32-byte block, given the block before it. Returns a vector that is nonzero wherever a byte is invalid or a sequence is cut short.
+__attribute__((target("avx2")))
+static __m256i utf8BlockErrors(__m256i input, __m256i previous){
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    const __m256i firstHigh = _mm256_setr_epi8(
+        //0_______ (ASCII)
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        //10______ (continuation)
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        //1100____, 1101____ (2 byte leads)
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,
+        //1110____ (3 byte leads)
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        //1111____ (4 byte leads and invalid bytes)
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+
+    const __m256i firstLow = _mm256_setr_epi8(
+        //____0000, ____0001
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, UTF8_CARRY | UTF8_OVERLONG_2,
+        //____001_
+        UTF8_CARRY, UTF8_CARRY,
+        //____0100, ____0101
+        UTF8_CARRY | UTF8_TOO_LARGE, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        //____011_ through ____1100
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        //____1101
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        //____111_
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY, UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+
+    const __m256i secondHigh = _mm256_setr_epi8(
+        //0_______ (ASCII)
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        //1000____, 1001____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        //101_____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        //11______ (leads)
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+
+    __m256i previous1 = utf8Previous(input, previous, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(firstHigh, _mm256_and_si256(_mm256_srli_epi16(previous1, 4), nibble)),
+            _mm256_shuffle_epi8(firstLow, _mm256_and_si256(previous1, nibble))),
+        _mm256_shuffle_epi8(secondHigh, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+    //Continuation bytes 2 and 3 places after a 3 or 4 byte lead are the only ones allowed to follow another continuation byte. Saturating subtraction leaves the top bit set only for those leads.
+    __m256i third = _mm256_subs_epu8(utf8Previous(input, previous, 2), _mm256_set1_epi8((char) (0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(utf8Previous(input, previous, 3), _mm256_set1_epi8((char) (0xF0 - 0x80)));
+    __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char) 0x80));
+
+    return _mm256_xor_si256(expected, special);
+}
+
+//Check a buffer for valid UTF-8 32 bytes at a time with the lookup tables above, with no branch per sequence. The last partial block is copied into a zero-filled block, so a sequence cut short by the end of the buffer is caught as one followed by ASCII.
+__attribute__((target("avx2")))
+static int validUtf8AVX2(const unsigned char* str, lstrLength len){
+    __m256i previous = _mm256_setzero_si256();
+    __m256i errors = _mm256_setzero_si256();
+
+    //A block ending in a lead byte that its sequence runs past. Only needs checking when the next block is all ASCII, since otherwise the tables catch it.
+    const __m256i leadLimits = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+    __m256i incomplete = _mm256_setzero_si256();
+
+    lstrIndex i = 0;
+    for(;i + 32 <= len;i += 32){
+        __m256i input = _mm256_loadu_si256((const __m256i*) (str + i));
+
+        if(_mm256_movemask_epi8(input) == 0) errors = _mm256_or_si256(errors, incomplete);
+        else {
+            errors = _mm256_or_si256(errors, utf8BlockErrors(input, previous));
+            if(!_mm256_testz_si256(errors, errors)) return 0;
+        }
+
+        incomplete = _mm256_subs_epu8(input, leadLimits);
+        previous = input;
+    }
+
+    unsigned char last[32] = {0};
+    memcpy(last, str + i, len - i);
+    __m256i input = _mm256_loadu_si256((const __m256i*) last);
+    errors = _mm256_or_si256(errors, utf8BlockErrors(input, previous));
+
+    return _mm256_testz_si256(errors, errors);
+}
+#endif
+
+//Check whether the string is valid UTF-8 (rejecting overlong encodings, surrogates, and code points above U+10FFFF). Returns 1 if so (including for an empty string), 0 if not, or -1 for an invalid string.
+int lstrIsValidUtf8(lString* lstr){
+    null_check(lstr, -1);
+
+    const unsigned char* str = (const unsigned char*) lstr->head;
+
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(lstr->length >= 64 && __builtin_cpu_supports("avx2")) return validUtf8AVX2(str, lstr->length);
+    #endif
+
+    return validUtf8Scalar(str, lstr->length);
+}
+
+//Get the number of UTF-8 code points in the string. Returns MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrUtf8Length(lString* lstr){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Without an index, a plain count is cheaper than building one. With one, finishing the index makes later calls O(1).
+    if(lstr->utf8Index == NULL) return countPoints(lstr->head, lstr->length);
+    if(extendIndex(lstr, lstr->length, 0) != 0) return countPoints(lstr->head, lstr->length);
+
+    return lstr->utf8CoveredPoints;
+}
+
+//Get the byte index at which a code point (counting from 0) starts. Returns MAXIMUM_STRING_BYTES if the code point is out of bounds or the operation fails.
+lstrIndex lstrUtf8Offset(lString* lstr, lstrIndex point){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(extendIndex(lstr, 0, point) != 0) return MAXIMUM_STRING_BYTES;
+    if(lstr->utf8CoveredPoints <= point) return MAXIMUM_STRING_BYTES;
+
+    //Find the last checkpoint with at most <point> code points before it
+    const utf8Checkpoint* checkpoints = (const utf8Checkpoint*) alGetListHead(lstr->utf8Index);
+    alIndex low = 0, high = alGetListLength(lstr->utf8Index);
+    while(high - low > 1){
+        alIndex mid = low + (high - low) / 2;
+        if(checkpoints[mid].points <= point) low = mid;
+        else high = mid;
+    }
+
+    //Walk forward to the code point's lead byte
+    lstrIndex pos = checkpoints[low].byte;
+    lstrLength count = checkpoints[low].points;
+
+    #ifdef __SSE2__
+    while(pos + 16 <= lstr->utf8Covered){
+        lstrLength leads = __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*) (lstr->head + pos)), _mm_set1_epi8(-65))));
+        if(count + leads > point) break;
+        count += leads;
+        pos += 16;
+    }
+    #endif
+
+    while(1){
+        if(isLeadByte(lstr->head[pos])){
+            if(count == point) return pos;
+            count++;
+        }
+        pos++;
+    }
+}
+
+//Get the number of code points that start before a byte index (i.e., the index of the code point containing that byte, if it is not a lead byte). The byte index may equal the string's length. Returns MAXIMUM_STRING_BYTES if the byte index is out of bounds or the operation fails.
+lstrIndex lstrUtf8PointIndex(lString* lstr, lstrIndex byte){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(byte > lstr->length) return MAXIMUM_STRING_BYTES;
+    if(extendIndex(lstr, byte, 0) != 0) return MAXIMUM_STRING_BYTES;
+
+    const utf8Checkpoint* checkpoints = (const utf8Checkpoint*) alGetListHead(lstr->utf8Index);
+    const utf8Checkpoint* checkpoint = checkpoints + checkpointByByte(checkpoints, alGetListLength(lstr->utf8Index), byte);
+
+    return checkpoint->points + countPoints(lstr->head + checkpoint->byte, byte - checkpoint->byte);
+}
+
+//Get a substring by code-point index and length in code points. If the specified length is too long, the substring ends at the end of the original string. Returns NULL on a failed or invalid operation, such as a 0-length substring or an out-of-bounds index.
 //This function dynamically allocates memory, and its return value must be freed.
-char* lstrToUpper(lString* lstr){
+char* lstrUtf8Substr(lString* lstr, lstrIndex point, lstrLength points){
+    null_check(lstr, NULL);
+
+    if(points < 1) return NULL;
+
+    lstrIndex start = lstrUtf8Offset(lstr, point);
+    if(start == MAXIMUM_STRING_BYTES) return NULL;
+
+    //The substring ends where the first code point after it starts, or at the end of the string
+    lstrIndex end = points > MAXIMUM_STRING_BYTES - 1 - point ? MAXIMUM_STRING_BYTES : lstrUtf8Offset(lstr, point + points);
+    if(end == MAXIMUM_STRING_BYTES) end = lstr->length;
+
+    return lstrGetSubstr(lstr, start, end - start);
+}
+
+
+//Views read directly from the string's buffer, so getting a substring, trimming or searching through a view never allocates or copies
+
+//The view that failed view operations return
+static const lstrView nullView = {NULL, 0, NULL, 0};
+
+//Check that a view's string has not been re-allocated or shortened past it. Unlike lstrViewIsValid, this accepts the null view, which the caller handles as an empty view.
+#ifndef NO_SAFETY
+    #define view_check(view, retVal) if((view).data != NULL && !lstrViewIsValid(view)) return retVal;
+#else
+    #define view_check(view, retVal)
+#endif
+
+//Make a view of <len> bytes starting at <index> in an lString, stamped with the string's current generation
+static lstrView viewInto(lString* lstr, lstrIndex index, lstrLength len){
+    lstrView view = {lstr->head + index, len, lstr, lstr->generation};
+    return view;
+}
+
+//Make a view of a null-terminated C string (excluding the null terminator). Returns the null view if the string is NULL.
+lstrView lstrViewOf(char* str){
+    if(str == NULL) return nullView;
+    return lstrViewOfBytes(str, strlen(str));
+}
+
+//Make a view of <len> bytes of memory, which may include '\0'. Returns the null view if the pointer is NULL.
+lstrView lstrViewOfBytes(char* bytes, lstrLength len){
+    if(bytes == NULL) return nullView;
+
+    lstrView view = {bytes, len, NULL, 0};
+    return view;
+}
+
+//Make a view of an entire lString. Returns the null view for an invalid string.
+lstrView lstrViewString(lString* lstr){
+    null_check(lstr, nullView);
+    return viewInto(lstr, 0, lstr->length);
+}
+
+//Make a view of a substring by index and length, with the same rules as lstrGetSubstr: a length that is too long is cut short at the end of the string. Returns the null view on a failed or invalid operation, such as a 0-length substring or an out-of-bounds index.
+lstrView lstrViewSubstr(lString* lstr, lstrIndex index, lstrLength length){
+    null_check(lstr, nullView);
+
+    if(index >= lstr->length || length < 1) return nullView;
+    if(length > lstr->length - index) length = lstr->length - index;
+
+    return viewInto(lstr, index, length);
+}
+
+//Make a view of part of another view by index and length. A length that is too long is cut short at the end of the view. Returns the null view if the index is out of bounds or the view is invalid. The result may be empty.
+lstrView lstrViewSlice(lstrView view, lstrIndex index, lstrLength length){
+    if(view.data == NULL) return nullView;
+    view_check(view, nullView);
+
+    if(index > view.length) return nullView;
+    if(length > view.length - index) length = view.length - index;
+
+    view.data += index;
+    view.length = length;
+    return view;
+}
+
+//Make a view of another view without its leading and trailing ASCII whitespace (space, \t, \n, \v, \f and \r). Returns the null view if the view is invalid. The result may be empty.
+lstrView lstrViewTrim(lstrView view){
+    if(view.data == NULL) return nullView;
+    view_check(view, nullView);
+
+    lstrLength end = skipTrailingSpace(view.data, view.length);
+    lstrIndex start = skipLeadingSpace(view.data, end);
+
+    view.data += start;
+    view.length = end - start;
+    return view;
+}
+
+//Find the first instance of a needle view in a haystack view. Returns a view of the match within the haystack (its offset is match.data - haystack.data), or the null view if there is no match or the operation fails (including cases where the needle is empty).
+lstrView lstrViewFind(lstrView haystack, lstrView needle){
+    if(haystack.data == NULL || needle.data == NULL) return nullView;
+    view_check(haystack, nullView);
+    view_check(needle, nullView);
+
+    if(needle.length < 1 || needle.length > haystack.length) return nullView;
+
+    lstrPattern plan;
+    planSearch(&plan, needle.data, needle.length);
+
+    lstrIndex index = runSearch(&plan, haystack.data, haystack.length, 0);
+    if(index == MAXIMUM_STRING_BYTES) return nullView;
+
+    haystack.data += index;
+    haystack.length = needle.length;
+    return haystack;
+}
+
+//Check whether a view can still be used: it is not the null view, and if it points into an lString, that string has not been re-allocated or shortened past the view since the view was made. Returns 1 if so, or 0 if not.
+//Edits that move bytes within the buffer without re-allocating it are not detected.
+int lstrViewIsValid(lstrView view){
+    if(view.data == NULL) return 0;
+    if(view.source == NULL) return 1;
+
+    lString* lstr = view.source;
+    if(lstr->generation != view.generation) return 0;
+
+    //The buffer has not moved, so the view's offset within it can be computed safely
+    lstrIndex offset = (lstrIndex) (view.data - lstr->head);
+    return offset <= lstr->length && view.length <= lstr->length - offset;
+}
+
+
+//Find the first instance of the bytes in a view in the lString. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES on a failed operation (including cases where the view is empty).
+lstrIndex lstrFindView(lString* lstr, lstrView view){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+    view_check(view, MAXIMUM_STRING_BYTES);
+
+    if(view.length > lstr->length || view.length < 1) return MAXIMUM_STRING_BYTES;
+
+    lstrPattern plan;
+    planSearch(&plan, view.data, view.length);
+
+    return runSearch(&plan, lstr->head, lstr->length, 0);
+}
+
+//Insert a copy of the bytes in a view at an arbitrary point in the string. The view may point into the same string. Returns a pointer to the start of the copy, or NULL for a failed operation (including cases where the view is empty).
+char* lstrInsertView(lString* lstr, lstrIndex index, lstrView view){
+    null_check(lstr, NULL);
+    view_check(view, NULL);
+
+    lstrLength len = view.length;
+    if(len < 1) return NULL;
+
+    #ifndef NO_SAFETY
+    if(index > lstr->length) return NULL;
+    if(len > MAXIMUM_STRING_BYTES - 1 - lstr->length) return NULL;
+    #endif
+
+    //Growing the string may move its buffer, so a view of the string itself is tracked by offset
+    int self = view.data >= lstr->head && view.data < lstr->head + lstr->allocatedLength;
+    lstrIndex offset = self ? (lstrIndex) (view.data - lstr->head) : 0;
+
+    if(lstrReserve(lstr, lstr->length + len)) return NULL;
+
+    //Shift characters up (including the null terminator)
+    char* insertAddr = lstr->head + index;
+    memmove(insertAddr + len, insertAddr, lstr->length + 1 - index);
+
+    if(!self) memcpy(insertAddr, view.data, len);
+    else {
+        //Bytes of the view before the insertion point stayed put, and the rest moved up with the tail
+        lstrLength before = (offset >= index) ? 0 : (index - offset < len ? index - offset : len);
+        memcpy(insertAddr, lstr->head + offset, before);
+        memcpy(insertAddr + before, lstr->head + offset + before + len, len - before);
+    }
+
+    //Update string length
+    lstr->length += len;
+    noteEdit(lstr, index, 0, len);
+
+    return insertAddr;
+}
+
+//Insert a copy of the bytes in a view at the end of the string. The view may point into the same string. Returns a pointer to the start of the copy, or NULL for a failed operation (including cases where the view is empty).
+char* lstrAppendView(lString* lstr, lstrView view){
+    null_check(lstr, NULL);
+    return lstrInsertView(lstr, lstr->length, view);
+}
+
+//Compare two views byte by byte (as unsigned chars), with a view that is a prefix of the other ordered first. Returns a negative number, 0, or a positive number if the first view sorts before, equal to, or after the second. Invalid views compare as empty.
+int lstrCompareView(lstrView a, lstrView b){
+    //The null view, and (in builds without NO_SAFETY) stale views, compare as empty
+    if(a.data == NULL) a.length = 0;
+    if(b.data == NULL) b.length = 0;
+
+    #ifndef NO_SAFETY
+    if(a.length > 0 && !lstrViewIsValid(a)) a.length = 0;
+    if(b.length > 0 && !lstrViewIsValid(b)) b.length = 0;
+    #endif
+
+    lstrLength common = a.length < b.length ? a.length : b.length;
+    int order = (common > 0) ? memcmp(a.data, b.data, common) : 0;
+    if(order != 0) return order;
+
+    return (a.length > b.length) - (a.length < b.length);
+}
+
+//Check whether two views hold the same bytes. Returns 1 if so, or 0 if not (or if either view is invalid).
+int lstrViewEquals(lstrView a, lstrView b){
+    if(a.data == NULL || b.data == NULL) return 0;
+    view_check(a, 0);
+    view_check(b, 0);
+
+    return a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+
+//Line lookups use a flat list of newline positions. Line n starts just after newline n - 1, so finding a line is a single lookup, and finding the line that contains a byte is a binary search.
+
+//Find the number of newlines before a byte index (which is also the index, in the list, of the first newline at or after it)
+static alIndex newlinesBefore(const lstrIndex* newlines, alLength count, lstrIndex byte){
+    alIndex low = 0, high = count;
+    while(low < high){
+        alIndex mid = low + (high - low) / 2;
+        if(newlines[mid] < byte) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+//Discard the string's line index
+static void dropLineIndex(lString* lstr){
+    alFreeArrayList(lstr->lineIndex);
+    lstr->lineIndex = NULL;
+}
+
+//Build the string's line index, unless it already has one. Returns 0 for success, or 1 if allocation failed.
+static int buildLineIndex(lString* lstr){
+    if(lstr->lineIndex != NULL) return 0;
+
+    lstr->lineIndex = alNewArrayList(sizeof(lstrIndex));
+    if(lstr->lineIndex == NULL) return 1;
+
+    if(scanByte(lstr->head, 0, lstr->length, '\n', lstr->lineIndex)){
+        dropLineIndex(lstr);
+        return 1;
+    }
+
+    return 0;
+}
+
+//Update the line index after <removed> bytes at <index> have been replaced by <inserted> bytes (called by noteEdit).
+//Newlines before the edit are kept, those in the removed bytes are replaced by any in the inserted bytes, and those after it are shifted. Only the inserted bytes are scanned.
+static void patchLineIndex(lString* lstr, lstrIndex index, lstrLength removed, lstrLength inserted){
+    lstrIndex* newlines = (lstrIndex*) alGetListHead(lstr->lineIndex);
+    alLength count = alGetListLength(lstr->lineIndex);
+
+    alIndex first = newlinesBefore(newlines, count, index);
+    alIndex last = newlinesBefore(newlines, count, index + removed);
+
+    //Shift the newlines after the edit (unsigned arithmetic wraps correctly for decreases)
+    lstrLength shift = inserted - removed;
+    if(shift != 0){
+        for(alIndex i = last;i < count;i++) newlines[i] += shift;
+    }
+
+    if(last > first && alRemoveMany(lstr->lineIndex, first, last - first)){
+        dropLineIndex(lstr);
+        return;
+    }
+
+    //Most edits insert no newlines, and need no scratch list
+    if(inserted == 0 || memchr(lstr->head + index, '\n', inserted) == NULL) return;
+
+    arrayList* added = alNewArrayList(sizeof(lstrIndex));
+    if(added == NULL || scanByte(lstr->head, index, index + inserted, '\n', added) || alInsertMany(lstr->lineIndex, first, alGetListHead(added), alGetListLength(added)) == NULL) dropLineIndex(lstr);
+
+    if(added != NULL) alFreeArrayList(added);
+}
+
+
+//Get the number of lines in the string. Returns MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrLineCount(lString* lstr){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    //Without an index, a plain count is cheaper than building one
+    if(lstr->lineIndex == NULL) return countByte(lstr->head, lstr->length, '\n') + 1;
+
+    return alGetListLength(lstr->lineIndex) + 1;
+}
+
+//Get the byte index at which a line starts. Returns MAXIMUM_STRING_BYTES if the line is out of bounds or the operation fails.
+lstrIndex lstrLineStart(lString* lstr, lstrIndex line){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(buildLineIndex(lstr)) return MAXIMUM_STRING_BYTES;
+    if(line > alGetListLength(lstr->lineIndex)) return MAXIMUM_STRING_BYTES;
+
+    return line == 0 ? 0 : ((const lstrIndex*) alGetListHead(lstr->lineIndex))[line - 1] + 1;
+}
+
+//Make a view of a line, excluding its '\n'. Returns the null view if the line is out of bounds or the operation fails.
+lstrView lstrLineView(lString* lstr, lstrIndex line){
+    lstrIndex start = lstrLineStart(lstr, line);
+    if(start == MAXIMUM_STRING_BYTES) return nullView;
+
+    //The last line runs to the end of the string
+    alLength count = alGetListLength(lstr->lineIndex);
+    lstrIndex end = line < count ? ((const lstrIndex*) alGetListHead(lstr->lineIndex))[line] : lstr->length;
+
+    return viewInto(lstr, start, end - start);
+}
+
+//Get the number of the line that contains a byte index. A '\n' belongs to the line it ends, and the string's length (just past the last byte) belongs to the last line. Returns MAXIMUM_STRING_BYTES if the index is out of bounds or the operation fails.
+lstrIndex lstrLineOf(lString* lstr, lstrIndex byte){
+    null_check(lstr, MAXIMUM_STRING_BYTES);
+
+    if(byte > lstr->length) return MAXIMUM_STRING_BYTES;
+    if(buildLineIndex(lstr)) return MAXIMUM_STRING_BYTES;
+
+    return newlinesBefore((const lstrIndex*) alGetListHead(lstr->lineIndex), alGetListLength(lstr->lineIndex), byte);
+}
+
+//Discard the string's line index to free its memory. It is rebuilt when next needed.
+void lstrDropLineIndex(lString* lstr){
+    void_null_check(lstr);
+    if(lstr->lineIndex != NULL) dropLineIndex(lstr);
+}
+
+
+//Splitting scans for delimiters 16 bytes at a time and returns spans of the original string, so no field is copied or allocated
+
+//Delimiter sets with at most this many bytes are scanned with one SSE2 compare per delimiter; larger sets are checked a byte at a time against a table
+#define SPLIT_VECTOR_DELIMITERS 8
+
+//Set up a splitter for <count> distinct delimiter bytes
+static void initSplitter(lstrSplitter* splitter, lString* lstr, const char* delimiters, int count, int skipEmpty){
+    splitter->source = lstr;
+    splitter->position = 0;
+    splitter->skipEmpty = skipEmpty;
+    splitter->delimiterCount = count;
+    memcpy(splitter->delimiters, delimiters, count);
+
+    memset(splitter->isDelimiter, 0, sizeof(splitter->isDelimiter));
+    for(int i = 0; i < count; i++) splitter->isDelimiter[(unsigned char) delimiters[i]] = 1;
+}
+
+//Find the first delimiter at or after <from>. Returns its index, or <len> if there is none.
+static lstrIndex nextDelimiter(const lstrSplitter* splitter, const char* str, lstrIndex from, lstrLength len){
+    //Single delimiters are best handled by the C library's vectorized memchr
+    if(splitter->delimiterCount == 1){
+        const char* found = (const char*) memchr(str + from, splitter->delimiters[0], len - from);
+        return found == NULL ? len : (lstrIndex) (found - str);
+    }
+
+    #ifdef __SSE2__
+    if(splitter->delimiterCount <= SPLIT_VECTOR_DELIMITERS){
+        __m128i delimiters[SPLIT_VECTOR_DELIMITERS];
+        for(int i = 0; i < splitter->delimiterCount; i++) delimiters[i] = _mm_set1_epi8((char) splitter->delimiters[i]);
+
+        while(from + 16 <= len){
+            __m128i block = _mm_loadu_si128((const __m128i*) (str + from));
+            __m128i matches = _mm_cmpeq_epi8(block, delimiters[0]);
+            for(int i = 1; i < splitter->delimiterCount; i++) matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, delimiters[i]));
+
+            unsigned int mask = _mm_movemask_epi8(matches);
+            if(mask != 0) return from + __builtin_ctz(mask);
+            from += 16;
+        }
+    }
+    #endif
+
+    for(;from < len;from++){
+        if(splitter->isDelimiter[(unsigned char) str[from]]) return from;
+    }
+
+    return len;
+}
+
+//Number of spans collectFields gathers on the stack before adding them to the arrayList in one call
+#define SPLIT_BATCH_SPANS 256
+
+//Add the field from <start> to <end> to a batch of spans, moving the batch into the arrayList when it fills up. Returns 0 for success, or 1 if allocation failed.
+static int emitField(arrayList* fields, lstrSpan* batch, int* count, int skipEmpty, lstrIndex start, lstrIndex end){
+    if(skipEmpty && end == start) return 0;
+
+    batch[*count].offset = start;
+    batch[*count].length = end - start;
+
+    if(++*count == SPLIT_BATCH_SPANS){
+        *count = 0;
+        if(alAppendMany(fields, batch, SPLIT_BATCH_SPANS) == NULL) return 1;
+    }
+
+    return 0;
+}
+
+//Collect every field of a newly started splitter into a new arrayList of lstrSpan. Returns NULL if allocation failed.
+//Unlike lstrSplitNext, this makes a single pass that handles every delimiter in each 16-byte block, instead of restarting the scan once per field.
+static arrayList* collectFields(lstrSplitter* splitter){
+    arrayList* fields = alNewArrayList(sizeof(lstrSpan));
+    if(fields == NULL) return NULL;
+
+    const char* str = splitter->source->head;
+    lstrLength len = splitter->source->length;
+    int skipEmpty = splitter->skipEmpty;
+
+    lstrSpan batch[SPLIT_BATCH_SPANS];
+    int count = 0;
+    int failed = 0;
+    lstrIndex start = 0;
+    lstrIndex pos = 0;
+
+    #ifdef __SSE2__
+    if(splitter->delimiterCount <= SPLIT_VECTOR_DELIMITERS){
+        __m128i delimiters[SPLIT_VECTOR_DELIMITERS];
+        for(int i = 0; i < splitter->delimiterCount; i++) delimiters[i] = _mm_set1_epi8((char) splitter->delimiters[i]);
+
+        for(;pos + 16 <= len && !failed;pos += 16){
+            __m128i block = _mm_loadu_si128((const __m128i*) (str + pos));
+            __m128i matches = _mm_cmpeq_epi8(block, delimiters[0]);
+            for(int i = 1; i < splitter->delimiterCount; i++) matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, delimiters[i]));
+
+            unsigned int mask = _mm_movemask_epi8(matches);
+            while(mask != 0 && !failed){
+                lstrIndex delimiter = pos + __builtin_ctz(mask);
+                failed = emitField(fields, batch, &count, skipEmpty, start, delimiter);
+                start = delimiter + 1;
+                mask &= mask - 1;
+            }
+        }
+    }
+    #endif
+
+    for(;pos < len && !failed;pos++){
+        if(!splitter->isDelimiter[(unsigned char) str[pos]]) continue;
+        failed = emitField(fields, batch, &count, skipEmpty, start, pos);
+        start = pos + 1;
+    }
+
+    //The last field runs to the end of the string
+    if(!failed) failed = emitField(fields, batch, &count, skipEmpty, start, len);
+    if(!failed && count > 0) failed = alAppendMany(fields, batch, count) == NULL;
+
+    if(failed){
+        alFreeArrayList(fields);
+        return NULL;
+    }
+
+    splitter->position = MAXIMUM_STRING_BYTES;
+    return fields;
+}
+
+//Split the string at every instance of a delimiter byte. Every field is returned, including empty ones, so n delimiters always give n + 1 fields. Returns an arrayList of lstrSpan, or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrSplit(lString* lstr, char delimiter){
+    lstrSplitter splitter;
+    if(lstrSplitStart(&splitter, lstr, delimiter)) return NULL;
+
+    return collectFields(&splitter);
+}
+
+//Split the string into tokens separated by runs of any of the bytes in a null-terminated delimiter set. Empty tokens are skipped, so a string of only delimiters gives no tokens. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails (including cases where the delimiter set is empty).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrTokenize(lString* lstr, char* delimiters){
+    lstrSplitter splitter;
+    if(lstrTokenizeStart(&splitter, lstr, delimiters)) return NULL;
+
+    return collectFields(&splitter);
+}
+
+//Start a streaming split of the string at a delimiter byte, with the same fields as lstrSplit. Returns 0 for success, or 1 if the operation fails.
+int lstrSplitStart(lstrSplitter* splitter, lString* lstr, char delimiter){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(splitter == NULL) return 1;
+    #endif
+
+    initSplitter(splitter, lstr, &delimiter, 1, 0);
+    return 0;
+}
+
+//Start a streaming tokenization of the string with a null-terminated delimiter set, with the same tokens as lstrTokenize. Returns 0 for success, or 1 if the operation fails (including cases where the delimiter set is empty).
+int lstrTokenizeStart(lstrSplitter* splitter, lString* lstr, char* delimiters){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(splitter == NULL || delimiters == NULL) return 1;
+    #endif
+
+    //Keep only the first instance of each delimiter, so that repeated bytes do not cost extra compares
+    char distinct[256];
+    unsigned char seen[256] = {0};
+    int count = 0;
+    for(const char* d = delimiters; *d != '\0'; d++){
+        if(seen[(unsigned char) *d]) continue;
+        seen[(unsigned char) *d] = 1;
+        distinct[count++] = *d;
+    }
+
+    if(count < 1) return 1;
+
+    initSplitter(splitter, lstr, distinct, count, 1);
+    return 0;
+}
+
+//Get the next field of a streaming split or tokenization. Returns 0 if a field was stored in <span>, or 1 once every field has been returned or if the operation fails.
+int lstrSplitNext(lstrSplitter* splitter, lstrSpan* span){
+    #ifndef NO_SAFETY
+    if(splitter == NULL || span == NULL || splitter->source == NULL || splitter->source->head == NULL) return 1;
+    #endif
+
+    const char* str = splitter->source->head;
+    lstrLength len = splitter->source->length;
+    lstrIndex start = splitter->position;
+
+    if(start == MAXIMUM_STRING_BYTES) return 1;
+
+    #ifndef NO_SAFETY
+    //The string has been shortened since splitting started
+    if(start > len) return 1;
+    #endif
+
+    if(splitter->skipEmpty){
+        while(start < len && splitter->isDelimiter[(unsigned char) str[start]]) start++;
+
+        if(start >= len){
+            splitter->position = MAXIMUM_STRING_BYTES;
+            return 1;
+        }
+    }
+
+    lstrIndex end = nextDelimiter(splitter, str, start, len);
+    span->offset = start;
+    span->length = end - start;
+
+    //Continue after the delimiter, or finish if the field ran to the end of the string
+    splitter->position = (end < len) ? end + 1 : MAXIMUM_STRING_BYTES;
+
+    return 0;
+}
+
+//Make a view of a span of the string. Returns the null view if the span is out of bounds or the string is invalid.
+lstrView lstrSpanView(lString* lstr, lstrSpan span){
+    null_check(lstr, nullView);
+
+    if(span.offset > lstr->length || span.length > lstr->length - span.offset) return nullView;
+
+    return viewInto(lstr, span.offset, span.length);
+}
+
+
+//Create a new string of exactly <len> characters, to be filled in by the caller. Returns NULL if allocation failed or the length is too large.
+static lString* newJoinedString(lstrLength len){
+    if(len > MAXIMUM_STRING_BYTES - 1) return NULL;
+
+    lString* joined = lstrNewLenString(len + 1);
+    if(joined == NULL) return NULL;
+
+    joined->length = len;
+    return joined;
+}
+
+//Join an arrayList of lstrView into a new string, with a null-terminated separator (which may be NULL or empty for none) between each pair. The result is allocated once, at its exact size. Returns the new string (which is empty for an empty list), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrJoin(arrayList* views, char* separator){
+    #ifndef NO_SAFETY
+    if(views == NULL || views->head == NULL || views->size != sizeof(lstrView)) return NULL;
+    #endif
+
+    lstrLength sepLen = (separator == NULL) ? 0 : strlen(separator);
+    lstrView* parts = (lstrView*) views->head;
+    alLength count = views->length;
+
+    //Measure the result first, so it is allocated exactly once. Null views join as empty strings.
+    lstrLength total = 0;
+    for(alIndex i = 0; i < count; i++){
+        view_check(parts[i], NULL);
+        lstrLength partLen = (parts[i].data == NULL) ? 0 : parts[i].length;
+
+        if(i > 0){
+            if(sepLen > MAXIMUM_STRING_BYTES - 1 - total) return NULL;
+            total += sepLen;
+        }
+        if(partLen > MAXIMUM_STRING_BYTES - 1 - total) return NULL;
+        total += partLen;
+    }
+
+    lString* joined = newJoinedString(total);
+    if(joined == NULL) return NULL;
+
+    char* write = joined->head;
+    for(alIndex i = 0; i < count; i++){
+        if(i > 0){
+            memcpy(write, separator, sepLen);
+            write += sepLen;
+        }
+        if(parts[i].data == NULL) continue;
+
+        memcpy(write, parts[i].data, parts[i].length);
+        write += parts[i].length;
+    }
+
+    return joined;
+}
+
+//Join an arrayList of lstrSpan of a source string into a new string, with a null-terminated separator (which may be NULL or empty for none) between each pair. The result is allocated once, at its exact size. Returns the new string (which is empty for an empty list), or NULL if the operation fails (including cases where a span is out of bounds).
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrJoinSpans(lString* lstr, arrayList* spans, char* separator){
     null_check(lstr, NULL);
 
-    //Make a copy of the string
-    char* copy = malloc(lstr->length + 1);
-    strcpy(copy, lstr->head);
+    #ifndef NO_SAFETY
+    if(spans == NULL || spans->head == NULL || spans->size != sizeof(lstrSpan)) return NULL;
+    #endif
+
+    lstrLength sepLen = (separator == NULL) ? 0 : strlen(separator);
+    lstrSpan* parts = (lstrSpan*) spans->head;
+    alLength count = spans->length;
+
+    //Measure the result first, so it is allocated exactly once
+    lstrLength total = 0;
+    for(alIndex i = 0; i < count; i++){
+        if(parts[i].offset > lstr->length || parts[i].length > lstr->length - parts[i].offset) return NULL;
+
+        if(i > 0){
+            if(sepLen > MAXIMUM_STRING_BYTES - 1 - total) return NULL;
+            total += sepLen;
+        }
+        if(parts[i].length > MAXIMUM_STRING_BYTES - 1 - total) return NULL;
+        total += parts[i].length;
+    }
+
+    lString* joined = newJoinedString(total);
+    if(joined == NULL) return NULL;
+
+    char* write = joined->head;
+    for(alIndex i = 0; i < count; i++){
+        if(i > 0){
+            memcpy(write, separator, sepLen);
+            write += sepLen;
+        }
+        memcpy(write, lstr->head + parts[i].offset, parts[i].length);
+        write += parts[i].length;
+    }
+
+    return joined;
+}
+
+
+//Hashing follows the structure of wyhash: the input is read eight bytes at a time, and each pair of words is mixed by a full 64x64-bit to 128-bit multiplication
+
+//Constants that the hash mixes into the input (odd 64-bit values with evenly balanced bits)
+static const unsigned long hashSecret[4] = {0xa0761d6478bd642fUL, 0xe7037ed1a0b428dbUL, 0x8ebc6af09c88c6e3UL, 0x589965cc75374cc3UL};
+
+//Multiply two words into 128 bits and fold the halves together
+static unsigned long hashMix(unsigned long a, unsigned long b){
+    unsigned __int128 product = (unsigned __int128) a * b;
+    return (unsigned long) product ^ (unsigned long) (product >> 64);
+}
+
+//Read 8 or 4 bytes of possibly unaligned input
+static unsigned long read64(const unsigned char* p){
+    unsigned long word;
+    memcpy(&word, p, 8);
+    return word;
+}
+
+static unsigned long read32(const unsigned char* p){
+    unsigned int word;
+    memcpy(&word, p, 4);
+    return word;
+}
+
+//Hash <len> bytes of memory, which may include '\0', with a fast, high-quality non-cryptographic hash. Equal byte sequences always have equal hashes.
+unsigned long lstrHashBytes(const char* bytes, lstrLength len){
+    const unsigned char* p = (const unsigned char*) bytes;
+    unsigned long seed = hashMix(hashSecret[0], hashSecret[1]);
+    unsigned long a, b;
+
+    if(len <= 16){
+        //Short inputs are covered by (possibly overlapping) reads from both ends
+        if(len >= 4){
+            lstrLength shift = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + shift);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - shift);
+        }
+        else if(len > 0){
+            a = ((unsigned long) p[0] << 16) | ((unsigned long) p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        }
+        else a = b = 0;
+    }
+    else {
+        lstrLength left = len;
+
+        //Long inputs are consumed 48 bytes at a time in three independent lanes
+        if(left > 48){
+            unsigned long lane1 = seed, lane2 = seed;
+            do {
+                seed = hashMix(read64(p) ^ hashSecret[1], read64(p + 8) ^ seed);
+                lane1 = hashMix(read64(p + 16) ^ hashSecret[2], read64(p + 24) ^ lane1);
+                lane2 = hashMix(read64(p + 32) ^ hashSecret[3], read64(p + 40) ^ lane2);
+                p += 48;
+                left -= 48;
+            } while(left > 48);
+            seed ^= lane1 ^ lane2;
+        }
+
+        while(left > 16){
+            seed = hashMix(read64(p) ^ hashSecret[1], read64(p + 8) ^ seed);
+            p += 16;
+            left -= 16;
+        }
+
+        //The last 16 bytes (which may overlap bytes already mixed in)
+        a = read64(p + left - 16);
+        b = read64(p + left - 8);
+    }
+
+    unsigned __int128 product = (unsigned __int128) (a ^ hashSecret[1]) * (b ^ seed);
+    a = (unsigned long) product;
+    b = (unsigned long) (product >> 64);
+
+    return hashMix(a ^ hashSecret[0] ^ len, b ^ hashSecret[1]);
+}
+
+//Get the hash of the string's contents, as computed by lstrHashBytes. The hash is cached in the string until the string is next modified, so repeated calls are O(1). Returns 0 for an invalid string.
+unsigned long lstrHash(lString* lstr){
+    null_check(lstr, 0);
+
+    if(!lstr->hashValid){
+        lstr->hash = lstrHashBytes(lstr->head, lstr->length);
+        lstr->hashValid = 1;
+    }
+
+    return lstr->hash;
+}
+
+//Get the hash of the bytes in a view, as computed by lstrHashBytes. A view of an entire lString uses (and fills) the string's cached hash. Returns 0 for an invalid view.
+unsigned long lstrHashView(lstrView view){
+    if(view.data == NULL) return 0;
+    view_check(view, 0);
+
+    if(view.source != NULL && view.data == view.source->head && view.length == view.source->length) return lstrHash(view.source);
+
+    return lstrHashBytes(view.data, view.length);
+}
+
+
+//Comparison rejects on length (and on cached hashes, when both strings have one) before reading any bytes. Byte comparison uses the C library's vectorized memcmp, and case-insensitive comparison folds and compares 16 or 32 bytes per step.
+
+//Lowercase an ASCII byte
+#define foldByte(c) ((unsigned char) (c) | (((unsigned char) (c) - 'A' < 26u) << 5))
+
+//Get the contents of a string for comparison. Invalid strings compare as empty.
+static const char* compareBytes(lString* lstr, lstrLength* len){
+    if(lstr == NULL || lstr->head == NULL){
+        *len = 0;
+        return "";
+    }
+
+    *len = lstr->length;
+    return lstr->head;
+}
+
+//Get the contents of a view for comparison. The null view, and (in builds without NO_SAFETY) stale views, compare as empty.
+static const char* compareViewBytes(lstrView view, lstrLength* len){
+    *len = view.length;
+    if(view.data == NULL) *len = 0;
+
+    #ifndef NO_SAFETY
+    if(*len > 0 && !lstrViewIsValid(view)) *len = 0;
+    #endif
+
+    return *len > 0 ? view.data : "";
+}
+
+//Find the first index at which two buffers differ once ASCII letters are lowercased. Returns <len> if they do not differ.
+static lstrIndex foldedDifferenceScalar(const char* a, const char* b, lstrLength len){
+    lstrIndex i = 0;
+    while(i < len && foldByte(a[i]) == foldByte(b[i])) i++;
+    return i;
+}
+
+#ifdef __SSE2__
+//Lowercase every ASCII letter in a vector
+static __m128i foldSSE2(__m128i v){
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+//SSE2 version of foldedDifferenceScalar, 16 bytes at a time
+static lstrIndex foldedDifferenceSSE2(const char* a, const char* b, lstrLength len){
+    lstrIndex i = 0;
+    for(;i + 16 <= len;i += 16){
+        __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+
+        //Most bytes match exactly, so only vectors that differ need folding
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF) continue;
+
+        unsigned int differ = ~_mm_movemask_epi8(_mm_cmpeq_epi8(foldSSE2(va), foldSSE2(vb))) & 0xFFFF;
+        if(differ != 0) return i + __builtin_ctz(differ);
+    }
+
+    return i + foldedDifferenceScalar(a + i, b + i, len - i);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//AVX2 version of foldedDifferenceScalar, 32 bytes at a time
+__attribute__((target("avx2")))
+static lstrIndex foldedDifferenceAVX2(const char* a, const char* b, lstrLength len){
+    const __m256i below = _mm256_set1_epi8('A' - 1);
+    const __m256i above = _mm256_set1_epi8('Z' + 1);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+
+    lstrIndex i = 0;
+    for(;i + 32 <= len;i += 32){
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+
+        //Most bytes match exactly, so only vectors that differ need folding
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)) == -1) continue;
+
+        va = _mm256_or_si256(va, _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi8(va, below), _mm256_cmpgt_epi8(above, va)), flip));
+        vb = _mm256_or_si256(vb, _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi8(vb, below), _mm256_cmpgt_epi8(above, vb)), flip));
+
+        unsigned int differ = ~(unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        if(differ != 0) return i + __builtin_ctz(differ);
+    }
+
+    return i + foldedDifferenceScalar(a + i, b + i, len - i);
+}
+#endif
+
+//Find the first index at which two buffers differ, ignoring ASCII case, using the widest kernel the processor supports. Short buffers skip the processor check.
+static lstrIndex foldedDifference(const char* a, const char* b, lstrLength len){
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(len >= 64 && __builtin_cpu_supports("avx2")) return foldedDifferenceAVX2(a, b, len);
+    #endif
+
+    #ifdef __SSE2__
+    return foldedDifferenceSSE2(a, b, len);
+    #else
+    return foldedDifferenceScalar(a, b, len);
+    #endif
+}
+
+//Order two buffers by bytes (as unsigned chars), with a buffer that is a prefix of the other ordered first
+static int compareRaw(const char* a, lstrLength aLen, const char* b, lstrLength bLen){
+    lstrLength common = aLen < bLen ? aLen : bLen;
+    int order = (common > 0) ? memcmp(a, b, common) : 0;
+    if(order != 0) return order;
+
+    return (aLen > bLen) - (aLen < bLen);
+}
+
+//Order two buffers by bytes with ASCII letters lowercased
+static int compareFolded(const char* a, lstrLength aLen, const char* b, lstrLength bLen){
+    lstrLength common = aLen < bLen ? aLen : bLen;
+    lstrIndex i = foldedDifference(a, b, common);
+    if(i < common) return (int) foldByte(a[i]) - (int) foldByte(b[i]);
+
+    return (aLen > bLen) - (aLen < bLen);
+}
+
+//Check whether a byte is an ASCII digit
+#define isDigitByte(c) ((unsigned char) (c) - '0' < 10u)
+
+//Order two buffers naturally: runs of digits compare by numeric value, and all other bytes compare as unsigned chars.
+//Runs with equal values but different numbers of leading zeros are only told apart if nothing else differs, with fewer zeros ordered first.
+static int compareNatural(const char* a, lstrLength aLen, const char* b, lstrLength bLen){
+    //Identical leading bytes can be skipped in bulk, except that a digit run which continues past the first difference must be compared from its start
+    lstrLength common = aLen < bLen ? aLen : bLen;
+    lstrIndex i = 0;
+    while(i < common && a[i] == b[i]){
+        lstrLength step = common - i < 16 ? common - i : 16;
+        if(memcmp(a + i, b + i, step) != 0){
+            while(a[i] == b[i]) i++;
+            break;
+        }
+        i += step;
+    }
+    while(i > 0 && isDigitByte(a[i - 1])) i--;
+
+    lstrIndex j = i;
+    int zeroOrder = 0;
+
+    while(i < aLen && j < bLen){
+        if(isDigitByte(a[i]) && isDigitByte(b[j])){
+            //Skip leading zeros, then a run with more significant digits is larger, and runs of the same length compare digit by digit
+            lstrIndex aZeros = i, bZeros = j;
+            while(i < aLen && a[i] == '0') i++;
+            while(j < bLen && b[j] == '0') j++;
+
+            lstrIndex aStart = i, bStart = j;
+            while(i < aLen && isDigitByte(a[i])) i++;
+            while(j < bLen && isDigitByte(b[j])) j++;
+
+            lstrLength aDigits = i - aStart, bDigits = j - bStart;
+            if(aDigits != bDigits) return aDigits < bDigits ? -1 : 1;
+
+            int order = memcmp(a + aStart, b + bStart, aDigits);
+            if(order != 0) return order;
+
+            if(zeroOrder == 0) zeroOrder = ((aStart - aZeros) > (bStart - bZeros)) - ((aStart - aZeros) < (bStart - bZeros));
+            continue;
+        }
+
+        if(a[i] != b[j]) return (int) (unsigned char) a[i] - (int) (unsigned char) b[j];
+        i++;
+        j++;
+    }
+
+    if(i < aLen) return 1;
+    if(j < bLen) return -1;
+    return zeroOrder;
+}
+
+
+//Compare two strings byte by byte (as unsigned chars), with a string that is a prefix of the other ordered first. Returns a negative number, 0, or a positive number if the first string sorts before, equal to, or after the second. Invalid strings compare as empty.
+int lstrCompare(lString* a, lString* b){
+    lstrLength aLen, bLen;
+    const char* aBytes = compareBytes(a, &aLen);
+    const char* bBytes = compareBytes(b, &bLen);
+
+    return compareRaw(aBytes, aLen, bBytes, bLen);
+}
+
+//Check whether two strings hold the same bytes. Strings of different lengths, or with different cached hashes, are rejected without reading their contents. Returns 1 if so, or 0 if not (or if either string is invalid).
+int lstrEquals(lString* a, lString* b){
+    null_check(a, 0);
+    null_check(b, 0);
+
+    if(a->length != b->length) return 0;
+    if(a->hashValid && b->hashValid && a->hash != b->hash) return 0;
+
+    return a == b || memcmp(a->head, b->head, a->length) == 0;
+}
 
-    //Do not perform unnecessary loop operations
-    if(lstr->length < 1) return copy;
+//Compare two strings with ASCII letters treated as lowercase, so "Apple" and "apple" compare equal and both sort before "banana". Returns a negative number, 0, or a positive number as lstrCompare does. Invalid strings compare as empty.
+int lstrCompareIgnoreCase(lString* a, lString* b){
+    lstrLength aLen, bLen;
+    const char* aBytes = compareBytes(a, &aLen);
+    const char* bBytes = compareBytes(b, &bLen);
 
-    //Iterate over the string and modify characters appropriately
-    for(lstrLength i = 0;i < lstr->length;i++){
-        if(copy[i] >= 'a' && copy[i] <= 'z'){
-            copy[i] -= 32; //Those ASCII guys might've ignored non-English languages, but making 'a' - 'A' = 32 was ingenious.
-        }
-    }
+    return compareFolded(aBytes, aLen, bBytes, bLen);
+}
 
-    return copy;
+//Check whether two strings hold the same bytes once ASCII letters are lowercased. Returns 1 if so, or 0 if not (or if either string is invalid).
+int lstrEqualsIgnoreCase(lString* a, lString* b){
+    null_check(a, 0);
+    null_check(b, 0);
+
+    if(a->length != b->length) return 0;
+
+    return foldedDifference(a->head, b->head, a->length) == a->length;
 }
 
-//For ASCII characters only, return a copy of the string where all alphabetical characters are lowercase. Returns a pointer to the new string, or NULL if the operation fails. The returned string may be empty.
-//This function dynamically allocates memory, and its return value must be freed.
-char* lstrToLower(lString* lstr){
-    null_check(lstr, NULL);
+//Compare two strings in natural order, where runs of ASCII digits compare by their numeric value, so "file9" sorts before "file10". Other bytes compare as unsigned chars. Returns a negative number, 0, or a positive number as lstrCompare does. Invalid strings compare as empty.
+int lstrCompareNatural(lString* a, lString* b){
+    lstrLength aLen, bLen;
+    const char* aBytes = compareBytes(a, &aLen);
+    const char* bBytes = compareBytes(b, &bLen);
 
-    //Make a copy of the string
-    char* copy = malloc(lstr->length + 1);
-    strcpy(copy, lstr->head);
+    return compareNatural(aBytes, aLen, bBytes, bLen);
+}
 
-    //Do not perform unnecessary loop operations
-    if(lstr->length < 1) return copy;
+//Compare two views with ASCII letters treated as lowercase. Returns a negative number, 0, or a positive number as lstrCompareView does. Invalid views compare as empty.
+int lstrCompareViewIgnoreCase(lstrView a, lstrView b){
+    lstrLength aLen, bLen;
+    const char* aBytes = compareViewBytes(a, &aLen);
+    const char* bBytes = compareViewBytes(b, &bLen);
 
-    //Iterate over the string and modify characters appropriately
-    for(lstrLength i = 0;i < lstr->length;i++){
-        if(copy[i] >= 'A' && copy[i] <= 'Z'){
-            copy[i] += 32;
-        }
-    }
+    return compareFolded(aBytes, aLen, bBytes, bLen);
+}
+
+//Compare two views in natural order, as lstrCompareNatural does. Invalid views compare as empty.
+int lstrCompareViewNatural(lstrView a, lstrView b){
+    lstrLength aLen, bLen;
+    const char* aBytes = compareViewBytes(a, &aLen);
+    const char* bBytes = compareViewBytes(b, &bLen);
+
+    return compareNatural(aBytes, aLen, bBytes, bLen);
+}
+
+
+//Check whether the string starts with a null-terminated prefix. Returns 1 if so (including for an empty prefix), or 0 if not or if the operation fails.
+int lstrStartsWith(lString* lstr, char* prefix){
+    #ifndef NO_SAFETY
+    if(prefix == NULL) return 0;
+    #endif
+
+    return lstrStartsWithView(lstr, lstrViewOf(prefix));
+}
+
+//Check whether the string ends with a null-terminated suffix. Returns 1 if so (including for an empty suffix), or 0 if not or if the operation fails.
+int lstrEndsWith(lString* lstr, char* suffix){
+    #ifndef NO_SAFETY
+    if(suffix == NULL) return 0;
+    #endif
+
+    return lstrEndsWithView(lstr, lstrViewOf(suffix));
+}
+
+//Check whether the string starts with the bytes in a view. Returns 1 if so (including for an empty view), or 0 if not or if the operation fails.
+int lstrStartsWithView(lString* lstr, lstrView prefix){
+    null_check(lstr, 0);
+    if(prefix.data == NULL) return 0;
+    view_check(prefix, 0);
+
+    return prefix.length <= lstr->length && memcmp(lstr->head, prefix.data, prefix.length) == 0;
+}
 
-    return copy;
+//Check whether the string ends with the bytes in a view. Returns 1 if so (including for an empty view), or 0 if not or if the operation fails.
+int lstrEndsWithView(lString* lstr, lstrView suffix){
+    null_check(lstr, 0);
+    if(suffix.data == NULL) return 0;
+    view_check(suffix, 0);
+
+    return suffix.length <= lstr->length && memcmp(lstr->head + lstr->length - suffix.length, suffix.data, suffix.length) == 0;
+}
+
+
+//Comparison functions for alSort (or qsort). Each is passed pointers to two elements of an arrayList of lString* (or of lstrView, for lstrSortCompareView), and orders them as the matching compare function does.
+int lstrSortCompare(const void* a, const void* b){
+    return lstrCompare(*(lString* const*) a, *(lString* const*) b);
+}
+
+int lstrSortCompareIgnoreCase(const void* a, const void* b){
+    return lstrCompareIgnoreCase(*(lString* const*) a, *(lString* const*) b);
+}
+
+int lstrSortCompareNatural(const void* a, const void* b){
+    return lstrCompareNatural(*(lString* const*) a, *(lString* const*) b);
+}
+
+int lstrSortCompareView(const void* a, const void* b){
+    return lstrCompareView(*(const lstrView*) a, *(const lstrView*) b);
 }
 
 
@@ -785,7 +3533,7 @@ int lstrOverwrite(lString* lstr, char* str){
     lstrLength len = strlen(str);
 
     //Expand the string, if necessary
-    while(lstr->allocatedLength < len + 1){
+    while(lstr->allocatedLength - 1 < len){
         lstrLength oldLen = lstr->allocatedLength;
         if(expandLString(lstr) <= oldLen) return 1;
     }
@@ -800,12 +3548,14 @@ int lstrOverwrite(lString* lstr, char* str){
     memset(lstr->head + len, '\0', lstr->allocatedLength - len);
 
     //Update string length
+    lstrLength oldLength = lstr->length;
     lstr->length = len;
+    noteEdit(lstr, 0, oldLength, len);
 
     return 0;
 }
 
-//Return a reversed copy of the string. Returns NULL if the operation fails (including cases where the original string is empty).
+//Return a reversed copy of the string. Bytes are reversed, so multi-byte UTF-8 characters are not preserved. Returns NULL if the operation fails (including cases where the original string is empty).
 //This function dynamically allocates memory, and its return value must be freed.
 char* lstrReverse(lString* lstr){
     null_check(lstr, NULL);
@@ -814,29 +3564,539 @@ char* lstrReverse(lString* lstr){
     if(lstr->length < 1) return NULL;
     #endif
 
-    //Allocate the new string
     char* output = (char*) malloc(lstr->length + 1);
+    if(output == NULL) return NULL;
 
-    //Initialise the new string to '\0' (also solves null termination)
-    memset(output, '\0', lstr->length + 1);
+    //Copy the whole string (which may contain '\0'), then reverse the copy with the vectorized kernel
+    memcpy(output, lstr->head, lstr->length);
+    output[lstr->length] = '\0';
+    alReverseElements(output, lstr->length, 1);
 
-    //Copy the original string, character by character, into the new one
-    char* i = lstr->head;
-    char* j = output + lstr->length - 1;
-    while(*i != '\0'){
-        *j = *i;
-        i++;
-        j--;
+    return output;
+}
+
+//Reverse the bytes of the string in place. Multi-byte UTF-8 characters are not preserved. Returns 0 for success, or 1 if the operation fails.
+int lstrReverseInPlace(lString* lstr){
+    null_check(lstr, 1);
+
+    alReverseElements(lstr->head, lstr->length, 1);
+    noteEdit(lstr, 0, lstr->length, lstr->length);
+
+    return 0;
+}
+
+
+//Binary serialization uses the same frame format as arrayList (see alWriteFd), with an element size of 1 and LSTR_FRAME_MAGIC
+
+//Write the string (excluding the null terminator) to a (blocking) file descriptor as a frame. Returns 0 for success, or 1 if the string is bad or writing failed. On a non-blocking file descriptor, use lstrWriteFdPartial instead.
+int lstrWriteFd(lString* lstr, int fd){
+    alFrameWriter writer;
+    alInitFrameWriter(&writer);
+
+    //A blocking file descriptor never reports that it would block, so a single call writes the whole frame
+    return lstrWriteFdPartial(lstr, &writer, fd) == 0 ? 0 : 1;
+}
+
+//Continue a streaming write of the string to a (possibly non-blocking) file descriptor, using an alFrameWriter prepared with alInitFrameWriter. The string must not be modified until the write finishes.
+//Returns 0 once the whole frame has been written, 1 if the string is bad or writing failed, or 2 if the file descriptor would block and the call should be repeated later.
+int lstrWriteFdPartial(lString* lstr, alFrameWriter* writer, int fd){
+    null_check(lstr, 1);
+    return alWriteFrame(writer, fd, LSTR_FRAME_MAGIC, 1, lstr->length, lstr->head);
+}
+
+//Read a frame from a (blocking) file descriptor and append its contents to the string, reading directly into the string's spare capacity. Returns 0 for success, or 1 if the operation fails, in which case the string is unchanged.
+int lstrReadFd(lString* lstr, int fd){
+    alFrameReader reader;
+    alInitFrameReader(&reader);
+
+    //A blocking file descriptor never reports that it would block, so a single call reads the whole frame
+    return lstrReadFdPartial(lstr, &reader, fd) == 0 ? 0 : 1;
+}
+
+//Continue a streaming read from a (possibly non-blocking) file descriptor, appending the frame's contents to the string once they are complete. The string must not be modified until the read finishes, but it stays null-terminated throughout.
+//The string's capacity grows as the payload arrives, rather than to the length the frame header claims.
+//Returns 0 once the frame has been appended, 1 if the operation fails (the string is unchanged), or 2 if the file descriptor would block and the call should be repeated later.
+int lstrReadFdPartial(lString* lstr, alFrameReader* reader, int fd){
+    null_check(lstr, 1);
+
+    //Finish reading the header first
+    if(reader->headerBytes < sizeof(alFrameHeader)){
+        int status = alReadFrameHeader(reader, fd, LSTR_FRAME_MAGIC);
+        if(status != 0) return status;
+
+        if(reader->header.size != 1) return 1;
+        if(reader->header.length > MAXIMUM_STRING_BYTES - 1 - lstr->length) return 1;
     }
 
-    return output;
+    //Read the payload directly past the end of the string, holding back its first byte until it is complete so that the terminator at head[length] stays in place. The unused characters after the payload are already '\0'.
+    int status = 3;
+
+    while(status == 3){
+        //Make room for at most one more block of the payload (and the null terminator) than has arrived
+        unsigned long remaining = reader->header.length - reader->payloadBytes;
+        unsigned long wanted = reader->payloadBytes + (remaining < FRAME_READ_BLOCK ? remaining : FRAME_READ_BLOCK);
+
+        while(lstr->allocatedLength - (lstr->length + 1) < wanted){
+            lstrLength oldLen = lstr->allocatedLength;
+            if(expandLString(lstr) <= oldLen){
+                status = 1;
+                break;
+            }
+        }
+
+        if(status == 3) status = alReadFramePayload(reader, fd, lstr->head + lstr->length, lstr->allocatedLength - (lstr->length + 1), 1);
+    }
+
+    //On failure, restore the unused characters to '\0'
+    if(status == 1){
+        memset(lstr->head + lstr->length, '\0', reader->payloadBytes);
+        return 1;
+    }
+
+    if(status != 0) return status;
+
+    lstr->length += reader->header.length;
+    noteEdit(lstr, lstr->length - reader->header.length, 0, reader->header.length);
+
+    return 0;
+}
+
+
+//File input reads straight into a string's spare capacity (or maps the file without copying it at all), and the line reader finds newlines with the C library's vectorized memchr
+
+//The largest number of bytes requested by a single read call (Linux transfers at most about 2 GiB per call)
+#define READ_CALL_LIMIT (1UL << 30)
+
+//Read from a file descriptor until <len> bytes have arrived or the input ends, retrying interrupted reads. Returns the number of bytes read, or -1 if reading failed.
+static long readFully(int fd, char* dest, lstrLength len){
+    lstrLength done = 0;
+
+    while(done < len){
+        lstrLength want = len - done < READ_CALL_LIMIT ? len - done : READ_CALL_LIMIT;
+        ssize_t got = read(fd, dest + done, want);
+
+        if(got < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        if(got == 0) break;
+
+        done += got;
+    }
+
+    return done;
+}
+
+//Grow the string's buffer, as lstrReserve does, but without zeroing the new memory, for callers that are about to fill most of it. The caller must restore every unused character to '\0'. Returns 0 for success, or 1 if allocation failed.
+static int reserveUnzeroed(lString* lstr, lstrLength len){
+    if(lstr->allocatedLength - 1 >= len) return 0;
+
+    lstrLength newAlloc = grownSize(lstr->allocatedLength, len);
+
+    char* newHead = (char*) realloc(lstr->head, newAlloc);
+    if(newHead == NULL) return 1;
+
+    lstr->head = newHead;
+    lstr->allocatedLength = newAlloc;
+    lstr->generation++;
+
+    return 0;
+}
+
+//Append the whole contents of a file to the string. Regular files are read directly into the string's buffer after sizing it once; other files (such as pipes) are read in blocks. Returns 0 for success, or 1 if the operation fails, in which case the string's contents are unchanged.
+int lstrReadFile(lString* lstr, char* path){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(path == NULL) return 1;
+    #endif
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return 1;
+
+    //A regular file's size is known, so one byte of extra room is enough to see the end of the file without growing the string again.
+    //Other files (including those, like many in /proc, that report a size of 0) are read in blocks, doubling the room each time it fills.
+    struct stat info;
+    lstrLength want = LSTR_READ_BLOCK;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && (unsigned long) info.st_size < MAXIMUM_STRING_BYTES - 1) want = info.st_size + 1;
+
+    lstrLength oldLen = lstr->length;
+    lstrLength oldAlloc = lstr->allocatedLength;
+    lstrLength filled = 0;
+    int failed = 0;
+
+    for(;;){
+        if(want > MAXIMUM_STRING_BYTES - 1 - oldLen - filled || reserveUnzeroed(lstr, oldLen + filled + want)){
+            failed = 1;
+            break;
+        }
+
+        //Read into every spare byte, since the buffer may have grown by more than was asked for
+        lstrLength room = lstr->allocatedLength - 1 - oldLen - filled;
+        long got = readFully(fd, lstr->head + oldLen + filled, room);
+        if(got < 0){
+            failed = 1;
+            break;
+        }
+
+        filled += got;
+        if((lstrLength) got < room) break;
+
+        want = oldLen + filled;
+    }
+
+    close(fd);
+
+    //Restore every unused character to '\0': the bytes read (if they are being discarded) and any new memory they did not fill
+    lstrIndex keep = oldLen + (failed ? 0 : filled);
+    lstrIndex dirtyEnd = lstr->allocatedLength > oldAlloc ? lstr->allocatedLength : oldLen + filled;
+    memset(lstr->head + keep, '\0', dirtyEnd - keep);
+
+    if(failed) return 1;
+
+    if(filled > 0){
+        lstr->length += filled;
+        noteEdit(lstr, oldLen, 0, filled);
+    }
+
+    return 0;
+}
+
+//Map a regular file into memory, read-only, for reading without a copy. Returns 0 for success, or 1 if the operation fails.
+//A successful mapping must be released with lstrUnmapFile. Writes to the file by other programs while it is mapped may be visible through the mapping.
+int lstrMapFile(lstrMappedFile* file, char* path){
+    #ifndef NO_SAFETY
+    if(file == NULL || path == NULL) return 1;
+    #endif
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return 1;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)){
+        close(fd);
+        return 1;
+    }
+
+    //An empty file cannot be mapped, so it gets an empty (but valid) mapping instead
+    const char* data = "";
+    if(info.st_size > 0){
+        void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED){
+            close(fd);
+            return 1;
+        }
+
+        //Most mapped files are scanned from start to end, so ask for aggressive read-ahead
+        posix_madvise(mapped, info.st_size, POSIX_MADV_SEQUENTIAL);
+        data = (const char*) mapped;
+    }
+
+    //The mapping stays valid after its file descriptor is closed
+    close(fd);
+
+    file->data = data;
+    file->length = info.st_size;
+
+    return 0;
+}
+
+//Make a view of the whole contents of a mapped file. The view is valid until the file is unmapped. Returns the null view if the file is not mapped.
+lstrView lstrMappedView(lstrMappedFile* file){
+    if(file == NULL) return nullView;
+    return lstrViewOfBytes((char*) file->data, file->length);
+}
+
+//Release a mapping made by lstrMapFile
+void lstrUnmapFile(lstrMappedFile* file){
+    if(file == NULL || file->data == NULL) return;
+
+    if(file->length > 0) munmap((void*) file->data, file->length);
+
+    file->data = NULL;
+    file->length = 0;
+}
+
+
+//Create a line reader for a file descriptor, which may be non-blocking. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeLineReader.
+lstrLineReader* lstrNewLineReader(int fd){
+    lstrLineReader* reader = (lstrLineReader*) malloc(sizeof(lstrLineReader));
+    if(reader == NULL) return NULL;
+
+    reader->buffer = (char*) malloc(LSTR_READ_BLOCK);
+    if(reader->buffer == NULL){
+        free(reader);
+        return NULL;
+    }
+
+    reader->fd = fd;
+    reader->capacity = LSTR_READ_BLOCK;
+    reader->start = 0;
+    reader->scanned = 0;
+    reader->end = 0;
+    reader->atEnd = 0;
+    reader->failed = 0;
+
+    return reader;
+}
+
+//Find the next line in the reader's buffer, reading more input as needed, and store where it starts and its length (excluding its line ending). Returns 0, 1 or 2 as lstrReadLine does.
+static int nextLine(lstrLineReader* reader, lstrIndex* start, lstrLength* len){
+    if(reader->failed) return 1;
+
+    for(;;){
+        //Bytes that have already been scanned are never scanned again, however many reads a long line takes
+        const char* newline = (const char*) memchr(reader->buffer + reader->scanned, '\n', reader->end - reader->scanned);
+
+        if(newline != NULL){
+            lstrIndex end = newline - reader->buffer;
+
+            *start = reader->start;
+            *len = end - reader->start;
+            if(*len > 0 && reader->buffer[end - 1] == '\r') (*len)--;
+
+            reader->start = end + 1;
+            reader->scanned = end + 1;
+            return 0;
+        }
+
+        reader->scanned = reader->end;
+
+        if(reader->atEnd){
+            if(reader->start == reader->end) return 1;
+
+            //The last line has no line ending
+            *start = reader->start;
+            *len = reader->end - reader->start;
+            reader->start = reader->end;
+            return 0;
+        }
+
+        //Move the unfinished line to the front of the buffer, and grow the buffer if the line fills all of it
+        if(reader->start > 0){
+            memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->scanned -= reader->start;
+            reader->start = 0;
+        }
+
+        if(reader->end == reader->capacity){
+            char* grown = reader->capacity <= MAXIMUM_STRING_BYTES / 2 ? (char*) realloc(reader->buffer, reader->capacity * 2) : NULL;
+            if(grown == NULL){
+                reader->failed = 1;
+                return 1;
+            }
+
+            reader->buffer = grown;
+            reader->capacity *= 2;
+        }
+
+        lstrLength room = reader->capacity - reader->end;
+        ssize_t got = read(reader->fd, reader->buffer + reader->end, room < READ_CALL_LIMIT ? room : READ_CALL_LIMIT);
+
+        if(got < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 2;
+
+            reader->failed = 1;
+            return 1;
+        }
+
+        if(got == 0) reader->atEnd = 1;
+        reader->end += got;
+    }
+}
+
+//Replace the contents of an lString with the next line of input, excluding its "\n" or "\r\n" line ending. The last line does not need a line ending. Reusing the same lString for every line avoids re-allocating it.
+//Returns 0 if a line was stored, 1 at the end of the input or if the operation fails (reader->failed tells the two apart), or 2 if the file descriptor would block and the call should be repeated later.
+int lstrReadLine(lstrLineReader* reader, lString* line){
+    null_check(line, 1);
+
+    #ifndef NO_SAFETY
+    if(reader == NULL || reader->buffer == NULL) return 1;
+    #endif
+
+    lstrIndex start;
+    lstrLength len;
+    int status = nextLine(reader, &start, &len);
+    if(status != 0) return status;
+
+    if(lstrReserve(line, len)){
+        reader->failed = 1;
+        return 1;
+    }
+
+    //Overwrite the old contents, then clear whatever is left of them so every unused character is '\0'
+    lstrLength oldLen = line->length;
+    memcpy(line->head, reader->buffer + start, len);
+    if(oldLen > len) memset(line->head + len, '\0', oldLen - len);
+
+    line->length = len;
+    noteEdit(line, 0, oldLen, len);
+
+    return 0;
+}
+
+//Make a view of the next line of input, excluding its line ending, without copying it. The view is only valid until the reader is next used. Returns 0, 1 or 2 as lstrReadLine does.
+int lstrReadLineView(lstrLineReader* reader, lstrView* view){
+    #ifndef NO_SAFETY
+    if(reader == NULL || reader->buffer == NULL || view == NULL) return 1;
+    #endif
+
+    lstrIndex start;
+    lstrLength len;
+    int status = nextLine(reader, &start, &len);
+    if(status != 0) return status;
+
+    *view = lstrViewOfBytes(reader->buffer + start, len);
+    return 0;
+}
+
+//Destroy and de-allocate a line reader. The file descriptor is not closed.
+void lstrFreeLineReader(lstrLineReader* reader){
+    if(reader == NULL) return;
+
+    free(reader->buffer);
+    free(reader);
+}
+
+
+//Buffer transfer hands a string's allocation to its caller, or takes over one the caller allocated, so bytes can move to and from arrayLists and other owners without being copied
+
+//Swap a new buffer into the string. The string's indexes describe the old contents, so they are discarded rather than patched.
+static void replaceBuffer(lString* lstr, char* head, lstrLength length, lstrLength allocatedLength){
+    if(lstr->utf8Index != NULL) dropIndex(lstr);
+    if(lstr->lineIndex != NULL) dropLineIndex(lstr);
+
+    lstr->head = head;
+    lstr->length = length;
+    lstr->allocatedLength = allocatedLength;
+    lstr->hashValid = 0;
+    lstr->generation++;
+}
+
+//Make a buffer from malloc, holding <length> bytes with room for <*allocatedLength>, fit to be an lString's buffer: grow it with realloc if it has no room for the terminator, then clear every byte past <length>.
+//Returns the buffer, which may have moved, or NULL if allocation failed (in which case the original buffer is untouched).
+static char* terminateBuffer(char* buffer, lstrLength length, lstrLength* allocatedLength){
+    if(*allocatedLength <= length){
+        if(length == MAXIMUM_STRING_BYTES) return NULL;
+
+        char* grown = (char*) realloc(buffer, length + 1);
+        if(grown == NULL) return NULL;
+
+        buffer = grown;
+        *allocatedLength = length + 1;
+    }
+
+    //Only the unused tail is touched, so the cost is independent of the length of the contents
+    memset(buffer + length, '\0', *allocatedLength - length);
+
+    return buffer;
+}
+
+//Detach the string's buffer and give it to the caller, who must eventually free it with free(). The buffer is null-terminated, and every byte past the string's length is '\0'. The string is left empty, with a new buffer of DEFAULT_INITIAL_STRING_LENGTH bytes.
+//The string's length and allocated length are stored in <length> and <allocatedLength>, either of which may be NULL. Returns the buffer, or NULL if the operation fails, in which case the string is unchanged.
+char* lstrDetachBuffer(lString* lstr, lstrLength* length, lstrLength* allocatedLength){
+    null_check(lstr, NULL);
+
+    //Allocate the replacement first, so a failure leaves the string untouched
+    char* replacement = (char*) calloc(DEFAULT_INITIAL_STRING_LENGTH, 1);
+    if(replacement == NULL) return NULL;
+
+    char* buffer = lstr->head;
+    if(length != NULL) *length = lstr->length;
+    if(allocatedLength != NULL) *allocatedLength = lstr->allocatedLength;
+
+    replaceBuffer(lstr, replacement, 0, DEFAULT_INITIAL_STRING_LENGTH);
+
+    return buffer;
+}
+
+//Replace the string's contents with a buffer from malloc that holds <length> bytes (which may include '\0') and has room for <allocatedLength>. The string takes ownership of the buffer and frees its old one; the contents are not copied.
+//The null terminator is added in place if the buffer has room for it; otherwise the buffer is grown with realloc. Any other unused bytes are cleared. Returns 0 for success, or 1 if the operation fails, in which case the string is unchanged and the caller still owns the buffer.
+int lstrAdoptBuffer(lString* lstr, char* buffer, lstrLength length, lstrLength allocatedLength){
+    null_check(lstr, 1);
+
+    #ifndef NO_SAFETY
+    if(buffer == NULL || buffer == lstr->head || allocatedLength < length) return 1;
+    #endif
+
+    buffer = terminateBuffer(buffer, length, &allocatedLength);
+    if(buffer == NULL) return 1;
+
+    free(lstr->head);
+    replaceBuffer(lstr, buffer, length, allocatedLength);
+
+    return 0;
+}
+
+//Turn an arrayList with an element size of 1 into an lString holding its elements, taking over the list's buffer instead of copying it. The list is de-allocated, and must not be used again.
+//The null terminator is added in place if the list has spare capacity; otherwise the buffer is grown with realloc. Returns the new string, or NULL if the operation fails, in which case the list's contents are unchanged.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrFromArrayList(arrayList* list){
+    #ifndef NO_SAFETY
+    if(list == NULL || list->head == NULL || list->size != 1) return NULL;
+    #endif
+
+    lString* lstr = (lString*) malloc(sizeof(lString));
+    if(lstr == NULL) return NULL;
+
+    //Lazily removed elements must be compacted away before the buffer can be used as it is. The tombstone state is freed too, since the list is about to go.
+    alDisableTombstones(list);
+
+    lstrLength allocatedLength = list->allocatedLength;
+    char* head = terminateBuffer((char*) list->head, list->length, &allocatedLength);
+    if(head == NULL){
+        free(lstr);
+        return NULL;
+    }
+
+    lstr->head = head;
+    lstr->length = list->length;
+    lstr->allocatedLength = allocatedLength;
+    lstr->utf8Index = NULL;
+    lstr->utf8Covered = 0;
+    lstr->utf8CoveredPoints = 0;
+    lstr->lineIndex = NULL;
+    lstr->generation = 0;
+    lstr->hashValid = 0;
+
+    //The list no longer owns its buffer, so only the list itself is freed
+    free(list);
+
+    return lstr;
+}
+
+//Turn an lString into an arrayList with an element size of 1 holding its bytes, taking over the string's buffer instead of copying it. The null terminator stays in the list's spare capacity. The string is de-allocated, and must not be used again.
+//Returns the new list, or NULL if the operation fails, in which case the string is unchanged.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* alFromLString(lString* lstr){
+    null_check(lstr, NULL);
+
+    arrayList* list = (arrayList*) malloc(sizeof(arrayList));
+    if(list == NULL) return NULL;
+
+    list->size = 1;
+    list->length = lstr->length;
+    list->allocatedLength = lstr->allocatedLength;
+    list->head = lstr->head;
+    list->tombstones = NULL;
+
+    //The string no longer owns its buffer
+    if(lstr->utf8Index != NULL) alFreeArrayList(lstr->utf8Index);
+    if(lstr->lineIndex != NULL) alFreeArrayList(lstr->lineIndex);
+    free(lstr);
 
+    return list;
 }
 
 
 //Destroy and de-allocate the lString
 void lstrFreeString(lString* lstr){
     void_null_check(lstr);
+    if(lstr->utf8Index != NULL) alFreeArrayList(lstr->utf8Index);
+    if(lstr->lineIndex != NULL) alFreeArrayList(lstr->lineIndex);
     free(lstr->head);
     free(lstr);
 }
@@ -1,7 +1,13 @@
+#ifndef LISTSTRING_H
+#define LISTSTRING_H
+
 #include <limits.h>
+#include "arrayList.h"
 
 #define DEFAULT_INITIAL_STRING_LENGTH 64
 #define MAXIMUM_STRING_BYTES ULONG_MAX
+#define UTF8_CHECKPOINT_SPACING 256 //The number of code points between checkpoints in an lString's UTF-8 index
+#define LSTR_READ_BLOCK 65536 //The number of bytes requested by each read of input whose size is not known in advance, and the initial buffer size of an lstrLineReader
 
 //A string character index (unsigned long because the string can contain up to 2^64 characters)
 typedef unsigned long lstrIndex;
@@ -21,9 +27,117 @@ typedef struct listString {
     //Pointer to the head of the string
     //This pointer can be accessed like a normal string, since lStrings are null-terminated if accessed properly
     char* head;
+
+    //Sparse UTF-8 index: an arrayList of checkpoints, each a byte offset followed by the number of code points before it. NULL until a code-point function first needs it.
+    //The index is kept up to date by every lString function that modifies the string, so it must not be modified directly.
+    arrayList* utf8Index;
+
+    //Number of bytes at the start of the string that the UTF-8 index covers, and the number of code points in them
+    lstrIndex utf8Covered;
+    lstrLength utf8CoveredPoints;
+
+    //Line index: an arrayList of the byte index of every '\n' in the string, in order. NULL until a line function first needs it.
+    //Like the UTF-8 index, it is kept up to date by every lString function that modifies the string, so it must not be modified directly.
+    arrayList* lineIndex;
+
+    //Incremented every time the string's buffer is re-allocated, so that views into the old buffer can be detected
+    unsigned long generation;
+
+    //Cached result of lstrHash, which is only meaningful while hashValid is nonzero. Every lString function that modifies the string clears hashValid.
+    unsigned long hash;
+    int hashValid;
 } lString;
 
 
+//A compiled substring search pattern, which can be reused across many searches to avoid recomputing the needle's length and search tables
+typedef struct listStringPattern {
+    //The needle (a null-terminated copy owned by the pattern) and its length
+    const char* needle;
+    lstrLength length;
+
+    //Offsets (within the needle) and values of the two rarest bytes in the needle, which are used as anchors for the vectorized scan
+    lstrIndex anchorOffset1;
+    lstrIndex anchorOffset2;
+    unsigned char anchor1;
+    unsigned char anchor2;
+
+    //Two-Way critical factorization: the needle is split at <suffix>, and <period> is the period of the needle (if <periodic> is nonzero) or a safe shift otherwise
+    lstrIndex suffix;
+    lstrLength period;
+    int periodic;
+} lstrPattern;
+
+
+//A batch of position-based edits to an lString, which are queued against the string's original offsets and then applied together in one pass
+typedef struct listStringEditBatch {
+    //arrayList of queued edits, in the order they were queued
+    arrayList* edits;
+
+    //All inserted text, stored back to back
+    lString* text;
+} lstrEditBatch;
+
+
+//A non-owning view of <length> bytes of a string (which may include '\0' and need not be null-terminated). Views are passed and returned by value, and never need to be freed.
+//A view into an lString is only valid until the string is next modified. Views remember the string's generation, so functions that take views (in builds without NO_SAFETY) reject views whose string has since been re-allocated or shortened past the view.
+typedef struct listStringView {
+    //First byte of the view, or NULL for the null view that failed operations return
+    const char* data;
+    lstrLength length;
+
+    //The lString the view points into (NULL for views of other memory), and its generation when the view was made
+    lString* source;
+    unsigned long generation;
+} lstrView;
+
+
+//A field of a string found by lstrSplit, lstrTokenize or an lstrSplitter: <length> bytes starting at <offset>. Spans hold offsets rather than pointers, so they stay meaningful if the string is re-allocated.
+typedef struct listStringSpan {
+    lstrIndex offset;
+    lstrLength length;
+} lstrSpan;
+
+//Progress of a streaming split or tokenization, which returns one field per call to lstrSplitNext. An lstrSplitter needs no de-allocation.
+typedef struct listStringSplitter {
+    //The string being split. It must not be modified until splitting finishes.
+    lString* source;
+
+    //Index where the next field starts, or MAXIMUM_STRING_BYTES once every field has been returned
+    lstrIndex position;
+
+    //Nonzero if empty fields are skipped (tokenizing) rather than returned (splitting)
+    int skipEmpty;
+
+    //The distinct delimiter bytes, and a table of which byte values are delimiters
+    int delimiterCount;
+    unsigned char delimiters[256];
+    unsigned char isDelimiter[256];
+} lstrSplitter;
+
+
+//A read-only memory mapping of a whole file, made by lstrMapFile. The file's contents are not copied, and are not null-terminated.
+typedef struct listStringMappedFile {
+    const char* data;
+    lstrLength length;
+} lstrMappedFile;
+
+//A buffered reader that returns the input from a file descriptor one line at a time. The reader does not own the file descriptor, which must stay open until the reader is freed.
+typedef struct listStringLineReader {
+    int fd;
+
+    //Buffered input: bytes before <start> have already been returned, bytes from <start> to <scanned> are known to hold no newline, and bytes from <end> onwards are unused
+    char* buffer;
+    lstrLength capacity;
+    lstrIndex start;
+    lstrIndex scanned;
+    lstrIndex end;
+
+    //Nonzero once the file descriptor has reported the end of its input, and once reading (or storing a line) has failed
+    int atEnd;
+    int failed;
+} lstrLineReader;
+
+
 //Set all characters in a lString to \0 (including unused ones and the terminator)
 void lstrSetStringNull(lString*);
 
@@ -84,6 +198,26 @@ char* lstrAppendString(lString*, char*);
 //Insert a <len>-length fragment of the input string at the end of the string. If the specified fragment length exceeds the total length of the input string, the operation reduces the fragment length to the length of the input string. Returns a pointer to the start of the copy of the input string, or NULL for a failed operation.
 char* lstrAppendPartial(lString*, char*, unsigned long);
 
+//Insert exactly <len> bytes (which may include '\0') at the end of the string, without measuring the input with strlen. Returns a pointer to the start of the copy of the input, or NULL for a failed operation (including cases where len < 1).
+char* lstrAppendBytes(lString*, char*, lstrLength);
+
+//Expand the string, if necessary, until it can hold at least <len> characters (plus the null terminator) without re-allocating. Returns 0 for success, or 1 if the operation fails.
+int lstrReserve(lString*, lstrLength);
+
+//Append printf-style formatted text to the end of the string. The text is formatted directly into the string's unused space, which is expanded only if the text does not fit. Returns a pointer to the start of the appended text, or NULL for a failed operation (including cases where the formatted text is empty).
+//The arguments must not point into the string itself, since formatting writes into the same buffer.
+char* lstrAppendFormat(lString*, const char*, ...);
+
+//Append the decimal representation of a signed integer to the end of the string, without going through printf. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+char* lstrAppendInt(lString*, long);
+
+//Append the decimal representation of an unsigned integer to the end of the string, without going through printf. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+char* lstrAppendUint(lString*, unsigned long);
+
+//Append the shortest decimal representation of a double that reads back (with strtod) as exactly the same value. Returns a pointer to the start of the appended text, or NULL for a failed operation.
+//Values from 1e-4 up to 2^53 are written in fixed notation without going through printf; all other values are written in printf's %g style. Infinities and NaNs are written as printf writes them.
+char* lstrAppendDouble(lString*, double);
+
 //Insert a character at the start of the string. Returns a pointer to the element, or NULL for a failed operation
 char* lstrPrependChar(lString*, char);
 
@@ -121,6 +255,67 @@ lstrIndex lstrFindChar(lString*, char);
 //Find the first instance of a given string in the lString. Returns the index of the start of the matching string, or MAXIMUM_STRING_BYTES on a failed operation (including cases where the input string is empty).
 lstrIndex lstrFindString(lString*, char*);
 
+//Find the first instance of a given character at or after index <from>. Returns the index of the character, or MAXIMUM_STRING_BYTES if there is none or the operation fails.
+lstrIndex lstrFindCharFrom(lString*, char, lstrIndex);
+
+//Find the first instance of a given string that starts at or after index <from>. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES if there is none or the operation fails (including cases where the input string is empty).
+lstrIndex lstrFindStringFrom(lString*, char*, lstrIndex);
+
+
+//Counting and bulk finding make one pass over the string: single bytes go through the byte scanners, and longer needles are planned once and searched from each match to the next
+
+//Count the instances of a given character in the lString. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails.
+lstrLength lstrCountChar(lString*, char);
+
+//Count the instances of a given character at or after index <from>. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where <from> is past the end of the string).
+lstrLength lstrCountCharFrom(lString*, char, lstrIndex);
+
+//Count the non-overlapping instances of a given string in the lString, from left to right. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where the input string is empty).
+lstrLength lstrCountString(lString*, char*);
+
+//Count the non-overlapping instances of a given string that start at or after index <from>, from left to right. Returns the count, or MAXIMUM_STRING_BYTES if the operation fails (including cases where the input string is empty or <from> is past the end of the string).
+lstrLength lstrCountStringFrom(lString*, char*, lstrIndex);
+
+//Find every instance of a given character in the lString. Returns an arrayList of lstrIndex positions (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllChar(lString*, char);
+
+//Find every instance of a given character at or after index <from>. Returns an arrayList of lstrIndex positions (which may be empty), or NULL if the operation fails (including cases where <from> is past the end of the string).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllCharFrom(lString*, char, lstrIndex);
+
+//Find every non-overlapping instance of a given string in the lString, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails (including cases where the input string is empty).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllString(lString*, char*);
+
+//Find every non-overlapping instance of a given string that starts at or after index <from>, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails (including cases where the input string is empty or <from> is past the end of the string).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllStringFrom(lString*, char*, lstrIndex);
+
+
+//Precompiled patterns hold everything a substring search needs, so repeated searches for the same needle skip all per-call setup
+
+//Compile a reusable search pattern from a null-terminated needle. The needle is copied. Returns NULL if the needle is empty or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreePattern.
+lstrPattern* lstrNewPattern(char*);
+
+//Compile a reusable search pattern from the first <len> bytes of a needle, which may include '\0' bytes. The needle is copied. Returns NULL if the needle is empty or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreePattern.
+lstrPattern* lstrNewPatternLen(char*, lstrLength);
+
+//Find the first instance of a compiled pattern in the lString. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES if there is no match or the operation fails.
+lstrIndex lstrFindPattern(lString*, lstrPattern*);
+
+//Find every non-overlapping instance of a compiled pattern in the lString, from left to right. Returns an arrayList of lstrIndex match positions (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllPattern(lString*, lstrPattern*);
+
+//Replace every non-overlapping instance of a compiled pattern with a new string, from left to right. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails, in which case the original string is not altered.
+lstrLength lstrReplacePatternAll(lString*, lstrPattern*, char*);
+
+//Destroy and de-allocate a compiled pattern
+void lstrFreePattern(lstrPattern*);
+
 
 //Replace the first instance of one character in the string with a new character. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails (but not if the operation simply makes no replacements).
 lstrLength lstrReplaceChar(lString*, char, char);
@@ -131,10 +326,38 @@ lstrLength lstrReplaceCharAll(lString*, char, char);
 //Replace the first instance of one substring with a new substring. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
 lstrLength lstrReplaceString(lString*, char*, char*);
 
-//Replace all instances of one substring with a new substring. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
+//Replace all instances of one substring with a new substring, from left to right. The whole string is searched, including any part after an embedded '\0'. Returns the number of replacements, which may be 0. Returns MAXIMUM_STRING_BYTES if the operation fails. If the replacements would cause the string to exceed the maximum length, the operation fails and the original string is not altered.
 lstrLength lstrReplaceStringAll(lString*, char*, char*);
 
 
+//Edit batches apply many inserts, removals and replacements in one linear pass, instead of shifting the rest of the string once per edit
+
+//Create a new, empty edit batch. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeEditBatch.
+lstrEditBatch* lstrNewEditBatch();
+
+//Queue an insertion of a null-terminated string before the character at <index> of the original string (or at the end, if <index> is the string's length). Returns 0 for success, or 1 if the operation fails.
+int lstrBatchInsert(lstrEditBatch*, lstrIndex, char*);
+
+//Queue the removal of <len> characters starting at <index> of the original string. Returns 0 for success, or 1 if the operation fails.
+int lstrBatchRemove(lstrEditBatch*, lstrIndex, lstrLength);
+
+//Queue the replacement of <len> characters starting at <index> of the original string with a null-terminated string. Returns 0 for success, or 1 if the operation fails.
+int lstrBatchReplace(lstrEditBatch*, lstrIndex, lstrLength, char*);
+
+//Apply every queued edit to the string at once. Edits at the same index are applied in the order they were queued. The batch is emptied on success, so it can be reused.
+//Returns 0 for success, or 1 if the operation fails (any edit is out of bounds, two edits remove overlapping ranges, an insertion falls inside a removed range, or allocation failed), in which case neither the string nor the batch is altered.
+int lstrCommitEdits(lString*, lstrEditBatch*);
+
+//Discard every queued edit
+void lstrClearEditBatch(lstrEditBatch*);
+
+//Destroy and de-allocate an edit batch
+void lstrFreeEditBatch(lstrEditBatch*);
+
+
+//Case conversion and classification use vectorized range-compare kernels (AVX2 where the processor supports it, otherwise SSE2), with a scalar fallback
+
 //For ASCII characters only, return a copy of the string where all alphabetical characters are UPPERCASE. Returns a pointer to the new string, or NULL if the operation fails. The returned string may be empty.
 //This function dynamically allocates memory, and its return value must be freed.
 char* lstrToUpper(lString*);
@@ -143,17 +366,284 @@ char* lstrToUpper(lString*);
 //This function dynamically allocates memory, and its return value must be freed.
 char* lstrToLower(lString*);
 
+//For ASCII characters only, write an UPPERCASE copy of the string (including the null terminator) into <buffer>, which must hold at least length + 1 bytes. Returns <buffer>, or NULL if the operation fails.
+char* lstrToUpperInto(lString*, char*);
+
+//For ASCII characters only, write a lowercase copy of the string (including the null terminator) into <buffer>, which must hold at least length + 1 bytes. Returns <buffer>, or NULL if the operation fails.
+char* lstrToLowerInto(lString*, char*);
+
+//For ASCII characters only, convert every alphabetical character in the string to UPPERCASE, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrToUpperInPlace(lString*);
+
+//For ASCII characters only, convert every alphabetical character in the string to lowercase, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrToLowerInPlace(lString*);
+
+
+//Check whether every byte of the string is ASCII (below 128). Returns 1 if so (including for an empty string), 0 if not, or -1 for an invalid string.
+int lstrIsAscii(lString*);
+
+//Count the ASCII digits ('0' to '9') in the string. Returns the count, or MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrCountDigits(lString*);
+
+//Remove ASCII whitespace (space, \t, \n, \v, \f and \r) from both ends of the string, in place. Returns 0 for success, or 1 if the operation fails.
+int lstrTrim(lString*);
+
+
+//UTF-8 functions count a code point for every byte that is not a continuation byte (10xxxxxx), so they give consistent answers even for invalid UTF-8
+//Code-point lookups use a sparse index of checkpoints, one every UTF8_CHECKPOINT_SPACING code points, which is built lazily and patched by every edit, so repeated lookups are O(1) amortized
+
+//Check whether the string is valid UTF-8 (rejecting overlong encodings, surrogates, and code points above U+10FFFF). Returns 1 if so (including for an empty string), 0 if not, or -1 for an invalid string.
+int lstrIsValidUtf8(lString*);
+
+//Get the number of UTF-8 code points in the string. Returns MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrUtf8Length(lString*);
+
+//Get the byte index at which a code point (counting from 0) starts. Returns MAXIMUM_STRING_BYTES if the code point is out of bounds or the operation fails.
+lstrIndex lstrUtf8Offset(lString*, lstrIndex);
+
+//Get the number of code points that start before a byte index (i.e., the index of the code point containing that byte, if it is not a lead byte). The byte index may equal the string's length. Returns MAXIMUM_STRING_BYTES if the byte index is out of bounds or the operation fails.
+lstrIndex lstrUtf8PointIndex(lString*, lstrIndex);
+
+//Get a substring by code-point index and length in code points. If the specified length is too long, the substring ends at the end of the original string. Returns NULL on a failed or invalid operation, such as a 0-length substring or an out-of-bounds index.
+//This function dynamically allocates memory, and its return value must be freed.
+char* lstrUtf8Substr(lString*, lstrIndex, lstrLength);
+
+
+//Views read directly from the string's buffer, so getting a substring, trimming or searching through a view never allocates or copies
+
+//Make a view of a null-terminated C string (excluding the null terminator). Returns the null view if the string is NULL.
+lstrView lstrViewOf(char*);
+
+//Make a view of <len> bytes of memory, which may include '\0'. Returns the null view if the pointer is NULL.
+lstrView lstrViewOfBytes(char*, lstrLength);
+
+//Make a view of an entire lString. Returns the null view for an invalid string.
+lstrView lstrViewString(lString*);
+
+//Make a view of a substring by index and length, with the same rules as lstrGetSubstr: a length that is too long is cut short at the end of the string. Returns the null view on a failed or invalid operation, such as a 0-length substring or an out-of-bounds index.
+lstrView lstrViewSubstr(lString*, lstrIndex, lstrLength);
+
+//Make a view of part of another view by index and length. A length that is too long is cut short at the end of the view. Returns the null view if the index is out of bounds or the view is invalid. The result may be empty.
+lstrView lstrViewSlice(lstrView, lstrIndex, lstrLength);
+
+//Make a view of another view without its leading and trailing ASCII whitespace (space, \t, \n, \v, \f and \r). Returns the null view if the view is invalid. The result may be empty.
+lstrView lstrViewTrim(lstrView);
+
+//Find the first instance of a needle view in a haystack view. Returns a view of the match within the haystack (its offset is match.data - haystack.data), or the null view if there is no match or the operation fails (including cases where the needle is empty).
+lstrView lstrViewFind(lstrView, lstrView);
+
+//Check whether a view can still be used: it is not the null view, and if it points into an lString, that string has not been re-allocated or shortened past the view since the view was made. Returns 1 if so, or 0 if not.
+//Edits that move bytes within the buffer without re-allocating it are not detected.
+int lstrViewIsValid(lstrView);
+
+
+//Find the first instance of the bytes in a view in the lString. Returns the index of the start of the match, or MAXIMUM_STRING_BYTES on a failed operation (including cases where the view is empty).
+lstrIndex lstrFindView(lString*, lstrView);
+
+//Insert a copy of the bytes in a view at an arbitrary point in the string. The view may point into the same string. Returns a pointer to the start of the copy, or NULL for a failed operation (including cases where the view is empty).
+char* lstrInsertView(lString*, lstrIndex, lstrView);
+
+//Insert a copy of the bytes in a view at the end of the string. The view may point into the same string. Returns a pointer to the start of the copy, or NULL for a failed operation (including cases where the view is empty).
+char* lstrAppendView(lString*, lstrView);
+
+//Compare two views byte by byte (as unsigned chars), with a view that is a prefix of the other ordered first. Returns a negative number, 0, or a positive number if the first view sorts before, equal to, or after the second. Invalid views compare as empty.
+int lstrCompareView(lstrView, lstrView);
+
+//Check whether two views hold the same bytes. Returns 1 if so, or 0 if not (or if either view is invalid).
+int lstrViewEquals(lstrView, lstrView);
+
+
+//Line functions number lines from 0. Every '\n' ends a line, and the text after the last '\n' (which may be empty) is the last line, so a string with n newlines has n + 1 lines.
+//Lookups use an index of newline positions, which is built with a vectorized scan on first use and patched by every edit, so finding a line by number is O(1) and finding the line that contains a byte is O(log n)
+
+//Get the number of lines in the string. Returns MAXIMUM_STRING_BYTES for an invalid string.
+lstrLength lstrLineCount(lString*);
+
+//Get the byte index at which a line starts. Returns MAXIMUM_STRING_BYTES if the line is out of bounds or the operation fails.
+lstrIndex lstrLineStart(lString*, lstrIndex);
+
+//Make a view of a line, excluding its '\n'. Returns the null view if the line is out of bounds or the operation fails.
+lstrView lstrLineView(lString*, lstrIndex);
+
+//Get the number of the line that contains a byte index. A '\n' belongs to the line it ends, and the string's length (just past the last byte) belongs to the last line. Returns MAXIMUM_STRING_BYTES if the index is out of bounds or the operation fails.
+lstrIndex lstrLineOf(lString*, lstrIndex);
+
+//Discard the string's line index to free its memory. It is rebuilt when next needed.
+void lstrDropLineIndex(lString*);
+
+
+//Splitting scans for delimiters 16 bytes at a time and returns spans of the original string, so no field is copied or allocated
+
+//Split the string at every instance of a delimiter byte. Every field is returned, including empty ones, so n delimiters always give n + 1 fields. Returns an arrayList of lstrSpan, or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrSplit(lString*, char);
+
+//Split the string into tokens separated by runs of any of the bytes in a null-terminated delimiter set. Empty tokens are skipped, so a string of only delimiters gives no tokens. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails (including cases where the delimiter set is empty).
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrTokenize(lString*, char*);
+
+//Start a streaming split of the string at a delimiter byte, with the same fields as lstrSplit. Returns 0 for success, or 1 if the operation fails.
+int lstrSplitStart(lstrSplitter*, lString*, char);
+
+//Start a streaming tokenization of the string with a null-terminated delimiter set, with the same tokens as lstrTokenize. Returns 0 for success, or 1 if the operation fails (including cases where the delimiter set is empty).
+int lstrTokenizeStart(lstrSplitter*, lString*, char*);
+
+//Get the next field of a streaming split or tokenization. Returns 0 if a field was stored in <span>, or 1 once every field has been returned or if the operation fails.
+int lstrSplitNext(lstrSplitter*, lstrSpan*);
+
+//Make a view of a span of the string. Returns the null view if the span is out of bounds or the string is invalid.
+lstrView lstrSpanView(lString*, lstrSpan);
+
+
+//Join an arrayList of lstrView into a new string, with a null-terminated separator (which may be NULL or empty for none) between each pair. The result is allocated once, at its exact size. Returns the new string (which is empty for an empty list), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrJoin(arrayList*, char*);
+
+//Join an arrayList of lstrSpan of a source string into a new string, with a null-terminated separator (which may be NULL or empty for none) between each pair. The result is allocated once, at its exact size. Returns the new string (which is empty for an empty list), or NULL if the operation fails (including cases where a span is out of bounds).
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrJoinSpans(lString*, arrayList*, char*);
+
+
+//Hashing follows the structure of wyhash: the input is read eight bytes at a time, and each pair of words is mixed by a full 64x64-bit to 128-bit multiplication
+
+//Hash <len> bytes of memory, which may include '\0', with a fast, high-quality non-cryptographic hash. Equal byte sequences always have equal hashes.
+unsigned long lstrHashBytes(const char*, lstrLength);
+
+//Get the hash of the string's contents, as computed by lstrHashBytes. The hash is cached in the string until the string is next modified, so repeated calls are O(1). Returns 0 for an invalid string.
+unsigned long lstrHash(lString*);
+
+//Get the hash of the bytes in a view, as computed by lstrHashBytes. A view of an entire lString uses (and fills) the string's cached hash. Returns 0 for an invalid view.
+unsigned long lstrHashView(lstrView);
+
+
+//Comparison rejects on length (and on cached hashes, when both strings have one) before reading any bytes. Byte comparison uses the C library's vectorized memcmp, and case-insensitive comparison folds and compares 16 or 32 bytes per step.
+
+//Compare two strings byte by byte (as unsigned chars), with a string that is a prefix of the other ordered first. Returns a negative number, 0, or a positive number if the first string sorts before, equal to, or after the second. Invalid strings compare as empty.
+int lstrCompare(lString*, lString*);
+
+//Check whether two strings hold the same bytes. Strings of different lengths, or with different cached hashes, are rejected without reading their contents. Returns 1 if so, or 0 if not (or if either string is invalid).
+int lstrEquals(lString*, lString*);
+
+//Compare two strings with ASCII letters treated as lowercase, so "Apple" and "apple" compare equal and both sort before "banana". Returns a negative number, 0, or a positive number as lstrCompare does. Invalid strings compare as empty.
+int lstrCompareIgnoreCase(lString*, lString*);
+
+//Check whether two strings hold the same bytes once ASCII letters are lowercased. Returns 1 if so, or 0 if not (or if either string is invalid).
+int lstrEqualsIgnoreCase(lString*, lString*);
+
+//Compare two strings in natural order, where runs of ASCII digits compare by their numeric value, so "file9" sorts before "file10". Other bytes compare as unsigned chars. Returns a negative number, 0, or a positive number as lstrCompare does. Invalid strings compare as empty.
+int lstrCompareNatural(lString*, lString*);
+
+//Compare two views with ASCII letters treated as lowercase. Returns a negative number, 0, or a positive number as lstrCompareView does. Invalid views compare as empty.
+int lstrCompareViewIgnoreCase(lstrView, lstrView);
+
+//Compare two views in natural order, as lstrCompareNatural does. Invalid views compare as empty.
+int lstrCompareViewNatural(lstrView, lstrView);
+
+
+//Check whether the string starts with a null-terminated prefix. Returns 1 if so (including for an empty prefix), or 0 if not or if the operation fails.
+int lstrStartsWith(lString*, char*);
+
+//Check whether the string ends with a null-terminated suffix. Returns 1 if so (including for an empty suffix), or 0 if not or if the operation fails.
+int lstrEndsWith(lString*, char*);
+
+//Check whether the string starts with the bytes in a view. Returns 1 if so (including for an empty view), or 0 if not or if the operation fails.
+int lstrStartsWithView(lString*, lstrView);
+
+//Check whether the string ends with the bytes in a view. Returns 1 if so (including for an empty view), or 0 if not or if the operation fails.
+int lstrEndsWithView(lString*, lstrView);
+
+
+//Comparison functions for alSort (or qsort). Each is passed pointers to two elements of an arrayList of lString* (or of lstrView, for lstrSortCompareView), and orders them as the matching compare function does.
+int lstrSortCompare(const void*, const void*);
+int lstrSortCompareIgnoreCase(const void*, const void*);
+int lstrSortCompareNatural(const void*, const void*);
+int lstrSortCompareView(const void*, const void*);
+
 
 //Overwrite the contents of the string with a new string. The new string may be empty. Returns 0 for success, or 1 if the operation fails
 int lstrOverwrite(lString*, char*);
 
-//Return a reversed copy of the string. Returns 0 for success, or 1 if the operation fails (including cases where the original string is empty)
-//This function dynamically allocates memory, and its return value must be freed
+//Return a reversed copy of the string. Bytes are reversed, so multi-byte UTF-8 characters are not preserved. Returns NULL if the operation fails (including cases where the original string is empty).
+//This function dynamically allocates memory, and its return value must be freed.
 char* lstrReverse(lString*);
 
+//Reverse the bytes of the string in place. Multi-byte UTF-8 characters are not preserved. Returns 0 for success, or 1 if the operation fails.
+int lstrReverseInPlace(lString*);
+
+
+//Binary serialization uses the same frame format as arrayList (see alWriteFd), with an element size of 1 and LSTR_FRAME_MAGIC
+
+//Write the string (excluding the null terminator) to a (blocking) file descriptor as a frame. Returns 0 for success, or 1 if the string is bad or writing failed. On a non-blocking file descriptor, use lstrWriteFdPartial instead.
+int lstrWriteFd(lString*, int);
+
+//Continue a streaming write of the string to a (possibly non-blocking) file descriptor, using an alFrameWriter prepared with alInitFrameWriter. The string must not be modified until the write finishes.
+//Returns 0 once the whole frame has been written, 1 if the string is bad or writing failed, or 2 if the file descriptor would block and the call should be repeated later.
+int lstrWriteFdPartial(lString*, alFrameWriter*, int);
+
+//Read a frame from a (blocking) file descriptor and append its contents to the string, reading directly into the string's spare capacity. Returns 0 for success, or 1 if the operation fails, in which case the string is unchanged.
+int lstrReadFd(lString*, int);
+
+//Continue a streaming read from a (possibly non-blocking) file descriptor, appending the frame's contents to the string once they are complete. The string must not be modified until the read finishes, but it stays null-terminated throughout.
+//The string's capacity grows as the payload arrives, rather than to the length the frame header claims.
+//Returns 0 once the frame has been appended, 1 if the operation fails (the string is unchanged), or 2 if the file descriptor would block and the call should be repeated later.
+int lstrReadFdPartial(lString*, alFrameReader*, int);
+
+
+//File input reads straight into a string's spare capacity (or maps the file without copying it at all), and the line reader finds newlines with the C library's vectorized memchr
+
+//Append the whole contents of a file to the string. Regular files are read directly into the string's buffer after sizing it once; other files (such as pipes) are read in blocks. Returns 0 for success, or 1 if the operation fails, in which case the string's contents are unchanged.
+int lstrReadFile(lString*, char*);
+
+//Map a regular file into memory, read-only, for reading without a copy. Returns 0 for success, or 1 if the operation fails.
+//A successful mapping must be released with lstrUnmapFile. Writes to the file by other programs while it is mapped may be visible through the mapping.
+int lstrMapFile(lstrMappedFile*, char*);
+
+//Make a view of the whole contents of a mapped file. The view is valid until the file is unmapped. Returns the null view if the file is not mapped.
+lstrView lstrMappedView(lstrMappedFile*);
+
+//Release a mapping made by lstrMapFile
+void lstrUnmapFile(lstrMappedFile*);
+
+//Create a line reader for a file descriptor, which may be non-blocking. Returns NULL if allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeLineReader.
+lstrLineReader* lstrNewLineReader(int);
+
+//Replace the contents of an lString with the next line of input, excluding its "\n" or "\r\n" line ending. The last line does not need a line ending. Reusing the same lString for every line avoids re-allocating it.
+//Returns 0 if a line was stored, 1 at the end of the input or if the operation fails (reader->failed tells the two apart), or 2 if the file descriptor would block and the call should be repeated later.
+int lstrReadLine(lstrLineReader*, lString*);
+
+//Make a view of the next line of input, excluding its line ending, without copying it. The view is only valid until the reader is next used. Returns 0, 1 or 2 as lstrReadLine does.
+int lstrReadLineView(lstrLineReader*, lstrView*);
+
+//Destroy and de-allocate a line reader. The file descriptor is not closed.
+void lstrFreeLineReader(lstrLineReader*);
+
+
+//Buffer transfer hands a string's allocation to its caller, or takes over one the caller allocated, so bytes can move to and from arrayLists and other owners without being copied
+
+//Detach the string's buffer and give it to the caller, who must eventually free it with free(). The buffer is null-terminated, and every byte past the string's length is '\0'. The string is left empty, with a new buffer of DEFAULT_INITIAL_STRING_LENGTH bytes.
+//The string's length and allocated length are stored in <length> and <allocatedLength>, either of which may be NULL. Returns the buffer, or NULL if the operation fails, in which case the string is unchanged.
+char* lstrDetachBuffer(lString*, lstrLength*, lstrLength*);
+
+//Replace the string's contents with a buffer from malloc that holds <length> bytes (which may include '\0') and has room for <allocatedLength>. The string takes ownership of the buffer and frees its old one; the contents are not copied.
+//The null terminator is added in place if the buffer has room for it; otherwise the buffer is grown with realloc. Any other unused bytes are cleared. Returns 0 for success, or 1 if the operation fails, in which case the string is unchanged and the caller still owns the buffer.
+int lstrAdoptBuffer(lString*, char*, lstrLength, lstrLength);
+
+//Turn an arrayList with an element size of 1 into an lString holding its elements, taking over the list's buffer instead of copying it. The list is de-allocated, and must not be used again.
+//The null terminator is added in place if the list has spare capacity; otherwise the buffer is grown with realloc. Returns the new string, or NULL if the operation fails, in which case the list's contents are unchanged.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* lstrFromArrayList(arrayList*);
+
+//Turn an lString into an arrayList with an element size of 1 holding its bytes, taking over the string's buffer instead of copying it. The null terminator stays in the list's spare capacity. The string is de-allocated, and must not be used again.
+//Returns the new list, or NULL if the operation fails, in which case the string is unchanged.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* alFromLString(lString*);
+
 
 //Destroy and de-allocate the lString
 void lstrFreeString(lString*);
 
 //Print diagnostic information for debugging and development
 void lstrDiagnostics(lString*);
+
+#endif
@@ -0,0 +1,420 @@
+#include "packedList.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+//AVX2 kernels are compiled separately with a target attribute and chosen at run time, since the baseline x86-64 target does not assume AVX2
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(list, retVal) if(list==NULL || list->blocks==NULL || list->words==NULL) return retVal;
+    #define void_null_check(list) if(list==NULL || list->blocks==NULL || list->words==NULL) return;
+#else
+    #define null_check(list, retVal)
+    #define void_null_check(list)
+#endif
+
+//Mask covering the low <width> bits of a word (width may be 64)
+#define widthMask(width) ((width) >= 64 ? ~0UL : (1UL << (width)) - 1)
+
+//Number of bits needed to represent <value> (0 for 0)
+#define bitsNeeded(value) ((value) == 0 ? 0 : 64 - __builtin_clzl(value))
+
+//Zigzag encoding maps small negative and positive differences to small unsigned values
+#define zigzagEncode(diff) (((unsigned long) (diff) << 1) ^ (unsigned long) ((long) (diff) >> 63))
+#define zigzagDecode(value) (((value) >> 1) ^ (0UL - ((value) & 1)))
+
+
+//Pack PACKED_BLOCK_LENGTH values of <width> bits each into 2 * width words, one value at a time. Values that straddle a word boundary spill into the next word behind a data-dependent branch, so this loop is scalar.
+static void packScalar(const unsigned long* values, unsigned char width, unsigned long* out){
+    memset(out, 0, 2 * width * sizeof(unsigned long));
+
+    for(unsigned long i = 0;i < PACKED_BLOCK_LENGTH;i++){
+        unsigned long bit = i * width;
+        unsigned long word = bit / 64;
+        unsigned long shift = bit % 64;
+
+        out[word] |= values[i] << shift;
+
+        //Spill the high bits of values that straddle a word boundary
+        if(shift + width > 64) out[word + 1] |= values[i] >> (64 - shift);
+    }
+}
+
+//Unpack PACKED_BLOCK_LENGTH values of <width> bits each from 2 * width words, one value at a time
+static void unpackScalar(const unsigned long* in, unsigned char width, unsigned long* values){
+    unsigned long mask = widthMask(width);
+
+    for(unsigned long i = 0;i < PACKED_BLOCK_LENGTH;i++){
+        unsigned long bit = i * width;
+        unsigned long word = bit / 64;
+        unsigned long shift = bit % 64;
+
+        unsigned long value = in[word] >> shift;
+        if(shift + width > 64) value |= in[word + 1] << (64 - shift);
+
+        values[i] = value & mask;
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+//AVX2 version of packScalar, building 4 output words at a time. Each lane gathers every value that can overlap its word and shifts it into place by its bit offset from the word's start. Variable shifts by 64 or more give 0, so values that miss the word contribute nothing, without any branches.
+__attribute__((target("avx2")))
+static void packAVX2(const unsigned long* values, unsigned char width, unsigned long* out){
+    const long long* source = (const long long*) values;
+    const __m128i lastValue = _mm_set1_epi32(PACKED_BLOCK_LENGTH - 1);
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i widths = _mm_set1_epi32(width);
+    const __m128i zero = _mm_setzero_si128();
+
+    //At most 63 / width + 2 values overlap any one word
+    unsigned int overlapping = 63 / width + 2;
+
+    for(unsigned int word = 0;word < 2u * width;word += 4){
+        //The first value overlapping each lane's word, and that value's bit offset from the start of the word (at most 0)
+        __m128i wordBits = _mm_slli_epi32(_mm_add_epi32(_mm_set1_epi32(word), lanes), 6);
+        __m128i first = _mm_setr_epi32(64 * word / width, 64 * (word + 1) / width, 64 * (word + 2) / width, 64 * (word + 3) / width);
+        __m128i offset = _mm_sub_epi32(_mm_mullo_epi32(first, widths), wordBits);
+
+        //The first value starts at or before the word, so it is shifted right; every later one starts inside or past the word, so it is shifted left. Values past the end of the block are read from its last element instead, but they lie at least 64 bits past the word (or in a lane that is not stored), so they shift out to 0.
+        __m256i packed = _mm256_srlv_epi64(_mm256_i32gather_epi64(source, _mm_min_epi32(first, lastValue), 8), _mm256_cvtepi32_epi64(_mm_sub_epi32(zero, offset)));
+
+        for(unsigned int t = 1;t < overlapping;t++){
+            first = _mm_add_epi32(first, _mm_set1_epi32(1));
+            offset = _mm_add_epi32(offset, widths);
+
+            __m256i value = _mm256_i32gather_epi64(source, _mm_min_epi32(first, lastValue), 8);
+            packed = _mm256_or_si256(packed, _mm256_sllv_epi64(value, _mm256_cvtepi32_epi64(offset)));
+        }
+
+        //The block holds an even number of words, so the last group may have only 2
+        if(word + 4 <= 2u * width) _mm256_storeu_si256((__m256i*) (out + word), packed);
+        else _mm_storeu_si128((__m128i*) (out + word), _mm256_castsi256_si128(packed));
+    }
+}
+
+//AVX2 version of unpackScalar, 4 values at a time. Each lane gathers the word its value starts in and the word after, and combines them with variable shifts. The following word is clamped to the block's last word; when a value does not straddle a boundary, whatever it holds is shifted above <width> bits and masked off.
+__attribute__((target("avx2")))
+static void unpackAVX2(const unsigned long* in, unsigned char width, unsigned long* values){
+    const long long* source = (const long long*) in;
+    const __m256i mask = _mm256_set1_epi64x((long long) widthMask(width));
+    const __m256i wordBits = _mm256_set1_epi64x(64);
+    const __m128i lastWord = _mm_set1_epi32(2 * width - 1);
+    const __m128i lowBits = _mm_set1_epi32(63);
+    const __m128i step = _mm_set1_epi32(4 * width);
+
+    __m128i bit = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(width));
+
+    for(unsigned long i = 0;i < PACKED_BLOCK_LENGTH;i += 4){
+        __m128i word = _mm_srli_epi32(bit, 6);
+        __m128i next = _mm_min_epi32(_mm_add_epi32(word, _mm_set1_epi32(1)), lastWord);
+        __m256i shift = _mm256_cvtepu32_epi64(_mm_and_si128(bit, lowBits));
+
+        __m256i low = _mm256_srlv_epi64(_mm256_i32gather_epi64(source, word, 8), shift);
+        __m256i high = _mm256_sllv_epi64(_mm256_i32gather_epi64(source, next, 8), _mm256_sub_epi64(wordBits, shift));
+
+        _mm256_storeu_si256((__m256i*) (values + i), _mm256_and_si256(_mm256_or_si256(low, high), mask));
+        bit = _mm_add_epi32(bit, step);
+    }
+}
+#endif
+
+//Pack PACKED_BLOCK_LENGTH values of <width> bits each into 2 * width words, using the widest kernel the processor supports
+static void packBlock(const unsigned long* values, unsigned char width, unsigned long* out){
+    if(width == 0) return;
+
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        packAVX2(values, width, out);
+        return;
+    }
+    #endif
+
+    packScalar(values, width, out);
+}
+
+//Unpack PACKED_BLOCK_LENGTH values of <width> bits each from 2 * width words, using the widest kernel the processor supports
+static void unpackBlock(const unsigned long* in, unsigned char width, unsigned long* values){
+    if(width == 0){
+        memset(values, 0, PACKED_BLOCK_LENGTH * sizeof(unsigned long));
+        return;
+    }
+
+    #if defined(__GNUC__) && defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        unpackAVX2(in, width, values);
+        return;
+    }
+    #endif
+
+    unpackScalar(in, width, values);
+}
+
+//Extract a single <width>-bit value from a packed block
+static unsigned long unpackOne(const unsigned long* in, unsigned char width, unsigned long index){
+    if(width == 0) return 0;
+
+    unsigned long bit = index * width;
+    unsigned long word = bit / 64;
+    unsigned long shift = bit % 64;
+
+    unsigned long value = in[word] >> shift;
+    if(shift + width > 64) value |= in[word + 1] << (64 - shift);
+
+    return value & widthMask(width);
+}
+
+//Compress the full tail into a new block, choosing whichever of frame-of-reference and delta encoding packs more tightly. Returns 0 for success, or 1 if allocation failed (in which case the tail is kept).
+static int compressTail(packedList* list){
+    unsigned long* tail = list->tail;
+    unsigned long packed[PACKED_BLOCK_LENGTH];
+
+    //Measure both encodings in one pass
+    unsigned long min = tail[0];
+    unsigned long max = tail[0];
+    unsigned long maxZigzag = 0;
+    for(unsigned long i = 1;i < PACKED_BLOCK_LENGTH;i++){
+        if(tail[i] < min) min = tail[i];
+        if(tail[i] > max) max = tail[i];
+
+        unsigned long zz = zigzagEncode(tail[i] - tail[i - 1]);
+        if(zz > maxZigzag) maxZigzag = zz;
+    }
+
+    plBlock block;
+    unsigned char forWidth = bitsNeeded(max - min);
+    unsigned char deltaWidth = bitsNeeded(maxZigzag);
+
+    //Prefer frame-of-reference on ties, since it allows single elements to be decoded without decoding the whole block
+    if(deltaWidth < forWidth){
+        block.mode = PACKED_MODE_DELTA;
+        block.width = deltaWidth;
+        block.base = tail[0];
+
+        packed[0] = 0;
+        for(unsigned long i = 1;i < PACKED_BLOCK_LENGTH;i++) packed[i] = zigzagEncode(tail[i] - tail[i - 1]);
+    } else {
+        block.mode = PACKED_MODE_FOR;
+        block.width = forWidth;
+        block.base = min;
+
+        for(unsigned long i = 0;i < PACKED_BLOCK_LENGTH;i++) packed[i] = tail[i] - min;
+    }
+
+    block.offset = alGetListLength(list->words);
+
+    //Reserve the block's words and pack directly into them
+    if(block.width > 0){
+        unsigned long zero[PACKED_BLOCK_LENGTH] = {0};
+        if(alAppendMany(list->words, zero, 2 * block.width) == NULL) return 1;
+        packBlock(packed, block.width, (unsigned long*) alGetElement(list->words, block.offset));
+    }
+
+    if(alAppend(list->blocks, &block) == NULL){
+        if(block.width > 0) alRemoveLastMany(list->words, 2 * block.width);
+        return 1;
+    }
+
+    return 0;
+}
+
+//Decode a whole block into the list's cache, if it is not already there
+static void decodeBlock(packedList* list, alIndex blockIndex){
+    if(list->cachedBlock == blockIndex) return;
+
+    plBlock* block = (plBlock*) alGetElement(list->blocks, blockIndex);
+    unsigned long* packed = block->width > 0 ? (unsigned long*) alGetElement(list->words, block->offset) : NULL;
+    unsigned long* out = list->decoded;
+
+    unpackBlock(packed, block->width, out);
+
+    if(block->mode == PACKED_MODE_DELTA){
+        //Undo the zigzag encoding, then take the prefix sum of the differences
+        unsigned long value = block->base;
+        out[0] = value;
+        for(unsigned long i = 1;i < PACKED_BLOCK_LENGTH;i++){
+            value += zigzagDecode(out[i]);
+            out[i] = value;
+        }
+    } else {
+        for(unsigned long i = 0;i < PACKED_BLOCK_LENGTH;i++) out[i] += block->base;
+    }
+
+    list->cachedBlock = blockIndex;
+}
+
+
+//Create a new, empty packedList. Returns NULL if allocation failed.
+packedList* plNewPackedList(){
+    packedList* list = (packedList*) malloc(sizeof(packedList));
+    if(list == NULL) return NULL;
+
+    list->length = 0;
+    list->cachedBlock = ULONG_MAX;
+    list->blocks = alNewArrayList(sizeof(plBlock));
+    list->words = alNewArrayList(sizeof(unsigned long));
+
+    if(list->blocks == NULL || list->words == NULL){
+        alFreeArrayList(list->blocks);
+        alFreeArrayList(list->words);
+        free(list);
+        return NULL;
+    }
+
+    return list;
+}
+
+
+//Get the number of elements in the list
+alLength plGetListLength(packedList* list){
+    null_check(list, 0);
+    return list->length;
+}
+
+//Get the number of bytes used by the list's compressed blocks, descriptors, and tail (excluding unused allocated memory)
+unsigned long plGetListSize(packedList* list){
+    null_check(list, 0);
+    return alGetListSize(list->blocks) + alGetListSize(list->words) + (list->length % PACKED_BLOCK_LENGTH) * sizeof(unsigned long);
+}
+
+
+//Get an element by index. Returns a pointer to a decoded copy of the element, which remains valid until the next call to a packedList function, or NULL for invalid inputs (element out of bounds, etc.).
+unsigned long* plGetElement(packedList* list, alIndex index){
+    null_check(list, NULL);
+
+    #ifndef NO_SAFETY
+    if(index >= list->length) return NULL;
+    #endif
+
+    alIndex blockIndex = index / PACKED_BLOCK_LENGTH;
+    alIndex offset = index % PACKED_BLOCK_LENGTH;
+
+    //Elements in the tail are stored uncompressed
+    if(blockIndex == alGetListLength(list->blocks)) return list->tail + offset;
+
+    //Use the decoded copy of the block if we have one (e.g., during sequential access)
+    if(list->cachedBlock == blockIndex) return list->decoded + offset;
+
+    plBlock* block = (plBlock*) alGetElement(list->blocks, blockIndex);
+
+    //A frame-of-reference element can be decoded on its own, which is much cheaper than decoding the whole block
+    if(block->mode == PACKED_MODE_FOR){
+        unsigned long* packed = block->width > 0 ? (unsigned long*) alGetElement(list->words, block->offset) : NULL;
+        list->element = block->base + unpackOne(packed, block->width, offset);
+        return &list->element;
+    }
+
+    decodeBlock(list, blockIndex);
+    return list->decoded + offset;
+}
+
+//Get the last element in the list. Returns a pointer to a decoded copy of the element, or NULL if the list is empty or bad.
+unsigned long* plGetLast(packedList* list){
+    null_check(list, NULL);
+
+    #ifndef NO_SAFETY
+    if(list->length < 1) return NULL;
+    #endif
+
+    return plGetElement(list, list->length - 1);
+}
+
+//Get the first element in the list. Returns a pointer to a decoded copy of the element, or NULL if the list is empty or bad.
+unsigned long* plGetFirst(packedList* list){
+    null_check(list, NULL);
+    return plGetElement(list, 0);
+}
+
+
+//Add an element to the end of the list. Returns a pointer to a copy of the element, which remains valid until the next call to a packedList function, or NULL if the attempt failed (usually because allocation failed).
+unsigned long* plAppend(packedList* list, unsigned long element){
+    null_check(list, NULL);
+
+    #ifndef NO_SAFETY
+    if(list->length == ULONG_MAX) return NULL;
+    #endif
+
+    alIndex offset = list->length % PACKED_BLOCK_LENGTH;
+    list->tail[offset] = element;
+
+    //Compress the tail once it is full
+    if(offset == PACKED_BLOCK_LENGTH - 1){
+        if(compressTail(list) != 0) return NULL;
+
+        //The tail still holds the decoded block, so keep it as the cached copy
+        memcpy(list->decoded, list->tail, sizeof(list->decoded));
+        list->cachedBlock = alGetListLength(list->blocks) - 1;
+        list->length++;
+        return list->decoded + offset;
+    }
+
+    list->length++;
+
+    return list->tail + offset;
+}
+
+//Add <count> elements to the end of the list, copying them from <elements>. Returns 0 for success, or 1 if the operation failed (including cases where count < 1). On failure, some of the elements may have been appended.
+int plAppendMany(packedList* list, unsigned long* elements, alLength count){
+    null_check(list, 1);
+
+    if(count < 1) return 1;
+
+    for(alIndex i = 0;i < count;i++){
+        if(plAppend(list, elements[i]) == NULL) return 1;
+    }
+
+    return 0;
+}
+
+
+//Decode the next run of elements, starting at index <*cursor>, into <out> (which must have room for PACKED_BLOCK_LENGTH elements), and advance the cursor. <cursor> must be set to 0 before the first call.
+//Returns the number of elements decoded (at most PACKED_BLOCK_LENGTH), or 0 once the end of the list is reached.
+alLength plScan(packedList* list, alIndex* cursor, unsigned long* out){
+    null_check(list, 0);
+
+    if(*cursor >= list->length) return 0;
+
+    alIndex blockIndex = *cursor / PACKED_BLOCK_LENGTH;
+    alIndex offset = *cursor % PACKED_BLOCK_LENGTH;
+    alLength count;
+
+    if(blockIndex == alGetListLength(list->blocks)){
+        //Copy out of the tail
+        count = list->length % PACKED_BLOCK_LENGTH - offset;
+        memcpy(out, list->tail + offset, count * sizeof(unsigned long));
+    } else {
+        decodeBlock(list, blockIndex);
+        count = PACKED_BLOCK_LENGTH - offset;
+        memcpy(out, list->decoded + offset, count * sizeof(unsigned long));
+    }
+
+    *cursor += count;
+
+    return count;
+}
+
+
+//Destroy and de-allocate a packedList
+void plFreePackedList(packedList* list){
+    void_null_check(list);
+
+    alFreeArrayList(list->blocks);
+    alFreeArrayList(list->words);
+    free(list);
+}
+
+//Print diagnostic information for debugging and development
+void plDiagnostics(packedList* list){
+    printf("Length: %ld\nBlocks: %ld\nPacked Words: %ld\nBytes Used: %ld\nUncompressed Bytes: %ld\n",
+        plGetListLength(list), alGetListLength(list->blocks), alGetListLength(list->words), plGetListSize(list), plGetListLength(list) * sizeof(unsigned long)
+        );
+
+    printf("Blocks:\n");
+    for(alIndex i = 0;i < alGetListLength(list->blocks);i++){
+        plBlock* block = (plBlock*) alGetElement(list->blocks, i);
+        printf("%s base=%lu width=%d\n", block->mode == PACKED_MODE_DELTA ? "DELTA" : "FOR  ", block->base, (int) block->width);
+    }
+}
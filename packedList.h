@@ -0,0 +1,94 @@
+#ifndef PACKEDLIST_H
+#define PACKEDLIST_H
+
+#include "arrayList.h"
+
+#define PACKED_BLOCK_LENGTH 128 //The number of elements in each compressed block
+
+//Block encodings. Frame-of-reference stores each value minus the block's minimum, while delta stores the zigzag-encoded difference from the previous value.
+#define PACKED_MODE_FOR 0
+#define PACKED_MODE_DELTA 1
+
+
+//Descriptor for one compressed block of PACKED_BLOCK_LENGTH elements
+typedef struct plBlock {
+    //The block's minimum value (frame-of-reference) or first value (delta)
+    unsigned long base;
+
+    //Index, in the packedList's word list, of the block's first packed word
+    alIndex offset;
+
+    //Number of bits used for each packed value (0 to 64). A block always occupies exactly 2 * width words.
+    unsigned char width;
+
+    //PACKED_MODE_FOR or PACKED_MODE_DELTA
+    unsigned char mode;
+} plBlock;
+
+
+//Define the packedList type, a list of 64-bit unsigned integers stored in compressed blocks
+//Elements are appended to an uncompressed tail, which is compressed into a new block once it holds PACKED_BLOCK_LENGTH elements
+typedef struct packList {
+    //Number of elements in the list, including the tail
+    alLength length;
+
+    //arrayList of plBlock descriptors, one for each full block
+    arrayList* blocks;
+
+    //arrayList of 64-bit words holding the bit-packed values of every block
+    arrayList* words;
+
+    //Elements that have not yet been compressed (the last length % PACKED_BLOCK_LENGTH elements)
+    unsigned long tail[PACKED_BLOCK_LENGTH];
+
+    //Index of the block currently held in <decoded>, or ULONG_MAX if none
+    alIndex cachedBlock;
+
+    //The most recently decoded block. Sequential access decodes each block only once.
+    unsigned long decoded[PACKED_BLOCK_LENGTH];
+
+    //The most recently decoded single element (used for random access into frame-of-reference blocks, which does not disturb the cached block)
+    unsigned long element;
+} packedList;
+
+
+//Create a new, empty packedList. Returns NULL if allocation failed.
+packedList* plNewPackedList();
+
+
+//Get the number of elements in the list
+alLength plGetListLength(packedList*);
+
+//Get the number of bytes used by the list's compressed blocks, descriptors, and tail (excluding unused allocated memory)
+unsigned long plGetListSize(packedList*);
+
+
+//Get an element by index. Returns a pointer to a decoded copy of the element, which remains valid until the next call to a packedList function, or NULL for invalid inputs (element out of bounds, etc.).
+unsigned long* plGetElement(packedList*, alIndex);
+
+//Get the last element in the list. Returns a pointer to a decoded copy of the element, or NULL if the list is empty or bad.
+unsigned long* plGetLast(packedList*);
+
+//Get the first element in the list. Returns a pointer to a decoded copy of the element, or NULL if the list is empty or bad.
+unsigned long* plGetFirst(packedList*);
+
+
+//Add an element to the end of the list. Returns a pointer to a copy of the element, which remains valid until the next call to a packedList function, or NULL if the attempt failed (usually because allocation failed).
+unsigned long* plAppend(packedList*, unsigned long);
+
+//Add <count> elements to the end of the list, copying them from <elements>. Returns 0 for success, or 1 if the operation failed (including cases where count < 1). On failure, some of the elements may have been appended.
+int plAppendMany(packedList*, unsigned long*, alLength);
+
+
+//Decode the next run of elements, starting at index <*cursor>, into <out> (which must have room for PACKED_BLOCK_LENGTH elements), and advance the cursor. <cursor> must be set to 0 before the first call.
+//Returns the number of elements decoded (at most PACKED_BLOCK_LENGTH), or 0 once the end of the list is reached.
+alLength plScan(packedList*, alIndex*, unsigned long*);
+
+
+//Destroy and de-allocate a packedList
+void plFreePackedList(packedList*);
+
+//Print diagnostic information for debugging and development
+void plDiagnostics(packedList*);
+
+#endif
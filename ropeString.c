@@ -0,0 +1,506 @@
+#include "ropeString.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(rope, retVal) if(rope==NULL) return retVal;
+    #define void_null_check(rope) if(rope==NULL) return;
+#else
+    #define null_check(rope, retVal)
+    #define void_null_check(rope)
+#endif
+
+//Base state of the ropes' priority generators, which each rope mixes with its own creation number
+#define ROPE_SEED 0x9E3779B97F4A7C15UL
+
+//Get the size of a subtree, which may be empty
+#define subtreeSize(node) ((node) == NULL ? 0 : (node)->size)
+
+
+//Number of ropes created so far, which gives every rope a different priority sequence. If two ropes shared one, concatenating them would pair up equal priorities and degrade the tree into a list.
+static atomic_ulong ropesCreated;
+
+//Get the initial generator state for the next rope: its creation number, scrambled (with the splitmix64 finalizer) so that consecutive ropes' sequences are unrelated
+static unsigned long nextSeed(){
+    unsigned long x = ROPE_SEED * (atomic_fetch_add(&ropesCreated, 1) + 1);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9UL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBUL;
+    x ^= x >> 31;
+
+    //xorshift never leaves the zero state
+    return x != 0 ? x : ROPE_SEED;
+}
+
+
+//Get the next random node priority (xorshift64)
+static unsigned int nextPriority(lstrRope* rope){
+    unsigned long x = rope->seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    rope->seed = x;
+    return (unsigned int) (x >> 32);
+}
+
+//Recompute a node's subtree size from its children
+static void updateSize(ropeNode* node){
+    node->size = subtreeSize(node->left) + subtreeSize(node->right) + node->length;
+}
+
+//Allocate a node with no children. Returns NULL if allocation failed.
+static ropeNode* newNode(lstrRope* rope){
+    ropeNode* node = (ropeNode*) malloc(sizeof(ropeNode));
+    if(node == NULL) return NULL;
+
+    node->left = NULL;
+    node->right = NULL;
+    node->size = 0;
+    node->length = 0;
+    node->priority = nextPriority(rope);
+
+    return node;
+}
+
+//Free every node in a subtree
+static void freeNodes(ropeNode* node){
+    while(node != NULL){
+        freeNodes(node->left);
+        ropeNode* right = node->right;
+        free(node);
+        node = right;
+    }
+}
+
+//Recompute the sizes of every node in a subtree, children first
+static void updateSizes(ropeNode* node){
+    if(node == NULL) return;
+    updateSizes(node->left);
+    updateSizes(node->right);
+    updateSize(node);
+}
+
+//Build a tree holding a copy of <len> bytes, filling each chunk completely. Returns its root, or NULL if allocation failed (or len is 0).
+//The nodes are linked into a Cartesian tree by priority in a single left-to-right pass, so the result is a valid treap without any rotations.
+static ropeNode* buildNodes(lstrRope* rope, const char* bytes, lstrLength len){
+    if(len < 1) return NULL;
+
+    lstrLength count = (len + ROPE_CHUNK_BYTES - 1) / ROPE_CHUNK_BYTES;
+
+    //The right spine of the tree built so far
+    ropeNode** spine = (ropeNode**) malloc(count * sizeof(ropeNode*));
+    if(spine == NULL) return NULL;
+
+    lstrLength depth = 0;
+    ropeNode* root = NULL;
+
+    for(lstrLength i = 0;i < count;i++){
+        ropeNode* node = newNode(rope);
+        if(node == NULL){
+            freeNodes(root);
+            free(spine);
+            return NULL;
+        }
+
+        node->length = (unsigned int) (i + 1 < count ? ROPE_CHUNK_BYTES : len - i * ROPE_CHUNK_BYTES);
+        memcpy(node->data, bytes + i * ROPE_CHUNK_BYTES, node->length);
+
+        //Lower-priority nodes on the spine become the new node's left subtree
+        ropeNode* last = NULL;
+        while(depth > 0 && spine[depth - 1]->priority < node->priority) last = spine[--depth];
+        node->left = last;
+
+        if(depth > 0) spine[depth - 1]->right = node;
+        else root = node;
+
+        spine[depth++] = node;
+    }
+
+    free(spine);
+    updateSizes(root);
+
+    return root;
+}
+
+//Join two trees, with every byte of <a> before every byte of <b>. Returns the new root.
+static ropeNode* merge(ropeNode* a, ropeNode* b){
+    if(a == NULL) return b;
+    if(b == NULL) return a;
+
+    if(a->priority > b->priority){
+        a->right = merge(a->right, b);
+        updateSize(a);
+        return a;
+    }
+
+    b->left = merge(a, b->left);
+    updateSize(b);
+    return b;
+}
+
+//Split a tree into its first <pos> bytes (<left>) and the rest (<right>). If the split falls inside a chunk, the chunk's tail is moved into <*spare>, which is then set to NULL.
+static void split(ropeNode* node, lstrIndex pos, ropeNode** left, ropeNode** right, ropeNode** spare){
+    if(node == NULL){
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    lstrLength leftSize = subtreeSize(node->left);
+
+    if(pos <= leftSize){
+        split(node->left, pos, left, &node->left, spare);
+        updateSize(node);
+        *right = node;
+    } else if(pos >= leftSize + node->length){
+        split(node->right, pos - leftSize - node->length, &node->right, right, spare);
+        updateSize(node);
+        *left = node;
+    } else {
+        //Cut the chunk. The tail takes the node's place (and priority) at the root of the right half.
+        unsigned int offset = (unsigned int) (pos - leftSize);
+        ropeNode* tail = *spare;
+        *spare = NULL;
+
+        tail->length = node->length - offset;
+        memcpy(tail->data, node->data + offset, tail->length);
+        tail->priority = node->priority;
+        tail->left = NULL;
+        tail->right = node->right;
+        updateSize(tail);
+
+        node->length = offset;
+        node->right = NULL;
+        updateSize(node);
+
+        *left = node;
+        *right = tail;
+    }
+}
+
+//If the last chunk of <left> and the first chunk of <*right> fit in one node, move the second into the first and free its node. This keeps chunks from fragmenting at the seams left by splits.
+static void coalesce(ropeNode* left, ropeNode** right){
+    if(left == NULL || *right == NULL) return;
+
+    ropeNode* last = left;
+    while(last->right != NULL) last = last->right;
+
+    ropeNode* first = *right;
+    while(first->left != NULL) first = first->left;
+
+    if(last->length + first->length > ROPE_CHUNK_BYTES) return;
+
+    //Grow the last chunk, which sits at the end of the right spine
+    memcpy(last->data + last->length, first->data, first->length);
+    last->length += first->length;
+    for(ropeNode* node = left;node != NULL;node = node->right) node->size += first->length;
+
+    //Unlink the first chunk, which sits at the end of the left spine and so has no left child
+    ropeNode** link = right;
+    while(*link != first){
+        (*link)->size -= first->length;
+        link = &(*link)->left;
+    }
+    *link = first->right;
+
+    free(first);
+}
+
+//Find the node holding a byte index, where an index at the end of one chunk belongs to that chunk. Stores the index's offset within the chunk in <offset>.
+static ropeNode* findNode(ropeNode* node, lstrIndex pos, unsigned int* offset){
+    while(node != NULL){
+        lstrLength leftSize = subtreeSize(node->left);
+
+        if(pos < leftSize) node = node->left;
+        else if(pos <= leftSize + node->length){
+            *offset = (unsigned int) (pos - leftSize);
+            return node;
+        } else {
+            pos -= leftSize + node->length;
+            node = node->right;
+        }
+    }
+
+    return NULL;
+}
+
+//Add <delta> (which may wrap to subtract) to the size of every node on the path that findNode takes to a byte index
+static void adjustPath(ropeNode* node, lstrIndex pos, lstrLength delta){
+    while(node != NULL){
+        lstrLength leftSize = subtreeSize(node->left);
+        node->size += delta;
+
+        if(pos < leftSize) node = node->left;
+        else if(pos <= leftSize + node->length) return;
+        else {
+            pos -= leftSize + node->length;
+            node = node->right;
+        }
+    }
+}
+
+
+//Merge a chunk that starts at byte <start> into whichever neighbouring chunk it fits with (the next one first), by splitting the tree at the seam between them and coalescing across it. Does nothing if neither neighbour has room.
+static void mergeUnderfull(lstrRope* rope, lstrIndex start, const ropeNode* node){
+    lstrIndex end = start + node->length;
+    unsigned int offset = 0;
+
+    //An index at the end of a chunk belongs to that chunk, so the byte after <end> is in the next chunk, and <start> is in the previous one
+    const ropeNode* next = end < subtreeSize(rope->root) ? findNode(rope->root, end + 1, &offset) : NULL;
+    const ropeNode* previous = start > 0 ? findNode(rope->root, start, &offset) : NULL;
+
+    lstrIndex seam;
+    if(next != NULL && node->length + next->length <= ROPE_CHUNK_BYTES) seam = end;
+    else if(previous != NULL && previous->length + node->length <= ROPE_CHUNK_BYTES) seam = start;
+    else return;
+
+    //A split at a chunk boundary never cuts a chunk, so it needs no spare node
+    ropeNode *left, *right, *spare = NULL;
+    split(rope->root, seam, &left, &right, &spare);
+    coalesce(left, &right);
+    rope->root = merge(left, right);
+}
+
+//Create a new, empty rope. Returns NULL if allocation failed.
+lstrRope* ropeNewRope(){
+    lstrRope* rope = (lstrRope*) malloc(sizeof(lstrRope));
+    if(rope == NULL) return NULL;
+
+    rope->root = NULL;
+    rope->seed = nextSeed();
+
+    return rope;
+}
+
+//Create a new rope that contains a copy of an lString's contents (including any '\0' bytes within its length). Returns NULL if allocation failed or the lString is bad.
+lstrRope* ropeFromLString(lString* lstr){
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL) return NULL;
+    #endif
+
+    lstrRope* rope = ropeNewRope();
+    if(rope == NULL) return NULL;
+
+    if(lstr->length > 0){
+        rope->root = buildNodes(rope, lstr->head, lstr->length);
+
+        if(rope->root == NULL){
+            free(rope);
+            return NULL;
+        }
+    }
+
+    return rope;
+}
+
+
+//Get the length of the rope, in bytes
+lstrLength ropeGetLength(lstrRope* rope){
+    null_check(rope, 0);
+    return subtreeSize(rope->root);
+}
+
+//Get a pointer to an arbitrary character in the rope by index. The pointer is only valid until the rope is next modified. Returns NULL for an invalid rope or an out-of-bounds index.
+char* ropeGetChar(lstrRope* rope, lstrIndex index){
+    null_check(rope, NULL);
+
+    if(index >= subtreeSize(rope->root)) return NULL;
+
+    ropeNode* node = rope->root;
+    while(1){
+        lstrLength leftSize = subtreeSize(node->left);
+
+        if(index < leftSize) node = node->left;
+        else if(index < leftSize + node->length) return node->data + (index - leftSize);
+        else {
+            index -= leftSize + node->length;
+            node = node->right;
+        }
+    }
+}
+
+
+//Insert <len> bytes (which may include '\0') at an arbitrary point in the rope. Returns 0 for success, or 1 if the operation fails (index out of bounds, allocation failed, etc.), in which case the rope is unchanged.
+int ropeInsert(lstrRope* rope, lstrIndex index, char* bytes, lstrLength len){
+    null_check(rope, 1);
+
+    #ifndef NO_SAFETY
+    if(bytes == NULL) return 1;
+    #endif
+
+    lstrLength length = subtreeSize(rope->root);
+    if(index > length || len > MAXIMUM_STRING_BYTES - 1 - length) return 1;
+    if(len < 1) return 0;
+
+    //Small insertions go straight into the chunk at the insertion point if it has room, touching only the sizes on its path
+    unsigned int offset = 0;
+    ropeNode* target = findNode(rope->root, index, &offset);
+
+    if(target != NULL && len <= ROPE_CHUNK_BYTES - target->length){
+        memmove(target->data + offset + len, target->data + offset, target->length - offset);
+        memcpy(target->data + offset, bytes, len);
+        target->length += (unsigned int) len;
+        adjustPath(rope->root, index, len);
+        return 0;
+    }
+
+    //Otherwise, split the tree at the insertion point and merge a new subtree into the gap
+    ropeNode* middle = buildNodes(rope, bytes, len);
+    ropeNode* spare = newNode(rope);
+
+    if(middle == NULL || spare == NULL){
+        freeNodes(middle);
+        free(spare);
+        return 1;
+    }
+
+    ropeNode *left, *right;
+    split(rope->root, index, &left, &right, &spare);
+
+    coalesce(left, &middle);
+    left = merge(left, middle);
+    coalesce(left, &right);
+    rope->root = merge(left, right);
+
+    free(spare);
+
+    return 0;
+}
+
+//Insert a copy of a null-terminated string at an arbitrary point in the rope. Returns 0 for success, or 1 if the operation fails, in which case the rope is unchanged.
+int ropeInsertString(lstrRope* rope, lstrIndex index, char* str){
+    #ifndef NO_SAFETY
+    if(str == NULL) return 1;
+    #endif
+
+    return ropeInsert(rope, index, str, strlen(str));
+}
+
+//Insert <len> bytes (which may include '\0') at the end of the rope. Returns 0 for success, or 1 if the operation fails, in which case the rope is unchanged.
+int ropeAppend(lstrRope* rope, char* bytes, lstrLength len){
+    null_check(rope, 1);
+    return ropeInsert(rope, subtreeSize(rope->root), bytes, len);
+}
+
+//Remove <len> bytes, starting at the specified index and going forward. Returns 0 for success, or 1 if the operation fails (range out of bounds, allocation failed, etc.), in which case the rope is unchanged.
+int ropeRemove(lstrRope* rope, lstrIndex index, lstrLength len){
+    null_check(rope, 1);
+
+    lstrLength length = subtreeSize(rope->root);
+    if(index > length || len > length - index) return 1;
+    if(len < 1) return 0;
+
+    //Removals that fall inside one chunk (without emptying it) are done in place. A chunk left less than half full is merged with a neighbour, so that repeated small removals cannot leave the rope made of nearly empty nodes.
+    unsigned int offset = 0;
+    ropeNode* target = findNode(rope->root, index, &offset);
+
+    if(offset < target->length && len < target->length && len <= target->length - offset){
+        memmove(target->data + offset, target->data + offset + len, target->length - offset - len);
+        target->length -= (unsigned int) len;
+        adjustPath(rope->root, index, -len);
+
+        if(target->length < ROPE_CHUNK_BYTES / 2) mergeUnderfull(rope, index - offset, target);
+        return 0;
+    }
+
+    //Otherwise, cut out the removed range with two splits, which may each need to cut a chunk
+    ropeNode* spare1 = newNode(rope);
+    ropeNode* spare2 = newNode(rope);
+
+    if(spare1 == NULL || spare2 == NULL){
+        free(spare1);
+        free(spare2);
+        return 1;
+    }
+
+    ropeNode *left, *middle, *right;
+    split(rope->root, index, &left, &right, &spare1);
+    split(right, len, &middle, &right, spare1 != NULL ? &spare1 : &spare2);
+
+    freeNodes(middle);
+    coalesce(left, &right);
+    rope->root = merge(left, right);
+
+    free(spare1);
+    free(spare2);
+
+    return 0;
+}
+
+//Append the second rope to the first in O(log n) expected time, without copying any text. The second rope is consumed: it is de-allocated and must not be used again. Returns 0 for success, or 1 if either rope is bad.
+int ropeConcat(lstrRope* rope, lstrRope* other){
+    null_check(rope, 1);
+    null_check(other, 1);
+
+    if(rope == other || subtreeSize(other->root) > MAXIMUM_STRING_BYTES - 1 - subtreeSize(rope->root)) return 1;
+
+    coalesce(rope->root, &other->root);
+    rope->root = merge(rope->root, other->root);
+    free(other);
+
+    return 0;
+}
+
+
+//Copy every chunk of a subtree, in order, to <dest>. Returns the position after the last byte copied.
+static char* copyNodes(const ropeNode* node, char* dest){
+    while(node != NULL){
+        dest = copyNodes(node->left, dest);
+        memcpy(dest, node->data, node->length);
+        dest += node->length;
+        node = node->right;
+    }
+
+    return dest;
+}
+
+//Copy the rope's contents into a new, contiguous, null-terminated lString. Returns NULL if allocation failed or the rope is bad.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* ropeFlatten(lstrRope* rope){
+    null_check(rope, NULL);
+
+    lstrLength length = subtreeSize(rope->root);
+
+    //Size the string once, then copy every chunk straight into it. The bytes after the copy are already '\0'.
+    lString* lstr = lstrNewBlankString();
+    if(lstr == NULL) return NULL;
+
+    if(lstrReserve(lstr, length) != 0){
+        lstrFreeString(lstr);
+        return NULL;
+    }
+
+    copyNodes(rope->root, lstr->head);
+    lstr->length = length;
+
+    return lstr;
+}
+
+
+//Destroy and de-allocate a rope
+void ropeFreeRope(lstrRope* rope){
+    void_null_check(rope);
+    freeNodes(rope->root);
+    free(rope);
+}
+
+//Count the nodes in a subtree and find its height
+static void measureNodes(const ropeNode* node, unsigned long depth, unsigned long* count, unsigned long* height){
+    if(node == NULL) return;
+
+    (*count)++;
+    if(depth > *height) *height = depth;
+
+    measureNodes(node->left, depth + 1, count, height);
+    measureNodes(node->right, depth + 1, count, height);
+}
+
+//Print diagnostic information for debugging and development
+void ropeDiagnostics(lstrRope* rope){
+    unsigned long count = 0, height = 0;
+    measureNodes(rope->root, 1, &count, &height);
+
+    printf("Length: %ld\nNodes: %ld\nHeight: %ld\nRoot: %p\n", ropeGetLength(rope), count, height, (void*) rope->root);
+}
@@ -0,0 +1,79 @@
+#ifndef ROPESTRING_H
+#define ROPESTRING_H
+
+#include "listString.h"
+
+#define ROPE_CHUNK_BYTES 224 //The number of text bytes each rope node holds, which makes a whole node exactly 256 bytes (four cache lines)
+
+
+//A node of a rope. Each node holds one chunk of the text, and the text of the whole rope is the in-order concatenation of every node's chunk.
+typedef struct ropeNode {
+    //Children: every byte in <left> comes before this node's chunk, and every byte in <right> comes after it
+    struct ropeNode* left;
+    struct ropeNode* right;
+
+    //Total number of bytes in this node's subtree, including its own chunk
+    lstrLength size;
+
+    //Random treap priority. A node's priority is never lower than its children's, which keeps the tree balanced in expectation.
+    unsigned int priority;
+
+    //Number of bytes in use in <data>
+    unsigned int length;
+
+    char data[ROPE_CHUNK_BYTES];
+} ropeNode;
+
+//Define the lstrRope type, a string stored as a balanced tree (a treap) of fixed-size chunks
+//Insertions and removals anywhere in the string cost O(log n) expected time plus the size of the edit, instead of moving every later byte, and two ropes can be concatenated in O(log n)
+typedef struct listStringRope {
+    //Root of the tree, or NULL if the rope is empty
+    ropeNode* root;
+
+    //State of the random number generator that assigns node priorities
+    unsigned long seed;
+} lstrRope;
+
+
+//Create a new, empty rope. Returns NULL if allocation failed.
+lstrRope* ropeNewRope();
+
+//Create a new rope that contains a copy of an lString's contents (including any '\0' bytes within its length). Returns NULL if allocation failed or the lString is bad.
+lstrRope* ropeFromLString(lString*);
+
+
+//Get the length of the rope, in bytes
+lstrLength ropeGetLength(lstrRope*);
+
+//Get a pointer to an arbitrary character in the rope by index. The pointer is only valid until the rope is next modified. Returns NULL for an invalid rope or an out-of-bounds index.
+char* ropeGetChar(lstrRope*, lstrIndex);
+
+
+//Insert <len> bytes (which may include '\0') at an arbitrary point in the rope. Returns 0 for success, or 1 if the operation fails (index out of bounds, allocation failed, etc.), in which case the rope is unchanged.
+int ropeInsert(lstrRope*, lstrIndex, char*, lstrLength);
+
+//Insert a copy of a null-terminated string at an arbitrary point in the rope. Returns 0 for success, or 1 if the operation fails, in which case the rope is unchanged.
+int ropeInsertString(lstrRope*, lstrIndex, char*);
+
+//Insert <len> bytes (which may include '\0') at the end of the rope. Returns 0 for success, or 1 if the operation fails, in which case the rope is unchanged.
+int ropeAppend(lstrRope*, char*, lstrLength);
+
+//Remove <len> bytes, starting at the specified index and going forward. Returns 0 for success, or 1 if the operation fails (range out of bounds, allocation failed, etc.), in which case the rope is unchanged.
+int ropeRemove(lstrRope*, lstrIndex, lstrLength);
+
+//Append the second rope to the first in O(log n) expected time, without copying any text. The second rope is consumed: it is de-allocated and must not be used again. Returns 0 for success, or 1 if either rope is bad.
+int ropeConcat(lstrRope*, lstrRope*);
+
+
+//Copy the rope's contents into a new, contiguous, null-terminated lString. Returns NULL if allocation failed or the rope is bad.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeString.
+lString* ropeFlatten(lstrRope*);
+
+
+//Destroy and de-allocate a rope
+void ropeFreeRope(lstrRope*);
+
+//Print diagnostic information for debugging and development
+void ropeDiagnostics(lstrRope*);
+
+#endif
@@ -0,0 +1,232 @@
+#include "soaList.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(list, retVal) if(list==NULL || list->columns==NULL) return retVal;
+    #define void_null_check(list) if(list==NULL || list->columns==NULL) return;
+#else
+    #define null_check(list, retVal)
+    #define void_null_check(list)
+#endif
+
+//Get a pointer to a field within an AoS record
+#define fieldInRecord(record, field) ((void*) ((unsigned long) (record) + (field).offset))
+
+
+//Create a new soaList for records of <recordSize> bytes with the given fields. The field descriptors are copied.
+//Returns NULL if allocation failed or any field is empty or extends past the end of the record.
+soaList* soaNewList(alESize recordSize, soaField* fields, alESize fieldCount){
+    #ifndef NO_SAFETY
+    if(fields == NULL || fieldCount < 1) return NULL;
+    for(alESize i = 0;i < fieldCount;i++){
+        if(fields[i].size < 1 || (unsigned long) fields[i].offset + fields[i].size > recordSize) return NULL;
+    }
+    #endif
+
+    soaList* list = (soaList*) malloc(sizeof(soaList));
+    if(list == NULL) return NULL;
+
+    list->recordSize = recordSize;
+    list->fieldCount = fieldCount;
+    list->fields = (soaField*) malloc(fieldCount * sizeof(soaField));
+    list->columns = (arrayList**) calloc(fieldCount, sizeof(arrayList*));
+
+    if(list->fields == NULL || list->columns == NULL){
+        free(list->fields);
+        free(list->columns);
+        free(list);
+        return NULL;
+    }
+
+    memcpy(list->fields, fields, fieldCount * sizeof(soaField));
+
+    //Create one column per field
+    for(alESize i = 0;i < fieldCount;i++){
+        list->columns[i] = alNewArrayList(fields[i].size);
+
+        if(list->columns[i] == NULL){
+            soaFreeList(list);
+            return NULL;
+        }
+    }
+
+    return list;
+}
+
+
+//Get the number of records in the list
+alLength soaGetListLength(soaList* list){
+    null_check(list, 0);
+    return alGetListLength(list->columns[0]);
+}
+
+//Get a pointer to the head of a column, for direct (e.g., vectorized) scans over one field. Like alGetListHead, the pointer changes as the list grows, so it should not be stored. Returns NULL for an invalid field or list.
+void* soaGetColumn(soaList* list, alESize field){
+    null_check(list, NULL);
+
+    #ifndef NO_SAFETY
+    if(field >= list->fieldCount) return NULL;
+    #endif
+
+    return alGetListHead(list->columns[field]);
+}
+
+//Get a pointer to one field of one record. Returns NULL for invalid inputs (bad list, field or index out of bounds, etc.).
+void* soaGetField(soaList* list, alIndex index, alESize field){
+    null_check(list, NULL);
+
+    #ifndef NO_SAFETY
+    if(field >= list->fieldCount) return NULL;
+    #endif
+
+    return alGetElement(list->columns[field], index);
+}
+
+
+//Copy a record out of the list into <record>, which must be <recordSize> bytes long. Bytes that are not part of any field are set to 0. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaGetElement(soaList* list, alIndex index, void* record){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index >= soaGetListLength(list)) return 1;
+    #endif
+
+    memset(record, 0, list->recordSize);
+
+    //Gather each field from its column
+    for(alESize i = 0;i < list->fieldCount;i++){
+        memcpy(fieldInRecord(record, list->fields[i]), alGetElement(list->columns[i], index), list->fields[i].size);
+    }
+
+    return 0;
+}
+
+//Overwrite a record in the list with the fields of <record>. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaSetElement(soaList* list, alIndex index, void* record){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index >= soaGetListLength(list)) return 1;
+    #endif
+
+    //Scatter each field into its column
+    for(alESize i = 0;i < list->fieldCount;i++){
+        memmove(alGetElement(list->columns[i], index), fieldInRecord(record, list->fields[i]), list->fields[i].size);
+    }
+
+    return 0;
+}
+
+
+//Insert a copy of a record at an arbitrary index, scattering its fields into the columns. All later records are shifted up. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaInsert(soaList* list, alIndex index, void* record){
+    return soaInsertMany(list, index, record, 1);
+}
+
+//Add a copy of a record to the end of the list. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaAppend(soaList* list, void* record){
+    null_check(list, 1);
+    return soaInsertMany(list, soaGetListLength(list), record, 1);
+}
+
+//Add a copy of a record to the start of the list. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaPrepend(soaList* list, void* record){
+    return soaInsertMany(list, 0, record, 1);
+}
+
+//Insert <count> contiguous records at index <index>. Returns 0 for success, or 1 if the operation failed, including cases where count < 1 (in which case the list is unchanged).
+int soaInsertMany(soaList* list, alIndex index, void* records, alLength count){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(index > soaGetListLength(list) || count < 1) return 1;
+    #endif
+
+    for(alESize i = 0;i < list->fieldCount;i++){
+        soaField field = list->fields[i];
+
+        //Open a gap of <count> elements in the column. The records themselves serve as (meaningless) source bytes, since they are always at least as long as the gap.
+        char* gap = (char*) alInsertMany(list->columns[i], index, records, count);
+
+        //If any column cannot grow, undo the insertion in the columns that already grew
+        if(gap == NULL){
+            for(alESize j = 0;j < i;j++) alRemoveMany(list->columns[j], index, count);
+            return 1;
+        }
+
+        //Scatter the field of each record into the gap
+        const char* src = (const char*) fieldInRecord(records, field);
+        for(alIndex k = 0;k < count;k++){
+            memcpy(gap, src, field.size);
+            gap += field.size;
+            src += list->recordSize;
+        }
+    }
+
+    return 0;
+}
+
+//Insert <count> contiguous records at the end of the list. Returns 0 for success, or 1 if the operation failed, including cases where count < 1 (in which case the list is unchanged).
+int soaAppendMany(soaList* list, void* records, alLength count){
+    null_check(list, 1);
+    return soaInsertMany(list, soaGetListLength(list), records, count);
+}
+
+
+//Remove a record by index. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaRemove(soaList* list, alIndex index){
+    return soaRemoveMany(list, index, 1);
+}
+
+//Remove the last record. Returns 0 for success, or 1 if the list has no records or the list is bad.
+int soaRemoveLast(soaList* list){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    if(soaGetListLength(list) < 1) return 1;
+    #endif
+
+    return soaRemoveMany(list, soaGetListLength(list) - 1, 1);
+}
+
+//Remove <count> records from index <index> to <index + count - 1>. Returns 0 for success, or 1 if the list has too few records or the list is bad.
+int soaRemoveMany(soaList* list, alIndex index, alLength count){
+    null_check(list, 1);
+
+    #ifndef NO_SAFETY
+    alLength length = soaGetListLength(list);
+    if(length < count || count < 1 || index + count > length) return 1;
+    #endif
+
+    //Removal never fails once the bounds are checked, so the columns stay in sync
+    for(alESize i = 0;i < list->fieldCount;i++) alRemoveMany(list->columns[i], index, count);
+
+    return 0;
+}
+
+
+//Destroy and de-allocate a soaList
+void soaFreeList(soaList* list){
+    void_null_check(list);
+
+    for(alESize i = 0;i < list->fieldCount;i++){
+        if(list->columns[i] != NULL) alFreeArrayList(list->columns[i]);
+    }
+
+    free(list->columns);
+    free(list->fields);
+    free(list);
+}
+
+//Print diagnostic information for debugging and development
+void soaDiagnostics(soaList* list){
+    printf("Length: %ld\nRecord Size: %d\nFields: %d\n", soaGetListLength(list), (int) list->recordSize, (int) list->fieldCount);
+
+    for(alESize i = 0;i < list->fieldCount;i++){
+        printf("Field %d (offset %d, size %d):\n", (int) i, (int) list->fields[i].offset, (int) list->fields[i].size);
+        alDiagnostics(list->columns[i]);
+    }
+}
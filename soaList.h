@@ -0,0 +1,84 @@
+#ifndef SOALIST_H
+#define SOALIST_H
+
+#include "arrayList.h"
+
+//A field of a record, described by its byte offset within the record and its size in bytes (e.g., as given by offsetof and sizeof)
+typedef struct soaField {
+    alESize offset;
+    alESize size;
+} soaField;
+
+
+//Define the soaList type, a struct-of-arrays list of records
+//Each field of the record is stored in its own arrayList (a column), so a scan over one field only touches that field's memory. All columns always have the same length.
+typedef struct structOfArrays {
+    //Size, in bytes, of a whole record (as seen by callers that copy records in and out)
+    alESize recordSize;
+
+    //Number of fields (and columns)
+    alESize fieldCount;
+
+    //Array of <fieldCount> field descriptors
+    soaField* fields;
+
+    //Array of <fieldCount> columns, one arrayList per field, with element size equal to the field's size
+    arrayList** columns;
+} soaList;
+
+
+//Create a new soaList for records of <recordSize> bytes with the given fields. The field descriptors are copied.
+//Returns NULL if allocation failed or any field is empty or extends past the end of the record.
+soaList* soaNewList(alESize, soaField*, alESize);
+
+
+//Get the number of records in the list
+alLength soaGetListLength(soaList*);
+
+//Get a pointer to the head of a column, for direct (e.g., vectorized) scans over one field. Like alGetListHead, the pointer changes as the list grows, so it should not be stored. Returns NULL for an invalid field or list.
+void* soaGetColumn(soaList*, alESize);
+
+//Get a pointer to one field of one record. Returns NULL for invalid inputs (bad list, field or index out of bounds, etc.).
+void* soaGetField(soaList*, alIndex, alESize);
+
+
+//Copy a record out of the list into <record>, which must be <recordSize> bytes long. Bytes that are not part of any field are set to 0. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaGetElement(soaList*, alIndex, void*);
+
+//Overwrite a record in the list with the fields of <record>. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaSetElement(soaList*, alIndex, void*);
+
+
+//Insert a copy of a record at an arbitrary index, scattering its fields into the columns. All later records are shifted up. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaInsert(soaList*, alIndex, void*);
+
+//Add a copy of a record to the end of the list. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaAppend(soaList*, void*);
+
+//Add a copy of a record to the start of the list. Returns 0 for success, or 1 if the operation failed (in which case the list is unchanged).
+int soaPrepend(soaList*, void*);
+
+//Insert <count> contiguous records at index <index>. Returns 0 for success, or 1 if the operation failed, including cases where count < 1 (in which case the list is unchanged).
+int soaInsertMany(soaList*, alIndex, void*, alLength);
+
+//Insert <count> contiguous records at the end of the list. Returns 0 for success, or 1 if the operation failed, including cases where count < 1 (in which case the list is unchanged).
+int soaAppendMany(soaList*, void*, alLength);
+
+
+//Remove a record by index. Returns 0 for success, or 1 if the index is out of bounds or the list is bad.
+int soaRemove(soaList*, alIndex);
+
+//Remove the last record. Returns 0 for success, or 1 if the list has no records or the list is bad.
+int soaRemoveLast(soaList*);
+
+//Remove <count> records from index <index> to <index + count - 1>. Returns 0 for success, or 1 if the list has too few records or the list is bad.
+int soaRemoveMany(soaList*, alIndex, alLength);
+
+
+//Destroy and de-allocate a soaList
+void soaFreeList(soaList*);
+
+//Print diagnostic information for debugging and development
+void soaDiagnostics(soaList*);
+
+#endif
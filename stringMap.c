@@ -0,0 +1,401 @@
+#include "stringMap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(map, retVal) if(map==NULL || map->control==NULL) return retVal;
+    #define void_null_check(map) if(map==NULL || map->control==NULL) return;
+#else
+    #define null_check(map, retVal)
+    #define void_null_check(map)
+#endif
+
+//Returned by findEntry for a key that is not in the map
+#define ENTRY_NOT_FOUND ULONG_MAX
+
+//Removed key bytes are only compacted away once there are at least this many of them (and they make up over half of all key bytes)
+#define MAP_COMPACT_BYTES 4096
+
+//The 7-bit tag that a full slot's control byte holds for a hash
+#define hashTag(hash) ((unsigned char) ((hash) >> 57))
+
+//Source for the value stored when lstrMapPut is given a NULL value (large enough for any alESize)
+static const char zeroValue[USHRT_MAX + 1];
+
+
+//Get a bitmask of the slots in a group whose control byte equals <value>
+static unsigned int matchControl(const unsigned char* group, unsigned char value){
+    #ifdef __SSE2__
+    __m128i controls = _mm_loadu_si128((const __m128i*) group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char) value)));
+    #else
+    unsigned int mask = 0;
+    for(int i = 0; i < MAP_GROUP_SLOTS; i++) mask |= (unsigned int) (group[i] == value) << i;
+    return mask;
+    #endif
+}
+
+//Get a bitmask of the slots in a group that hold no entry (MAP_EMPTY or MAP_DELETED, the only control bytes with their high bit set)
+static unsigned int matchFree(const unsigned char* group){
+    #ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) group));
+    #else
+    unsigned int mask = 0;
+    for(int i = 0; i < MAP_GROUP_SLOTS; i++) mask |= (unsigned int) (group[i] >> 7) << i;
+    return mask;
+    #endif
+}
+
+//Find the slot holding a key. Returns the key's entry index (and stores its slot in <slotOut>), or ENTRY_NOT_FOUND.
+//Groups are probed in triangular order (group g, g + 1, g + 3, g + 6, ...), which visits every group when the number of groups is a power of two
+static alIndex findEntry(const lstrMap* map, unsigned long hash, const char* key, lstrLength len, unsigned long* slotOut){
+    unsigned long groupMask = map->slotCount / MAP_GROUP_SLOTS - 1;
+    unsigned long group = hash & groupMask;
+    unsigned char tag = hashTag(hash);
+
+    const lstrMapEntry* entries = (const lstrMapEntry*) map->entries->head;
+    const char* keys = map->keyBytes->head;
+    const char* values = (const char*) map->values->head;
+    alESize valueSize = map->values->size;
+
+    for(unsigned long step = 1;;step++){
+        const unsigned char* controls = map->control + group * MAP_GROUP_SLOTS;
+
+        unsigned int candidates = matchControl(controls, tag);
+        while(candidates != 0){
+            unsigned long slot = group * MAP_GROUP_SLOTS + __builtin_ctz(candidates);
+            alIndex index = map->slotEntries[slot];
+            const lstrMapEntry* entry = entries + index;
+
+            //Start loading the value while the key is compared, since a match is by far the most likely outcome
+            __builtin_prefetch(values + index * valueSize);
+
+            if(entry->hash == hash && entry->keyLength == len && memcmp(keys + entry->keyOffset, key, len) == 0){
+                *slotOut = slot;
+                return index;
+            }
+
+            candidates &= candidates - 1;
+        }
+
+        //A group with an empty slot ends every probe sequence that reaches it
+        if(matchControl(controls, MAP_EMPTY) != 0) return ENTRY_NOT_FOUND;
+
+        group = (group + step) & groupMask;
+    }
+}
+
+//Find the first slot without an entry in the probe sequence for a hash
+static unsigned long findFreeSlot(const unsigned char* control, unsigned long slotCount, unsigned long hash){
+    unsigned long groupMask = slotCount / MAP_GROUP_SLOTS - 1;
+    unsigned long group = hash & groupMask;
+
+    for(unsigned long step = 1;;step++){
+        unsigned int free = matchFree(control + group * MAP_GROUP_SLOTS);
+        if(free != 0) return group * MAP_GROUP_SLOTS + __builtin_ctz(free);
+
+        group = (group + step) & groupMask;
+    }
+}
+
+//Rebuild the slots at a new size (which also clears every MAP_DELETED slot). Returns 0 for success, or 1 if allocation failed, in which case the map is unchanged.
+static int rehash(lstrMap* map, unsigned long slotCount){
+    unsigned char* control = (unsigned char*) malloc(slotCount);
+    alIndex* slotEntries = (alIndex*) malloc(slotCount * sizeof(alIndex));
+
+    if(control == NULL || slotEntries == NULL){
+        free(control);
+        free(slotEntries);
+        return 1;
+    }
+
+    memset(control, MAP_EMPTY, slotCount);
+
+    //The dense entry list already holds every hash, so no key needs to be rehashed
+    const lstrMapEntry* entries = (const lstrMapEntry*) map->entries->head;
+    alLength count = map->entries->length;
+    for(alIndex i = 0; i < count; i++){
+        unsigned long slot = findFreeSlot(control, slotCount, entries[i].hash);
+        control[slot] = hashTag(entries[i].hash);
+        slotEntries[slot] = i;
+    }
+
+    free(map->control);
+    free(map->slotEntries);
+    map->control = control;
+    map->slotEntries = slotEntries;
+    map->slotCount = slotCount;
+    map->deleted = 0;
+
+    return 0;
+}
+
+//Copy the live keys into a new buffer, dropping the bytes of removed keys. Returns 0 for success, or 1 if allocation failed, in which case the map is unchanged.
+static int compactKeys(lstrMap* map){
+    lstrLength live = map->keyBytes->length - map->deadKeyBytes;
+    lString* keyBytes = lstrNewLenString(live + 1);
+    if(keyBytes == NULL) return 1;
+
+    lstrMapEntry* entries = (lstrMapEntry*) map->entries->head;
+    alLength count = map->entries->length;
+    for(alIndex i = 0; i < count; i++){
+        memcpy(keyBytes->head + keyBytes->length, map->keyBytes->head + entries[i].keyOffset, entries[i].keyLength);
+        entries[i].keyOffset = keyBytes->length;
+        keyBytes->length += entries[i].keyLength;
+    }
+
+    lstrFreeString(map->keyBytes);
+    map->keyBytes = keyBytes;
+    map->deadKeyBytes = 0;
+
+    return 0;
+}
+
+//Look up a key whose hash is already known. Returns a pointer to its value, or NULL if it is not in the map.
+static void* getHashed(lstrMap* map, unsigned long hash, const char* key, lstrLength len){
+    unsigned long slot;
+    alIndex index = findEntry(map, hash, key, len, &slot);
+    if(index == ENTRY_NOT_FOUND) return NULL;
+
+    return (char*) map->values->head + index * map->values->size;
+}
+
+//Store a value for a key whose hash is already known. Returns a pointer to the stored value, or NULL if the operation fails, in which case the map is unchanged.
+static void* putHashed(lstrMap* map, unsigned long hash, const char* key, lstrLength len, void* value){
+    alESize size = map->values->size;
+
+    unsigned long slot;
+    alIndex index = findEntry(map, hash, key, len, &slot);
+
+    if(index == ENTRY_NOT_FOUND){
+        //Keep at most 7/8 of the slots in use (including MAP_DELETED ones). If removals caused most of that, rebuilding at the same size is enough.
+        alLength count = map->entries->length;
+        if((count + map->deleted + 1) * 8 > map->slotCount * 7){
+            unsigned long slotCount = ((count + 1) * 16 > map->slotCount * 7) ? map->slotCount * 2 : map->slotCount;
+            if(rehash(map, slotCount)) return NULL;
+        }
+
+        //Copy the key, then add its entry and value, undoing each step if a later one fails
+        lstrMapEntry entry = {hash, map->keyBytes->length, len};
+        if(len > 0 && lstrAppendBytes(map->keyBytes, (char*) key, len) == NULL) return NULL;
+
+        if(alAppend(map->entries, &entry) == NULL){
+            if(len > 0) lstrRemoveLastString(map->keyBytes, len);
+            return NULL;
+        }
+
+        index = count;
+        if(alAppend(map->values, value == NULL ? (void*) zeroValue : value) == NULL){
+            alRemoveLast(map->entries);
+            if(len > 0) lstrRemoveLastString(map->keyBytes, len);
+            return NULL;
+        }
+
+        slot = findFreeSlot(map->control, map->slotCount, hash);
+        if(map->control[slot] == MAP_DELETED) map->deleted--;
+        map->control[slot] = hashTag(hash);
+        map->slotEntries[slot] = index;
+
+        return (char*) map->values->head + index * size;
+    }
+
+    void* stored = (char*) map->values->head + index * size;
+    if(value == NULL) memset(stored, 0, size);
+    else memmove(stored, value, size);
+
+    return stored;
+}
+
+//Remove a key whose hash is already known. Returns 0 for success, or 1 if the key is not in the map.
+static int removeHashed(lstrMap* map, unsigned long hash, const char* key, lstrLength len){
+    unsigned long slot;
+    alIndex index = findEntry(map, hash, key, len, &slot);
+    if(index == ENTRY_NOT_FOUND) return 1;
+
+    //A slot can go back to MAP_EMPTY if its group still has an empty slot, since no probe sequence can then have passed through the group
+    const unsigned char* group = map->control + (slot / MAP_GROUP_SLOTS) * MAP_GROUP_SLOTS;
+    if(matchControl(group, MAP_EMPTY) != 0) map->control[slot] = MAP_EMPTY;
+    else {
+        map->control[slot] = MAP_DELETED;
+        map->deleted++;
+    }
+
+    lstrMapEntry* entries = (lstrMapEntry*) map->entries->head;
+    map->deadKeyBytes += entries[index].keyLength;
+
+    //Move the last entry into the gap, and point its slot at its new index
+    alIndex last = map->entries->length - 1;
+    if(index != last){
+        unsigned long lastSlot;
+        findEntry(map, entries[last].hash, map->keyBytes->head + entries[last].keyOffset, entries[last].keyLength, &lastSlot);
+        map->slotEntries[lastSlot] = index;
+
+        entries[index] = entries[last];
+        alESize size = map->values->size;
+        memcpy((char*) map->values->head + index * size, (char*) map->values->head + last * size, size);
+    }
+
+    alRemoveLast(map->entries);
+    alRemoveLast(map->values);
+
+    //Drop the bytes of removed keys once they make up most of the key storage. Failing to do so only wastes space.
+    if(map->deadKeyBytes >= MAP_COMPACT_BYTES && map->deadKeyBytes * 2 > map->keyBytes->length) compactKeys(map);
+
+    return 0;
+}
+
+
+//Create a new, empty map whose values are <valueSize> bytes each. Returns NULL if allocation failed or the value size is 0.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMap.
+lstrMap* lstrNewMap(alESize valueSize){
+    if(valueSize < 1) return NULL;
+
+    lstrMap* map = (lstrMap*) malloc(sizeof(lstrMap));
+    if(map == NULL) return NULL;
+
+    map->control = (unsigned char*) malloc(MAP_INITIAL_SLOTS);
+    map->slotEntries = (alIndex*) malloc(MAP_INITIAL_SLOTS * sizeof(alIndex));
+    map->entries = alNewArrayList(sizeof(lstrMapEntry));
+    map->values = alNewArrayList(valueSize);
+    map->keyBytes = lstrNewLenString(DEFAULT_INITIAL_STRING_LENGTH);
+
+    if(map->control == NULL || map->slotEntries == NULL || map->entries == NULL || map->values == NULL || map->keyBytes == NULL){
+        free(map->control);
+        free(map->slotEntries);
+        if(map->entries != NULL) alFreeArrayList(map->entries);
+        if(map->values != NULL) alFreeArrayList(map->values);
+        if(map->keyBytes != NULL) lstrFreeString(map->keyBytes);
+        free(map);
+        return NULL;
+    }
+
+    memset(map->control, MAP_EMPTY, MAP_INITIAL_SLOTS);
+    map->slotCount = MAP_INITIAL_SLOTS;
+    map->deleted = 0;
+    map->deadKeyBytes = 0;
+
+    return map;
+}
+
+//Look up the value stored for a key. The key's cached hash (see lstrHash) is used, so repeated lookups with the same lString do not rehash it. Returns a pointer to the value, or NULL if the key is not in the map or the operation fails.
+//The pointer is only valid until the map is next modified.
+void* lstrMapGet(lstrMap* map, lString* key){
+    null_check(map, NULL);
+
+    #ifndef NO_SAFETY
+    if(key == NULL || key->head == NULL) return NULL;
+    #endif
+
+    return getHashed(map, lstrHash(key), key->head, key->length);
+}
+
+//Look up the value stored for the bytes in a view. Returns a pointer to the value, or NULL if the key is not in the map or the operation fails.
+//The pointer is only valid until the map is next modified.
+void* lstrMapGetView(lstrMap* map, lstrView key){
+    null_check(map, NULL);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(key)) return NULL;
+    #endif
+
+    return getHashed(map, lstrHashView(key), key.data, key.length);
+}
+
+//Store a copy of a value for a key, replacing any value already stored for it. The key's bytes are copied. A NULL value stores a value of all zero bytes. Returns a pointer to the stored value, or NULL if the operation fails, in which case the map is unchanged.
+//The pointer is only valid until the map is next modified.
+void* lstrMapPut(lstrMap* map, lString* key, void* value){
+    null_check(map, NULL);
+
+    #ifndef NO_SAFETY
+    if(key == NULL || key->head == NULL) return NULL;
+    #endif
+
+    return putHashed(map, lstrHash(key), key->head, key->length, value);
+}
+
+//Store a copy of a value for the bytes in a view, replacing any value already stored for them. A NULL value stores a value of all zero bytes. Returns a pointer to the stored value, or NULL if the operation fails, in which case the map is unchanged.
+//The pointer is only valid until the map is next modified.
+void* lstrMapPutView(lstrMap* map, lstrView key, void* value){
+    null_check(map, NULL);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(key)) return NULL;
+    #endif
+
+    return putHashed(map, lstrHashView(key), key.data, key.length, value);
+}
+
+//Remove a key and its value from the map. The last entry (by index) takes the removed entry's index. Returns 0 for success, or 1 if the key is not in the map or the operation fails.
+int lstrMapRemove(lstrMap* map, lString* key){
+    null_check(map, 1);
+
+    #ifndef NO_SAFETY
+    if(key == NULL || key->head == NULL) return 1;
+    #endif
+
+    return removeHashed(map, lstrHash(key), key->head, key->length);
+}
+
+//Remove the bytes in a view, as a key, and their value from the map. Returns 0 for success, or 1 if the key is not in the map or the operation fails.
+int lstrMapRemoveView(lstrMap* map, lstrView key){
+    null_check(map, 1);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(key)) return 1;
+    #endif
+
+    return removeHashed(map, lstrHashView(key), key.data, key.length);
+}
+
+
+//Get the number of entries in the map. Returns 0 for an invalid map.
+alLength lstrMapLength(lstrMap* map){
+    null_check(map, 0);
+    return map->entries->length;
+}
+
+//Get a view of the key of an entry by index. The view is only valid until the map is next modified. Returns the null view if the index is out of bounds or the map is invalid.
+lstrView lstrMapKeyAt(lstrMap* map, alIndex index){
+    null_check(map, lstrViewOfBytes(NULL, 0));
+
+    if(index >= map->entries->length) return lstrViewOfBytes(NULL, 0);
+
+    const lstrMapEntry* entry = (const lstrMapEntry*) map->entries->head + index;
+    lstrSpan span = {entry->keyOffset, entry->keyLength};
+    return lstrSpanView(map->keyBytes, span);
+}
+
+//Get a pointer to the value of an entry by index. The pointer is only valid until the map is next modified. Returns NULL if the index is out of bounds or the map is invalid.
+void* lstrMapValueAt(lstrMap* map, alIndex index){
+    null_check(map, NULL);
+
+    if(index >= map->values->length) return NULL;
+
+    return (char*) map->values->head + index * map->values->size;
+}
+
+
+//Destroy and de-allocate a map, including its copies of keys and values
+void lstrFreeMap(lstrMap* map){
+    void_null_check(map);
+
+    free(map->control);
+    free(map->slotEntries);
+    alFreeArrayList(map->entries);
+    alFreeArrayList(map->values);
+    lstrFreeString(map->keyBytes);
+    free(map);
+}
+
+//Print diagnostic information for debugging and development
+void lstrMapDiagnostics(lstrMap* map){
+    printf("Entries: %ld\nSlots: %ld\nDeleted slots: %ld\nKey bytes: %ld (%ld removed)\n",
+        lstrMapLength(map), map->slotCount, map->deleted, map->keyBytes->length, map->deadKeyBytes
+        );
+}
@@ -0,0 +1,87 @@
+#ifndef STRINGMAP_H
+#define STRINGMAP_H
+
+#include "listString.h"
+
+#define MAP_GROUP_SLOTS 16 //The number of slots whose control bytes are checked together by one vector compare
+#define MAP_INITIAL_SLOTS 16 //The initial number of slots in a map (always a power of two, and a multiple of MAP_GROUP_SLOTS)
+
+//Control byte values for slots that hold no entry. Full slots hold the top 7 bits of their entry's hash, so their control bytes are always below 128.
+#define MAP_EMPTY 0x80
+#define MAP_DELETED 0xFE
+
+
+//Metadata for one entry of a map: the key's full hash, and where its bytes are stored
+typedef struct lstrMapEntry {
+    unsigned long hash;
+    lstrIndex keyOffset;
+    lstrLength keyLength;
+} lstrMapEntry;
+
+
+//Define the lstrMap type, a hash map from strings (lStrings or views) to fixed-size values
+//Slots are probed in groups of MAP_GROUP_SLOTS: one SSE2 compare of the group's control bytes against 7 bits of the key's hash finds every candidate in the group at once, so most lookups compare a single key
+//Entries, keys and values are stored densely, like an arrayList, so they can be iterated by index from 0 to lstrMapLength - 1. Removing an entry moves the last entry into its place.
+typedef struct stringMap {
+    //Control byte for each slot (MAP_EMPTY, MAP_DELETED, or the top 7 bits of the hash of the slot's entry), and the index of each full slot's entry
+    unsigned char* control;
+    alIndex* slotEntries;
+
+    //Number of slots, and the number of them marked MAP_DELETED
+    unsigned long slotCount;
+    unsigned long deleted;
+
+    //arrayList of lstrMapEntry, and arrayList of values, both indexed by entry
+    arrayList* entries;
+    arrayList* values;
+
+    //All key bytes, stored back to back, and how many of them belong to removed entries
+    lString* keyBytes;
+    lstrLength deadKeyBytes;
+} lstrMap;
+
+
+//Create a new, empty map whose values are <valueSize> bytes each. Returns NULL if allocation failed or the value size is 0.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMap.
+lstrMap* lstrNewMap(alESize);
+
+//Look up the value stored for a key. The key's cached hash (see lstrHash) is used, so repeated lookups with the same lString do not rehash it. Returns a pointer to the value, or NULL if the key is not in the map or the operation fails.
+//The pointer is only valid until the map is next modified.
+void* lstrMapGet(lstrMap*, lString*);
+
+//Look up the value stored for the bytes in a view. Returns a pointer to the value, or NULL if the key is not in the map or the operation fails.
+//The pointer is only valid until the map is next modified.
+void* lstrMapGetView(lstrMap*, lstrView);
+
+//Store a copy of a value for a key, replacing any value already stored for it. The key's bytes are copied. A NULL value stores a value of all zero bytes. Returns a pointer to the stored value, or NULL if the operation fails, in which case the map is unchanged.
+//The pointer is only valid until the map is next modified.
+void* lstrMapPut(lstrMap*, lString*, void*);
+
+//Store a copy of a value for the bytes in a view, replacing any value already stored for them. A NULL value stores a value of all zero bytes. Returns a pointer to the stored value, or NULL if the operation fails, in which case the map is unchanged.
+//The pointer is only valid until the map is next modified.
+void* lstrMapPutView(lstrMap*, lstrView, void*);
+
+//Remove a key and its value from the map. The last entry (by index) takes the removed entry's index. Returns 0 for success, or 1 if the key is not in the map or the operation fails.
+int lstrMapRemove(lstrMap*, lString*);
+
+//Remove the bytes in a view, as a key, and their value from the map. Returns 0 for success, or 1 if the key is not in the map or the operation fails.
+int lstrMapRemoveView(lstrMap*, lstrView);
+
+
+//Get the number of entries in the map. Returns 0 for an invalid map.
+alLength lstrMapLength(lstrMap*);
+
+//Get a view of the key of an entry by index. The view is only valid until the map is next modified. Returns the null view if the index is out of bounds or the map is invalid.
+lstrView lstrMapKeyAt(lstrMap*, alIndex);
+
+//Get a pointer to the value of an entry by index. The pointer is only valid until the map is next modified. Returns NULL if the index is out of bounds or the map is invalid.
+void* lstrMapValueAt(lstrMap*, alIndex);
+
+
+//Destroy and de-allocate a map, including its copies of keys and values
+void lstrFreeMap(lstrMap*);
+
+//Print diagnostic information for debugging and development
+void lstrMapDiagnostics(lstrMap*);
+
+#endif
@@ -0,0 +1,870 @@
+#include "stringMatcher.h"
+#include "stringMap.h"
+#include <stdlib.h>
+#include <string.h>
+
+//If the file is compiled with `-D NO_SAFETY`, all initial safety checks on function arguments will be ignored. This saves time but may allow otherwise impossible and hard-to-debug segfaults and similar issues.
+#ifndef NO_SAFETY
+    #define null_check(matcher, retVal) if(matcher==NULL || matcher->anchored.delta==NULL) return retVal;
+#else
+    #define null_check(matcher, retVal)
+#endif
+
+//Returned by the match loops when there is no match
+#define MATCH_NOT_FOUND ULONG_MAX
+
+//The deepest nesting of parentheses a regular expression may use
+#define MATCHER_MAX_DEPTH 256
+
+//Kinds of NFA node. A set node consumes one byte from its set; every other kind moves without consuming input.
+#define NODE_SET 0
+#define NODE_SPLIT 1 //Continues at both <out> and <out1>
+#define NODE_EMPTY 2
+#define NODE_BEGIN 3 //Continues only at the start of the input
+#define NODE_END 4 //Continues only at the end of the input
+#define NODE_MATCH 5
+
+//Flags in the first word of a DFA state's key. The rest of the key is the state's groups in order, each one a count followed by that many sorted set nodes.
+#define STATE_ACCEPTS 1 //The state accepts at its current position
+#define STATE_ACCEPTS_AT_END 2 //The state accepts if the input ends here
+#define STATE_COMMITTED 4 //A leftmost automaton has accepted, so it starts no new attempts
+
+//Check whether a byte set contains a byte
+#define setHas(set, b) (((set)->bits[(b) >> 3] >> ((b) & 7)) & 1)
+
+
+//A node of the NFA that a pattern is first parsed into
+typedef struct nfaNode {
+    unsigned int kind;
+    unsigned int out;
+    unsigned int out1;
+    unsigned int set;
+} nfaNode;
+
+//A set of byte values, one bit per value
+typedef struct byteSet {
+    unsigned char bits[32];
+} byteSet;
+
+//A piece of the NFA with one entry node and one exit node. The exit is always an empty node whose <out> is linked to whatever follows the piece.
+typedef struct nfaFragment {
+    unsigned int start;
+    unsigned int end;
+} nfaFragment;
+
+//State of a pattern being parsed into an NFA
+typedef struct patternParser {
+    const unsigned char* pos;
+    arrayList* nodes;
+    arrayList* sets;
+    int depth;
+    int failed;
+} patternParser;
+
+//Scratch space for subset construction, shared by the automata that run over the same NFA
+typedef struct dfaBuilder {
+    const nfaNode* nodes;
+    const byteSet* sets;
+    unsigned int startNode;
+
+    //Stack of (node * 2 + reached through '$') items, and the generation (transition) in which each item was last pushed
+    unsigned int* stack;
+    unsigned int* seen;
+    unsigned int generation;
+
+    //A state's key, the key of the state being expanded, and the seeds of a group
+    unsigned int* key;
+    unsigned int* current;
+    unsigned int* seeds;
+} dfaBuilder;
+
+
+//NFA construction. Nodes are appended to an arrayList, so pieces refer to each other by index. Once anything fails, every later call does nothing.
+
+//Add a node. Returns its index (which is meaningless if the parser has failed).
+static unsigned int addNode(patternParser* parser, unsigned int kind, unsigned int out, unsigned int out1, unsigned int set){
+    nfaNode node = {kind, out, out1, set};
+    if(!parser->failed && alAppend(parser->nodes, &node) == NULL) parser->failed = 1;
+    return parser->failed ? 0 : alGetListLength(parser->nodes) - 1;
+}
+
+//Point a fragment's exit at the node that follows it
+static void linkNode(patternParser* parser, unsigned int from, unsigned int to){
+    if(!parser->failed) ((nfaNode*) alGetListHead(parser->nodes))[from].out = to;
+}
+
+//A fragment that matches one byte from a set
+static nfaFragment setFragment(patternParser* parser, const byteSet* set){
+    nfaFragment fragment = {0, 0};
+    if(!parser->failed && alAppend(parser->sets, (void*) set) == NULL) parser->failed = 1;
+    if(parser->failed) return fragment;
+
+    fragment.end = addNode(parser, NODE_EMPTY, 0, 0, 0);
+    fragment.start = addNode(parser, NODE_SET, fragment.end, 0, alGetListLength(parser->sets) - 1);
+    return fragment;
+}
+
+//A fragment that matches one particular byte
+static nfaFragment byteFragment(patternParser* parser, unsigned char c){
+    byteSet set;
+    memset(&set, 0, sizeof(set));
+    set.bits[c >> 3] |= 1 << (c & 7);
+    return setFragment(parser, &set);
+}
+
+//A fragment that consumes nothing: an empty node, or an anchor (NODE_BEGIN or NODE_END)
+static nfaFragment emptyFragment(patternParser* parser, unsigned int kind){
+    nfaFragment fragment;
+    fragment.end = addNode(parser, NODE_EMPTY, 0, 0, 0);
+    fragment.start = kind == NODE_EMPTY ? fragment.end : addNode(parser, kind, fragment.end, 0, 0);
+    return fragment;
+}
+
+//A fragment that matches <a> followed by <b>
+static nfaFragment concatenate(patternParser* parser, nfaFragment a, nfaFragment b){
+    linkNode(parser, a.end, b.start);
+    nfaFragment fragment = {a.start, b.end};
+    return fragment;
+}
+
+//A fragment that matches either <a> or <b>
+static nfaFragment alternate(patternParser* parser, nfaFragment a, nfaFragment b){
+    nfaFragment fragment;
+    fragment.end = addNode(parser, NODE_EMPTY, 0, 0, 0);
+    fragment.start = addNode(parser, NODE_SPLIT, a.start, b.start, 0);
+    linkNode(parser, a.end, fragment.end);
+    linkNode(parser, b.end, fragment.end);
+    return fragment;
+}
+
+//A fragment that matches <a> repeated as '*' (any number of times), '+' (at least once) or '?' (at most once) says
+static nfaFragment repeat(patternParser* parser, nfaFragment a, unsigned char op){
+    unsigned int end = addNode(parser, NODE_EMPTY, 0, 0, 0);
+    unsigned int split = addNode(parser, NODE_SPLIT, a.start, end, 0);
+
+    linkNode(parser, a.end, op == '?' ? end : split);
+
+    nfaFragment fragment = {op == '+' ? a.start : split, end};
+    return fragment;
+}
+
+
+//Parsing. Sets are shared by both syntaxes, which differ only in how a set is negated and in which escapes they accept.
+
+//Fill a set with the bytes an escape such as \d stands for. Returns 0 for success, or 1 if the byte does not name a class.
+static int classEscape(unsigned char c, byteSet* set){
+    memset(set, 0, sizeof(*set));
+
+    unsigned char lower = c | 0x20;
+    for(int b = 0;b < 256;b++){
+        int in;
+        if(lower == 'd') in = (b >= '0' && b <= '9');
+        else if(lower == 'w') in = (b >= '0' && b <= '9') || ((b | 0x20) >= 'a' && (b | 0x20) <= 'z') || b == '_';
+        else if(lower == 's') in = (b == ' ' || (b >= '\t' && b <= '\r'));
+        else return 1;
+
+        //Uppercase escapes (\D, \W, \S) are the complements
+        if(in != (c != lower)) set->bits[b >> 3] |= 1 << (b & 7);
+    }
+
+    return 0;
+}
+
+//Get the byte that an escaped byte stands for
+static unsigned char escapedByte(unsigned char c){
+    if(c == 'n') return '\n';
+    if(c == 't') return '\t';
+    if(c == 'r') return '\r';
+    return c;
+}
+
+//Parse a set, just after its '['. Returns 0 for success, or 1 if the set is not terminated.
+static int parseSet(patternParser* parser, byteSet* set, int glob){
+    memset(set, 0, sizeof(*set));
+
+    int negate = 0;
+    if(*parser->pos == '^' || (glob && *parser->pos == '!')){
+        negate = 1;
+        parser->pos++;
+    }
+
+    //A ']' straight after the opening bracket is a member, not the end of the set
+    for(int first = 1;;first = 0){
+        unsigned char c = *parser->pos;
+        if(c == '\0') return 1;
+
+        parser->pos++;
+        if(c == ']' && !first) break;
+
+        unsigned int low = c;
+        if(c == '\\'){
+            c = *parser->pos;
+            if(c == '\0') return 1;
+            parser->pos++;
+
+            //Class escapes add a whole class, and cannot start a range
+            byteSet class;
+            if(!glob && classEscape(c, &class) == 0){
+                for(int i = 0;i < 32;i++) set->bits[i] |= class.bits[i];
+                continue;
+            }
+
+            low = glob ? c : escapedByte(c);
+        }
+
+        unsigned int high = low;
+        if(parser->pos[0] == '-' && parser->pos[1] != ']' && parser->pos[1] != '\0'){
+            parser->pos++;
+            high = *parser->pos++;
+
+            if(high == '\\'){
+                if(*parser->pos == '\0') return 1;
+                high = glob ? *parser->pos : escapedByte(*parser->pos);
+                parser->pos++;
+            }
+
+            if(high < low) return 1;
+        }
+
+        for(unsigned int b = low;b <= high;b++) set->bits[b >> 3] |= 1 << (b & 7);
+    }
+
+    if(negate){
+        for(int i = 0;i < 32;i++) set->bits[i] = ~set->bits[i];
+    }
+
+    return 0;
+}
+
+//Parse a whole glob pattern
+static nfaFragment parseGlob(patternParser* parser){
+    byteSet any;
+    memset(&any, 0xFF, sizeof(any));
+
+    nfaFragment fragment = emptyFragment(parser, NODE_EMPTY);
+
+    while(*parser->pos != '\0' && !parser->failed){
+        unsigned char c = *parser->pos++;
+        nfaFragment piece;
+
+        if(c == '*') piece = repeat(parser, setFragment(parser, &any), '*');
+        else if(c == '?') piece = setFragment(parser, &any);
+        else if(c == '['){
+            byteSet set;
+            if(parseSet(parser, &set, 1)){
+                parser->failed = 1;
+                break;
+            }
+            piece = setFragment(parser, &set);
+        }
+        else if(c == '\\'){
+            if(*parser->pos == '\0'){
+                parser->failed = 1;
+                break;
+            }
+            piece = byteFragment(parser, *parser->pos++);
+        }
+        else piece = byteFragment(parser, c);
+
+        fragment = concatenate(parser, fragment, piece);
+    }
+
+    return fragment;
+}
+
+static nfaFragment parseAlternation(patternParser* parser);
+
+//Parse one regular expression atom: a byte, a set, an escape, an anchor, or a parenthesized group
+static nfaFragment parseAtom(patternParser* parser){
+    unsigned char c = *parser->pos++;
+    byteSet set;
+
+    switch(c){
+        case '(': {
+            if(++parser->depth > MATCHER_MAX_DEPTH){
+                parser->failed = 1;
+                return emptyFragment(parser, NODE_EMPTY);
+            }
+
+            nfaFragment group = parseAlternation(parser);
+            if(*parser->pos != ')') parser->failed = 1;
+            else parser->pos++;
+
+            parser->depth--;
+            return group;
+        }
+
+        case '.':
+            memset(&set, 0xFF, sizeof(set));
+            return setFragment(parser, &set);
+
+        case '[':
+            if(parseSet(parser, &set, 0)) parser->failed = 1;
+            return setFragment(parser, &set);
+
+        case '^':
+            return emptyFragment(parser, NODE_BEGIN);
+
+        case '$':
+            return emptyFragment(parser, NODE_END);
+
+        case '\\':
+            c = *parser->pos;
+            if(c == '\0'){
+                parser->failed = 1;
+                return emptyFragment(parser, NODE_EMPTY);
+            }
+            parser->pos++;
+
+            if(classEscape(c, &set) == 0) return setFragment(parser, &set);
+            return byteFragment(parser, escapedByte(c));
+
+        //A repetition with nothing before it
+        case '*':
+        case '+':
+        case '?':
+            parser->failed = 1;
+            return emptyFragment(parser, NODE_EMPTY);
+
+        default:
+            return byteFragment(parser, c);
+    }
+}
+
+//Parse a sequence of atoms, each followed by any number of repetition operators, up to the next '|' or ')'
+static nfaFragment parseSequence(patternParser* parser){
+    nfaFragment fragment = emptyFragment(parser, NODE_EMPTY);
+
+    while(*parser->pos != '\0' && *parser->pos != '|' && *parser->pos != ')' && !parser->failed){
+        nfaFragment atom = parseAtom(parser);
+
+        while(*parser->pos == '*' || *parser->pos == '+' || *parser->pos == '?') atom = repeat(parser, atom, *parser->pos++);
+
+        fragment = concatenate(parser, fragment, atom);
+    }
+
+    return fragment;
+}
+
+//Parse sequences separated by '|'
+static nfaFragment parseAlternation(patternParser* parser){
+    nfaFragment fragment = parseSequence(parser);
+
+    while(*parser->pos == '|' && !parser->failed){
+        parser->pos++;
+        fragment = alternate(parser, fragment, parseSequence(parser));
+    }
+
+    return fragment;
+}
+
+
+//Subset construction
+
+//Order unsigned ints, for sorting the nodes of a state
+static int compareNodes(const void* a, const void* b){
+    unsigned int x = *(const unsigned int*) a, y = *(const unsigned int*) b;
+    return (x > y) - (x < y);
+}
+
+//Push an item onto the closure stack, unless it has already been pushed in this transition
+#define pushItem(builder, item) if((builder)->seen[item] != (builder)->generation){ (builder)->seen[item] = (builder)->generation; (builder)->stack[top++] = (item); }
+
+//Follow every move that consumes no input from <seeds>, store the set nodes reached in order in <nodes>, and add the group's flags to <flags>. Returns the number of nodes stored.
+//Items already reached in this generation (by an earlier group of the same state) are skipped, so each node belongs to the earliest group that reaches it.
+//Moves through a '$' anchor can only lead to a match at the end of the input, so they are followed separately and only contribute STATE_ACCEPTS_AT_END.
+static unsigned int closure(dfaBuilder* builder, unsigned int seedCount, int atBeginning, unsigned int* nodes, unsigned int* flags){
+    unsigned int top = 0, count = 0;
+
+    for(unsigned int i = 0;i < seedCount;i++){
+        pushItem(builder, builder->seeds[i] * 2);
+    }
+
+    while(top > 0){
+        unsigned int item = builder->stack[--top];
+        unsigned int atEnd = item & 1;
+        const nfaNode* node = builder->nodes + (item >> 1);
+
+        switch(node->kind){
+            case NODE_SET:
+                if(!atEnd) nodes[count++] = item >> 1;
+                break;
+
+            case NODE_MATCH:
+                *flags |= atEnd ? STATE_ACCEPTS_AT_END : STATE_ACCEPTS | STATE_ACCEPTS_AT_END;
+                break;
+
+            case NODE_SPLIT:
+                pushItem(builder, node->out1 * 2 + atEnd);
+                pushItem(builder, node->out * 2 + atEnd);
+                break;
+
+            case NODE_EMPTY:
+                pushItem(builder, node->out * 2 + atEnd);
+                break;
+
+            case NODE_BEGIN:
+                if(atBeginning) pushItem(builder, node->out * 2 + atEnd);
+                break;
+
+            case NODE_END:
+                pushItem(builder, node->out * 2 + 1);
+                break;
+        }
+    }
+
+    qsort(nodes, count, sizeof(unsigned int), compareNodes);
+
+    return count;
+}
+
+//Append a group to the key being built in builder->key, from its seeds. Returns the new number of words in the key.
+static unsigned int addGroup(dfaBuilder* builder, unsigned int keyWords, unsigned int seedCount, int atBeginning, unsigned int* flags){
+    unsigned int count = closure(builder, seedCount, atBeginning, builder->key + keyWords + 1, flags);
+    if(count == 0) return keyWords;
+
+    builder->key[keyWords] = count;
+    return keyWords + count + 1;
+}
+
+//Finish a key: a state with no groups left can never accept again, so unless it accepts here it is the dead state. Returns the number of words in the key.
+static unsigned int finishKey(dfaBuilder* builder, unsigned int keyWords, unsigned int flags){
+    if(keyWords == 1 && !(flags & STATE_ACCEPTS_AT_END)) flags = 0;
+    builder->key[0] = flags;
+    return keyWords;
+}
+
+//Store the key of the state reached from the state <current> on byte <b> in builder->key. Returns the number of words in the key.
+//In a leftmost automaton, the state's groups are kept in the order their attempts started. Once a group accepts, the groups that started later can no longer give the leftmost match, so they are dropped and no new attempts start.
+static unsigned int stepState(dfaBuilder* builder, const unsigned int* current, unsigned int currentWords, unsigned int b, int leftmost){
+    unsigned int keyWords = 1, flags = current[0] & STATE_COMMITTED;
+    builder->generation++;
+
+    for(unsigned int i = 1;i < currentWords && !(flags & STATE_ACCEPTS);i += current[i] + 1){
+        unsigned int seedCount = 0;
+
+        for(unsigned int j = 1;j <= current[i];j++){
+            const nfaNode* node = builder->nodes + current[i + j];
+            if(setHas(builder->sets + node->set, b)) builder->seeds[seedCount++] = node->out;
+        }
+
+        keyWords = addGroup(builder, keyWords, seedCount, 0, &flags);
+    }
+
+    if(leftmost && !(flags & (STATE_COMMITTED | STATE_ACCEPTS))){
+        builder->seeds[0] = builder->startNode;
+        keyWords = addGroup(builder, keyWords, 1, 0, &flags);
+    }
+
+    if(leftmost && (flags & STATE_ACCEPTS)) flags |= STATE_COMMITTED;
+
+    return finishKey(builder, keyWords, flags);
+}
+
+//Store the key of a start state in builder->key. Returns the number of words in the key.
+static unsigned int startState(dfaBuilder* builder, int atBeginning, int leftmost){
+    unsigned int flags = 0;
+    builder->generation++;
+    builder->seeds[0] = builder->startNode;
+
+    unsigned int keyWords = addGroup(builder, 1, 1, atBeginning, &flags);
+    if(leftmost && (flags & STATE_ACCEPTS)) flags |= STATE_COMMITTED;
+
+    return finishKey(builder, keyWords, flags);
+}
+
+//Find the state with the key in builder->key, adding it if it is new. Returns the state, or UINT_MAX if there are too many states or allocation failed.
+static unsigned int findState(dfaBuilder* builder, unsigned int keyWords, lstrMap* states, arrayList* delta, arrayList* flags, unsigned int classCount){
+    lstrView key = lstrViewOfBytes((char*) builder->key, keyWords * sizeof(unsigned int));
+
+    unsigned int* known = (unsigned int*) lstrMapGetView(states, key);
+    if(known != NULL) return *known;
+
+    unsigned int state = lstrMapLength(states);
+    if(state >= MATCHER_MAX_STATES) return UINT_MAX;
+
+    //Every new state gets a row of transitions to the dead state, which are filled in when the state is expanded
+    unsigned char stateFlags = builder->key[0];
+    if(lstrMapPutView(states, key, &state) == NULL || alAppend(flags, &stateFlags) == NULL) return UINT_MAX;
+    for(unsigned int c = 0;c < classCount;c++){
+        unsigned int dead = 0;
+        if(alAppend(delta, &dead) == NULL) return UINT_MAX;
+    }
+
+    return state;
+}
+
+//Build one automaton by subset construction. A leftmost automaton starts a new attempt at every position until one accepts (see stepState). Returns 0 for success, or 1 if the automaton has too many states or allocation failed.
+static int buildDfa(dfaBuilder* builder, const lstrMatcher* matcher, const unsigned char* representative, int leftmost, lstrMatcherDfa* dfa){
+    unsigned int classCount = matcher->classCount;
+
+    //Keys are looked up in a map, whose entries are numbered in the order they were added, which is also the order of the states
+    lstrMap* states = lstrNewMap(sizeof(unsigned int));
+    arrayList* delta = alNewArrayList(sizeof(unsigned int));
+    arrayList* flags = alNewArrayList(1);
+    int failed = (states == NULL || delta == NULL || flags == NULL);
+
+    //State 0, with no groups and no flags, is the dead state
+    unsigned int startAtBeginning = 0, start = 0;
+    if(!failed){
+        builder->key[0] = 0;
+        failed = findState(builder, 1, states, delta, flags, classCount) != 0;
+    }
+
+    if(!failed){
+        startAtBeginning = findState(builder, startState(builder, 1, leftmost), states, delta, flags, classCount);
+        start = findState(builder, startState(builder, 0, leftmost), states, delta, flags, classCount);
+        failed = (startAtBeginning == UINT_MAX || start == UINT_MAX);
+    }
+
+    //Expand each state in turn. States added along the way are expanded once the loop reaches them.
+    for(unsigned int state = 1;!failed && state < lstrMapLength(states);state++){
+        lstrView key = lstrMapKeyAt(states, state);
+        unsigned int currentWords = key.length / sizeof(unsigned int);
+        memcpy(builder->current, key.data, key.length);
+
+        for(unsigned int c = 0;c < classCount && !failed;c++){
+            unsigned int keyWords = stepState(builder, builder->current, currentWords, representative[c], leftmost);
+            unsigned int target = findState(builder, keyWords, states, delta, flags, classCount);
+            if(target == UINT_MAX) failed = 1;
+            else ((unsigned int*) alGetListHead(delta))[state * classCount + c] = target;
+        }
+    }
+
+    if(!failed){
+        //Turn each target state into its row, marked if the state accepts
+        unsigned int stateCount = lstrMapLength(states);
+        const unsigned char* stateFlags = (const unsigned char*) alGetListHead(flags);
+
+        dfa->delta = (unsigned int*) malloc(stateCount * classCount * sizeof(unsigned int));
+        dfa->acceptAtEnd = (unsigned char*) malloc(stateCount);
+
+        if(dfa->delta == NULL || dfa->acceptAtEnd == NULL) failed = 1;
+        else {
+            const unsigned int* targets = (const unsigned int*) alGetListHead(delta);
+            for(unsigned long i = 0;i < (unsigned long) stateCount * classCount;i++){
+                unsigned int target = targets[i];
+                dfa->delta[i] = target * classCount | ((stateFlags[target] & STATE_ACCEPTS) ? MATCHER_ACCEPT : 0);
+            }
+
+            for(unsigned int s = 0;s < stateCount;s++) dfa->acceptAtEnd[s] = (stateFlags[s] & STATE_ACCEPTS_AT_END) != 0;
+
+            dfa->startAtBeginning = startAtBeginning * classCount | ((stateFlags[startAtBeginning] & STATE_ACCEPTS) ? MATCHER_ACCEPT : 0);
+            dfa->start = start * classCount | ((stateFlags[start] & STATE_ACCEPTS) ? MATCHER_ACCEPT : 0);
+            dfa->stateCount = stateCount;
+        }
+    }
+
+    if(states != NULL) lstrFreeMap(states);
+    if(delta != NULL) alFreeArrayList(delta);
+    if(flags != NULL) alFreeArrayList(flags);
+
+    return failed;
+}
+
+//Make <from> also move to <to>, by copying <from> to a new node and turning <from> into a split between the copy and <to>. Returns 0 for success, or 1 if allocation failed.
+static int addMove(arrayList* nodes, unsigned int from, unsigned int to){
+    nfaNode previous = ((const nfaNode*) alGetListHead(nodes))[from];
+    if(alAppend(nodes, &previous) == NULL) return 1;
+
+    nfaNode split = {NODE_SPLIT, to, alGetListLength(nodes) - 1, 0};
+    ((nfaNode*) alGetListHead(nodes))[from] = split;
+    return 0;
+}
+
+//Build the NFA of the reversed pattern, which matches exactly the reversals of what the pattern matches, in <reversed>. Node i of the reversed NFA stands for reaching node i of the pattern, and moves to each node that leads to it,
+//through a copy of that node's own move with '^' and '$' swapped. The reversed NFA starts at the pattern's match node, and its match node follows the pattern's start. Returns 0 for success, or 1 if allocation failed.
+static int reverseNfa(const nfaNode* nodes, alLength nodeCount, unsigned int start, arrayList* reversed){
+    //Until a node gets its first move, it is an empty node that only leads back to itself
+    for(alIndex i = 0;i < nodeCount;i++){
+        nfaNode stuck = {NODE_EMPTY, i, 0, 0};
+        if(alAppend(reversed, &stuck) == NULL) return 1;
+    }
+
+    nfaNode match = {NODE_MATCH, 0, 0, 0};
+    if(alAppend(reversed, &match) == NULL || addMove(reversed, start, nodeCount)) return 1;
+
+    for(alIndex i = 0;i < nodeCount;i++){
+        const nfaNode* node = nodes + i;
+        if(node->kind == NODE_MATCH) continue;
+
+        //Moves that consume nothing and test nothing lead straight back; the others go through a copy
+        unsigned int back = i;
+        if(node->kind == NODE_SET || node->kind == NODE_BEGIN || node->kind == NODE_END){
+            nfaNode copy = {node->kind == NODE_BEGIN ? NODE_END : node->kind == NODE_END ? NODE_BEGIN : NODE_SET, i, 0, node->set};
+            if(alAppend(reversed, &copy) == NULL) return 1;
+            back = alGetListLength(reversed) - 1;
+        }
+
+        if(addMove(reversed, node->out, back)) return 1;
+        if(node->kind == NODE_SPLIT && addMove(reversed, node->out1, back)) return 1;
+    }
+
+    return 0;
+}
+
+//Split the byte values into classes that every set treats alike, and pick one representative byte for each class
+static void buildClasses(lstrMatcher* matcher, const byteSet* sets, alLength setCount, unsigned char* representative){
+    memset(matcher->classMap, 0, sizeof(matcher->classMap));
+    matcher->classCount = 1;
+
+    //Refine the classes by each set in turn: two bytes stay together only if they were together and the set holds both or neither
+    for(alIndex s = 0;s < setCount;s++){
+        short renumber[256][2];
+        memset(renumber, -1, sizeof(renumber));
+        unsigned int count = 0;
+
+        for(int b = 0;b < 256;b++){
+            short* class = &renumber[matcher->classMap[b]][setHas(sets + s, b)];
+            if(*class < 0) *class = count++;
+            matcher->classMap[b] = *class;
+        }
+
+        matcher->classCount = count;
+    }
+
+    for(int b = 255;b >= 0;b--) representative[matcher->classMap[b]] = b;
+}
+
+//Compile a pattern in either syntax. Returns NULL if the pattern is invalid, too complex, or allocation failed.
+static lstrMatcher* compilePattern(const char* pattern, int glob){
+    patternParser parser = {(const unsigned char*) pattern, alNewArrayList(sizeof(nfaNode)), alNewArrayList(sizeof(byteSet)), 0, 0};
+    parser.failed = (parser.nodes == NULL || parser.sets == NULL);
+
+    nfaFragment fragment = {0, 0};
+    if(!parser.failed){
+        fragment = glob ? parseGlob(&parser) : parseAlternation(&parser);
+
+        //Anything left over is an unmatched ')'
+        if(!parser.failed && *parser.pos != '\0') parser.failed = 1;
+
+        linkNode(&parser, fragment.end, addNode(&parser, NODE_MATCH, 0, 0, 0));
+    }
+
+    lstrMatcher* matcher = parser.failed ? NULL : (lstrMatcher*) calloc(1, sizeof(lstrMatcher));
+    arrayList* reversed = matcher == NULL ? NULL : alNewArrayList(sizeof(nfaNode));
+
+    //The pattern's match node is the last one added
+    alLength nodeCount = alGetListLength(parser.nodes);
+    if(matcher != NULL && (reversed == NULL || reverseNfa((const nfaNode*) alGetListHead(parser.nodes), nodeCount, fragment.start, reversed))){
+        lstrFreeMatcher(matcher);
+        matcher = NULL;
+    }
+
+    if(matcher != NULL){
+        unsigned char representative[256];
+        buildClasses(matcher, (const byteSet*) alGetListHead(parser.sets), alGetListLength(parser.sets), representative);
+
+        //The reversed NFA is the larger one, so the scratch space is sized for it. A key holds the flags and at most one group per node.
+        alLength reversedCount = alGetListLength(reversed);
+        dfaBuilder builder = {(const nfaNode*) alGetListHead(parser.nodes), (const byteSet*) alGetListHead(parser.sets), fragment.start};
+        builder.stack = (unsigned int*) malloc(2 * reversedCount * sizeof(unsigned int));
+        builder.seen = (unsigned int*) calloc(2 * reversedCount, sizeof(unsigned int));
+        builder.key = (unsigned int*) malloc((2 * reversedCount + 1) * sizeof(unsigned int));
+        builder.current = (unsigned int*) malloc((2 * reversedCount + 1) * sizeof(unsigned int));
+        builder.seeds = (unsigned int*) malloc(reversedCount * sizeof(unsigned int));
+
+        int failed = (builder.stack == NULL || builder.seen == NULL || builder.key == NULL || builder.current == NULL || builder.seeds == NULL
+            || buildDfa(&builder, matcher, representative, 0, &matcher->anchored) || buildDfa(&builder, matcher, representative, 1, &matcher->leftmost));
+
+        if(!failed){
+            builder.nodes = (const nfaNode*) alGetListHead(reversed);
+            builder.startNode = nodeCount - 1;
+            failed = buildDfa(&builder, matcher, representative, 0, &matcher->reverse);
+        }
+
+        if(failed){
+            lstrFreeMatcher(matcher);
+            matcher = NULL;
+        }
+
+        free(builder.stack);
+        free(builder.seen);
+        free(builder.key);
+        free(builder.current);
+        free(builder.seeds);
+    }
+
+    if(reversed != NULL) alFreeArrayList(reversed);
+    if(parser.nodes != NULL) alFreeArrayList(parser.nodes);
+    if(parser.sets != NULL) alFreeArrayList(parser.sets);
+
+    return matcher;
+}
+
+
+//Compile a null-terminated glob pattern: '*' matches any run of bytes (including '/'), '?' matches any one byte, '[...]' matches one byte from a set (with ranges such as a-z, and '!' or '^' first to negate it), and '\' makes the next byte literal. Every other byte matches itself.
+//Returns NULL if the pattern is invalid (an unterminated set or a trailing '\'), too complex, or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMatcher.
+lstrMatcher* lstrNewGlobMatcher(char* glob){
+    #ifndef NO_SAFETY
+    if(glob == NULL) return NULL;
+    #endif
+
+    return compilePattern(glob, 1);
+}
+
+//Compile a null-terminated regular expression. The supported syntax is: literal bytes; '.' (any byte); sets '[...]' and '[^...]' with ranges; the escapes \d \w \s (and \D \W \S), \n \t \r, and '\' before any other byte to make it literal;
+//the repetitions '*', '+' and '?'; grouping with '(' and ')'; alternation with '|'; and the anchors '^' (start of input) and '$' (end of input).
+//Returns NULL if the expression is invalid, too complex, or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMatcher.
+lstrMatcher* lstrNewRegexMatcher(char* regex){
+    #ifndef NO_SAFETY
+    if(regex == NULL) return NULL;
+    #endif
+
+    return compilePattern(regex, 0);
+}
+
+
+//Matching. Each loop step is one table lookup; the accept bit in each entry saves a second lookup to see whether the new state accepts.
+
+//Run the anchored automaton over the whole input. Returns 1 if the input matches, or 0 if not.
+static int matchWhole(const lstrMatcher* matcher, const unsigned char* text, lstrLength len){
+    const unsigned int* delta = matcher->anchored.delta;
+    unsigned int row = matcher->anchored.startAtBeginning & ~MATCHER_ACCEPT;
+
+    for(lstrIndex i = 0;i < len && row != 0;i++) row = delta[row + matcher->classMap[text[i]]] & ~MATCHER_ACCEPT;
+
+    return matcher->anchored.acceptAtEnd[row / matcher->classCount];
+}
+
+//Find the leftmost-longest match starting at or after <from>. Returns 0 if a match was stored, or 1 if there is none.
+//The leftmost automaton runs forward to where that match ends, then the reversed automaton runs backward from there to the furthest position it accepts, which is where the match starts. Each byte is read at most twice.
+static int findMatch(const lstrMatcher* matcher, const unsigned char* text, lstrLength len, lstrIndex from, lstrSpan* match){
+    if(from > len) return 1;
+
+    const unsigned int* delta = matcher->leftmost.delta;
+    unsigned int entry = from == 0 ? matcher->leftmost.startAtBeginning : matcher->leftmost.start;
+    unsigned int row = entry & ~MATCHER_ACCEPT;
+    lstrIndex end = (entry & MATCHER_ACCEPT) ? from : MATCH_NOT_FOUND;
+
+    //The leftmost automaton only dies once it has found its match, or if no later position can start one (for example, after a leading '^')
+    lstrIndex i = from;
+    for(;i < len && row != 0;i++){
+        entry = delta[row + matcher->classMap[text[i]]];
+        row = entry & ~MATCHER_ACCEPT;
+        if(entry & MATCHER_ACCEPT) end = i + 1;
+    }
+
+    if(i == len && row != 0 && matcher->leftmost.acceptAtEnd[row / matcher->classCount]) end = len;
+    if(end == MATCH_NOT_FOUND) return 1;
+
+    //Running backward, '$' holds where the match ends at the end of the input, and '^' only if the scan reaches the start of the input
+    delta = matcher->reverse.delta;
+    entry = end == len ? matcher->reverse.startAtBeginning : matcher->reverse.start;
+    row = entry & ~MATCHER_ACCEPT;
+    lstrIndex start = (entry & MATCHER_ACCEPT) ? end : MATCH_NOT_FOUND;
+
+    i = end;
+    for(;i > from && row != 0;i--){
+        entry = delta[row + matcher->classMap[text[i - 1]]];
+        row = entry & ~MATCHER_ACCEPT;
+        if(entry & MATCHER_ACCEPT) start = i - 1;
+    }
+
+    if(i == 0 && row != 0 && matcher->reverse.acceptAtEnd[row / matcher->classCount]) start = 0;
+
+    match->offset = start;
+    match->length = end - start;
+    return 0;
+}
+
+//Find every non-overlapping leftmost-longest match. Returns an arrayList of lstrSpan, or NULL if allocation failed.
+static arrayList* findAllMatches(const lstrMatcher* matcher, const unsigned char* text, lstrLength len){
+    arrayList* matches = alNewArrayList(sizeof(lstrSpan));
+    if(matches == NULL) return NULL;
+
+    lstrSpan match;
+    for(lstrIndex from = 0;findMatch(matcher, text, len, from, &match) == 0;from = match.offset + match.length + (match.length == 0)){
+        if(alAppend(matches, &match) == NULL){
+            alFreeArrayList(matches);
+            return NULL;
+        }
+    }
+
+    return matches;
+}
+
+
+//Check whether the whole string matches the pattern. Returns 1 if so, or 0 if not or if the operation fails.
+int lstrMatch(lString* lstr, lstrMatcher* matcher){
+    null_check(matcher, 0);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL) return 0;
+    #endif
+
+    return matchWhole(matcher, (const unsigned char*) lstr->head, lstr->length);
+}
+
+//Check whether the whole view matches the pattern. Returns 1 if so, or 0 if not or if the operation fails.
+int lstrMatchView(lstrView view, lstrMatcher* matcher){
+    null_check(matcher, 0);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(view)) return 0;
+    #endif
+
+    return matchWhole(matcher, (const unsigned char*) view.data, view.length);
+}
+
+//Find the leftmost match of the pattern that starts at or after <from>, taking the longest match that starts there. Returns 0 if a match was stored in <match>, or 1 if there is none or the operation fails.
+int lstrFindMatch(lString* lstr, lstrMatcher* matcher, lstrIndex from, lstrSpan* match){
+    null_check(matcher, 1);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL || match == NULL) return 1;
+    #endif
+
+    return findMatch(matcher, (const unsigned char*) lstr->head, lstr->length, from, match);
+}
+
+//Find the leftmost-longest match of the pattern in a view that starts at or after <from>. Offsets in <match> are relative to the start of the view. Returns 0 if a match was stored in <match>, or 1 if there is none or the operation fails.
+int lstrFindMatchView(lstrView view, lstrMatcher* matcher, lstrIndex from, lstrSpan* match){
+    null_check(matcher, 1);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(view) || match == NULL) return 1;
+    #endif
+
+    return findMatch(matcher, (const unsigned char*) view.data, view.length, from, match);
+}
+
+//Find every non-overlapping leftmost-longest match of the pattern, scanning from the start of the string. After an empty match, the search resumes one byte later. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllMatches(lString* lstr, lstrMatcher* matcher){
+    null_check(matcher, NULL);
+
+    #ifndef NO_SAFETY
+    if(lstr == NULL || lstr->head == NULL) return NULL;
+    #endif
+
+    return findAllMatches(matcher, (const unsigned char*) lstr->head, lstr->length);
+}
+
+//Find every non-overlapping leftmost-longest match of the pattern in a view. Offsets are relative to the start of the view. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllMatchesView(lstrView view, lstrMatcher* matcher){
+    null_check(matcher, NULL);
+
+    #ifndef NO_SAFETY
+    if(!lstrViewIsValid(view)) return NULL;
+    #endif
+
+    return findAllMatches(matcher, (const unsigned char*) view.data, view.length);
+}
+
+
+//Destroy and de-allocate a matcher
+void lstrFreeMatcher(lstrMatcher* matcher){
+    if(matcher == NULL) return;
+
+    free(matcher->anchored.delta);
+    free(matcher->anchored.acceptAtEnd);
+    free(matcher->leftmost.delta);
+    free(matcher->leftmost.acceptAtEnd);
+    free(matcher->reverse.delta);
+    free(matcher->reverse.acceptAtEnd);
+    free(matcher);
+}
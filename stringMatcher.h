@@ -0,0 +1,81 @@
+#ifndef STRINGMATCHER_H
+#define STRINGMATCHER_H
+
+#include "listString.h"
+
+#define MATCHER_MAX_STATES 4096 //The largest number of states each automaton of a matcher may have. Patterns that need more fail to compile.
+
+
+//One deterministic automaton of a matcher. Each transition entry is the target state's row (state * classCount), with MATCHER_ACCEPT set if the target state accepts, so the match loop needs no multiplication and no second lookup.
+//State 0 is the dead state, which has no way to reach a match.
+typedef struct lstrMatcherDfa {
+    //Transition table, indexed by row + byte class
+    unsigned int* delta;
+
+    //For each state, nonzero if the state accepts at the end of the input (including through a '$' anchor)
+    unsigned char* acceptAtEnd;
+
+    //Entries for the start state at the beginning of the input (where '^' holds) and at any later position
+    unsigned int startAtBeginning;
+    unsigned int start;
+
+    unsigned int stateCount;
+} lstrMatcherDfa;
+
+//Set in a transition entry when its target state accepts
+#define MATCHER_ACCEPT 0x80000000u
+
+
+//Define the lstrMatcher type, a glob or regular expression compiled into deterministic automata, so matching reads each byte at most twice with a single table lookup, never backtracks, and never allocates
+//Bytes that every part of the pattern treats alike share one byte class, so the tables only need a column per class
+typedef struct stringMatcher {
+    //Byte class of each byte value, and the number of classes
+    unsigned char classMap[256];
+    unsigned int classCount;
+
+    //<anchored> matches from a fixed starting position, and is used to match whole strings.
+    //<leftmost> starts a match at every position until one accepts, and then only follows the attempts that started earlier, so it stops where the leftmost-longest match ends.
+    //<reverse> matches the reversed pattern, and runs backward from the end of a match to find where it starts.
+    lstrMatcherDfa anchored;
+    lstrMatcherDfa leftmost;
+    lstrMatcherDfa reverse;
+} lstrMatcher;
+
+
+//Compile a null-terminated glob pattern: '*' matches any run of bytes (including '/'), '?' matches any one byte, '[...]' matches one byte from a set (with ranges such as a-z, and '!' or '^' first to negate it), and '\' makes the next byte literal. Every other byte matches itself.
+//Returns NULL if the pattern is invalid (an unterminated set or a trailing '\'), too complex, or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMatcher.
+lstrMatcher* lstrNewGlobMatcher(char*);
+
+//Compile a null-terminated regular expression. The supported syntax is: literal bytes; '.' (any byte); sets '[...]' and '[^...]' with ranges; the escapes \d \w \s (and \D \W \S), \n \t \r, and '\' before any other byte to make it literal;
+//the repetitions '*', '+' and '?'; grouping with '(' and ')'; alternation with '|'; and the anchors '^' (start of input) and '$' (end of input).
+//Returns NULL if the expression is invalid, too complex, or allocation failed.
+//This function dynamically allocates memory, and its return value must be freed with lstrFreeMatcher.
+lstrMatcher* lstrNewRegexMatcher(char*);
+
+
+//Check whether the whole string matches the pattern. Returns 1 if so, or 0 if not or if the operation fails.
+int lstrMatch(lString*, lstrMatcher*);
+
+//Check whether the whole view matches the pattern. Returns 1 if so, or 0 if not or if the operation fails.
+int lstrMatchView(lstrView, lstrMatcher*);
+
+//Find the leftmost match of the pattern that starts at or after <from>, taking the longest match that starts there. Returns 0 if a match was stored in <match>, or 1 if there is none or the operation fails.
+int lstrFindMatch(lString*, lstrMatcher*, lstrIndex, lstrSpan*);
+
+//Find the leftmost-longest match of the pattern in a view that starts at or after <from>. Offsets in <match> are relative to the start of the view. Returns 0 if a match was stored in <match>, or 1 if there is none or the operation fails.
+int lstrFindMatchView(lstrView, lstrMatcher*, lstrIndex, lstrSpan*);
+
+//Find every non-overlapping leftmost-longest match of the pattern, scanning from the start of the string. After an empty match, the search resumes one byte later. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllMatches(lString*, lstrMatcher*);
+
+//Find every non-overlapping leftmost-longest match of the pattern in a view. Offsets are relative to the start of the view. Returns an arrayList of lstrSpan (which may be empty), or NULL if the operation fails.
+//This function dynamically allocates memory, and its return value must be freed with alFreeArrayList.
+arrayList* lstrFindAllMatchesView(lstrView, lstrMatcher*);
+
+
+//Destroy and de-allocate a matcher
+void lstrFreeMatcher(lstrMatcher*);
+
+#endif
@@ -1,8 +1,71 @@
 #include "arrayList.h"
 #include "listString.h"
+#include "ropeString.h"
+#include <stdio.h>
+#include <string.h>
+
+//Remove every odd value from a tombstone-mode list while iterating over it. Returns 0 if every element was visited once and exactly the even values remain, or 1 if not.
+int testTombstoneIteration(){
+    arrayList* list = alNewArrayList(sizeof(int));
+    for(int i = 0;i < 1000;i++) alAppend(list, &i);
+    alEnableTombstones(list, 25);
+
+    int visited = 0;
+    alIndex cursor = 0, logical = 0;
+    for(int* value = (int*) alTombstoneNext(list, &cursor);value != NULL;value = (int*) alTombstoneNext(list, &cursor)){
+        if(*value != visited++) break;
+
+        //Removing the current element leaves <logical> pointing at the next one
+        if(*value % 2 == 1) alTombstoneRemove(list, logical);
+        else logical++;
+    }
+
+    int failed = visited != 1000 || alGetListLength(list) != 500 || alGetListSize(list) != 500 * sizeof(int);
+    for(alIndex i = 0;i < 500 && !failed;i++) failed = *(int*) alGetElement(list, i) != (int) (2 * i);
+
+    alFreeArrayList(list);
+    return failed;
+}
+
+//Find the height of a rope subtree
+unsigned long ropeHeight(const ropeNode* node){
+    if(node == NULL) return 0;
+
+    unsigned long left = ropeHeight(node->left), right = ropeHeight(node->right);
+    return 1 + (left > right ? left : right);
+}
+
+//Concatenate many fresh single-chunk ropes. Returns 0 if the text is intact and the tree stayed balanced (a treap of 5000 nodes is expected to be about 30 high), or 1 if not.
+int testRopeConcatHeight(){
+    lstrRope* rope = ropeNewRope();
+    char chunk[ROPE_CHUNK_BYTES];
+    int failed = 0;
+
+    for(int i = 0;i < 5000 && !failed;i++){
+        memset(chunk, 'a' + i % 26, ROPE_CHUNK_BYTES);
+
+        lstrRope* next = ropeNewRope();
+        failed = ropeAppend(next, chunk, ROPE_CHUNK_BYTES) != 0 || ropeConcat(rope, next) != 0;
+    }
+
+    failed = failed || ropeGetLength(rope) != 5000UL * ROPE_CHUNK_BYTES || *ropeGetChar(rope, 4999UL * ROPE_CHUNK_BYTES) != 'a' + 4999 % 26 || ropeHeight(rope->root) > 100;
+
+    ropeFreeRope(rope);
+    return failed;
+}
 
 int main(int argc, char** argv){
 
+    if(testTombstoneIteration()){
+        printf("Tombstone iteration test failed\n");
+        return 1;
+    }
+
+    if(testRopeConcatHeight()){
+        printf("Rope concatenation height test failed\n");
+        return 1;
+    }
+
     lString* lstr = lstrNewString("Hamlet: To be, or not to be. That is the question. Whether 'tis nobler in the mind to suffer the slings and arrows...");
 
     lstrDiagnostics(lstr);